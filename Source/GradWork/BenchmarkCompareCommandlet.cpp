@@ -0,0 +1,257 @@
+#include "BenchmarkCompareCommandlet.h"
+
+#include "BenchmarkReport.h"
+#include "FrameTrace.h"
+#include "SignificanceTests.h"
+#include <fstream>
+
+namespace
+{
+	// Every column that is a time, lower is better for all of them
+	TArray<FString> GetDefaultMetrics()
+	{
+		TArray<FString> metrics;
+		for (const FMetricDesc& desc : FFrameMetricSchema::Descs)
+		{
+			if (FCString::Strcmp(desc.unit, TEXT("ms")) == 0 || FCString::Strcmp(desc.unit, TEXT("us")) == 0)
+			{
+				metrics.Add(desc.name);
+			}
+		}
+		return metrics;
+	}
+
+	// Fewer frames than this do not say anything about a distribution
+	constexpr int32 MinSamples = 30;
+
+	// The traces of every run of one view in one mode
+	struct FRunGroup
+	{
+		FString view;
+		FString mode;
+		TArray<FString> traceFiles;
+	};
+
+	FString GetMetadata(const FFrameTraceMetadata& metadata, const TCHAR* key)
+	{
+		const TPair<FString, FString>* pEntry = metadata.FindByPredicate([key](const TPair<FString, FString>& entry) { return entry.Key == key; });
+		return pEntry ? pEntry->Value : FString();
+	}
+
+	// Minimally instrumented runs of an observer-effect session are only compared with each other
+	FString GetGroupMode(const FString& mode, const FString& instrumentation)
+	{
+		return instrumentation == TEXT("Minimal") ? mode + TEXT(" (minimal)") : mode;
+	}
+
+	void AddToGroup(TArray<FRunGroup>& groups, const FString& view, const FString& mode, const FString& traceFile)
+	{
+		FRunGroup* pGroup = groups.FindByPredicate([&](const FRunGroup& group) { return group.view == view && group.mode == mode; });
+		if (!pGroup)
+		{
+			pGroup = &groups.AddDefaulted_GetRef();
+			pGroup->view = view;
+			pGroup->mode = mode;
+		}
+		pGroup->traceFiles.Add(traceFile);
+	}
+
+	bool LoadGroups(const FString& filePath, TArray<FRunGroup>& outGroups)
+	{
+		if (FPaths::GetExtension(filePath) == FrameTrace::Extension)
+		{
+			FFrameTraceReader reader;
+			if (!reader.Open(filePath))
+				return false;
+
+			const FFrameTraceMetadata& metadata = reader.GetMetadata();
+			const FString view = GetMetadata(metadata, TEXT("View"));
+			AddToGroup(outGroups, view.IsEmpty() ? GetMetadata(metadata, TEXT("Scene")) : view,
+				GetGroupMode(GetMetadata(metadata, TEXT("Mode")), GetMetadata(metadata, TEXT("Instrumentation"))), filePath);
+			return true;
+		}
+
+		TArray<FRunResult> results;
+		if (!BenchmarkReport::ReadSessionJson(filePath, results))
+			return false;
+
+		for (const FRunResult& result : results)
+		{
+			if (result.traceFilePath.IsEmpty())
+				continue;
+
+			// Runs from before views were recorded fall back to their run name
+			const FString view = result.GetMetadata(TEXT("View"));
+			AddToGroup(outGroups, view.IsEmpty() ? result.scene : view, GetGroupMode(result.mode, result.GetMetadata(TEXT("Instrumentation"))), result.traceFilePath);
+		}
+		return true;
+	}
+
+	// One array per metric with the frames of every trace in the group, values below 0 were not measured
+	TArray<TArray<double>> LoadSamples(const FRunGroup& group, const TArray<FString>& metrics)
+	{
+		TArray<TArray<double>> samples;
+		samples.SetNum(metrics.Num());
+		for (const FString& traceFile : group.traceFiles)
+		{
+			FFrameTraceReader reader;
+			if (!reader.Open(traceFile))
+				continue;
+
+			TArray<TArray<double>> columns;
+			reader.ReadColumns(metrics, columns);
+			for (int32 i = 0; i < metrics.Num(); ++i)
+			{
+				for (const double value : columns[i])
+				{
+					if (value >= 0.0)
+						samples[i].Add(value);
+				}
+			}
+		}
+		return samples;
+	}
+}
+
+UBenchmarkCompareCommandlet::UBenchmarkCompareCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBenchmarkCompareCommandlet::Main(const FString& Params)
+{
+	FString baselinePath;
+	FString candidatePath;
+	if (!FParse::Value(*Params, TEXT("baseline="), baselinePath) || !FParse::Value(*Params, TEXT("candidate="), candidatePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=BenchmarkCompare -baseline=<session json or trace> -candidate=<session json or trace> [-threshold=0.03] [-alpha=0.01] [-metrics=FrameTime,GPUTime] [-resamples=2000] [-block=60] [-report=<file>]"));
+		return 2;
+	}
+
+	double threshold = 0.03;
+	double alpha = 0.01;
+	int32 numResamples = 2000;
+	int32 blockLength = 60;
+	FParse::Value(*Params, TEXT("threshold="), threshold);
+	FParse::Value(*Params, TEXT("alpha="), alpha);
+	FParse::Value(*Params, TEXT("resamples="), numResamples);
+	FParse::Value(*Params, TEXT("block="), blockLength);
+
+	TArray<FString> metrics;
+	FString metricList;
+	if (FParse::Value(*Params, TEXT("metrics="), metricList, false))
+	{
+		metricList.ParseIntoArray(metrics, TEXT(","));
+	}
+	else
+	{
+		metrics = GetDefaultMetrics();
+	}
+
+	TArray<FRunGroup> baselineGroups;
+	TArray<FRunGroup> candidateGroups;
+	if (!LoadGroups(baselinePath, baselineGroups) || !LoadGroups(candidatePath, candidateGroups))
+		return 2;
+
+	// Two single traces are compared whatever their names, sessions are matched run by run
+	TArray<TPair<const FRunGroup*, const FRunGroup*>> pairs;
+	const bool bIsTracePair = FPaths::GetExtension(baselinePath) == FrameTrace::Extension && FPaths::GetExtension(candidatePath) == FrameTrace::Extension;
+	if (bIsTracePair)
+	{
+		pairs.Emplace(&baselineGroups[0], &candidateGroups[0]);
+	}
+	else
+	{
+		for (const FRunGroup& baseline : baselineGroups)
+		{
+			const FRunGroup* pCandidate = candidateGroups.FindByPredicate([&baseline](const FRunGroup& group) { return group.view == baseline.view && group.mode == baseline.mode; });
+			if (pCandidate)
+			{
+				pairs.Emplace(&baseline, pCandidate);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s (%s) is only in the baseline."), *baseline.view, *baseline.mode);
+			}
+		}
+		for (const FRunGroup& candidate : candidateGroups)
+		{
+			if (!baselineGroups.ContainsByPredicate([&candidate](const FRunGroup& group) { return group.view == candidate.view && group.mode == candidate.mode; }))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s (%s) is only in the candidate."), *candidate.view, *candidate.mode);
+			}
+		}
+	}
+
+	FString report = FString::Printf(TEXT("Baseline: %s\nCandidate: %s\nThreshold %.1f%%, alpha %.3f, %d resamples in blocks of %d frames\n\n"),
+		*baselinePath, *candidatePath, threshold * 100.0, alpha, numResamples, blockLength);
+	report += TEXT("View                     | Mode                           | Metric                         | Base p50  | Cand p50  | Change   | 95% CI              | p-value   | Verdict\n");
+	report += TEXT("--------------------------------------------------------------------------------------------------------------------------------------------------------------------------\n");
+
+	int32 numCompared = 0;
+	int32 numRegressions = 0;
+	int32 numImprovements = 0;
+	for (const TPair<const FRunGroup*, const FRunGroup*>& pair : pairs)
+	{
+		const TArray<TArray<double>> baselineSamples = LoadSamples(*pair.Key, metrics);
+		const TArray<TArray<double>> candidateSamples = LoadSamples(*pair.Value, metrics);
+
+		for (int32 i = 0; i < metrics.Num(); ++i)
+		{
+			const TArray<double>& baseline = baselineSamples[i];
+			const TArray<double>& candidate = candidateSamples[i];
+			if (baseline.Num() < MinSamples || candidate.Num() < MinSamples)
+				continue;
+
+			const FMannWhitneyResult test = SignificanceTests::MannWhitneyU(baseline, candidate);
+			const FBootstrapInterval change = SignificanceTests::BootstrapMedianChange(baseline, candidate, numResamples, 0.95, blockLength);
+
+			// Significant, the whole interval on one side of 0 and a change larger than the noise we accept
+			const TCHAR* verdict = TEXT("-");
+			if (test.pValue < alpha && change.lower > 0.0 && change.estimate > threshold)
+			{
+				verdict = TEXT("REGRESSION");
+				++numRegressions;
+			}
+			else if (test.pValue < alpha && change.upper < 0.0 && change.estimate < -threshold)
+			{
+				verdict = TEXT("improvement");
+				++numImprovements;
+			}
+			++numCompared;
+
+			report += FString::Printf(TEXT("%-24s | %-30s | %-30s | %-9.3f | %-9.3f | %+7.2f%% | %+7.2f%% .. %+7.2f%% | %-9.2e | %s\n"),
+				*pair.Key->view, *pair.Key->mode, *metrics[i],
+				SignificanceTests::Median(baseline), SignificanceTests::Median(candidate),
+				change.estimate * 100.0, change.lower * 100.0, change.upper * 100.0, test.pValue, verdict);
+		}
+	}
+
+	report += FString::Printf(TEXT("\n%d comparisons, %d regressions, %d improvements\n"), numCompared, numRegressions, numImprovements);
+	UE_LOG(LogTemp, Display, TEXT("\n%s"), *report);
+
+	FString reportPath;
+	if (FParse::Value(*Params, TEXT("report="), reportPath))
+	{
+		std::ofstream file(TCHAR_TO_UTF8(*reportPath));
+		if (file.is_open())
+		{
+			file << TCHAR_TO_UTF8(*report);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Could not write comparison report to %s."), *reportPath);
+		}
+	}
+
+	if (numCompared == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Nothing to compare, no run has enough frames in both inputs."));
+		return 2;
+	}
+
+	return numRegressions > 0 ? 1 : 0;
+}
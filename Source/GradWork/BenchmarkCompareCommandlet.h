@@ -0,0 +1,25 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BenchmarkCompareCommandlet.generated.h"
+
+/**
+ * Compares the frames of a candidate benchmark against a baseline, per view, mode and metric.
+ * Usage: -run=BenchmarkCompare -baseline=<session json or trace> -candidate=<session json or trace>
+ *        [-threshold=0.03] [-alpha=0.01] [-metrics=FrameTime,GPUTime] [-resamples=2000] [-block=60] [-report=<file>]
+ * Runs are matched on their view and mode, slices of a view are pooled. Two traces are compared with each other directly.
+ * A metric regresses when the Mann-Whitney U test is significant at alpha, the bootstrap interval of the median change
+ * lies above 0 and the change itself is above the threshold.
+ * Returns 0 without regressions, 1 when anything regressed and 2 when the inputs could not be compared.
+ */
+UCLASS()
+class GRADWORK_API UBenchmarkCompareCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBenchmarkCompareCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,858 @@
+#include "BenchmarkReport.h"
+
+#include "Algo/StableSort.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include <fstream>
+
+namespace
+{
+	double GetTrimmedMean(const FRunResult& result, const TCHAR* metricName)
+	{
+		const FMetricResult* pMetric = result.metrics.FindByPredicate([metricName](const FMetricResult& metric) { return metric.name == metricName; });
+		return pMetric ? pMetric->summary.trimmedMean : 0.0;
+	}
+
+	double GetMedian(const FRunResult& result, const TCHAR* metricName)
+	{
+		const FMetricResult* pMetric = result.metrics.FindByPredicate([metricName](const FMetricResult& metric) { return metric.name == metricName; });
+		return pMetric ? pMetric->summary.p50 : 0.0;
+	}
+
+	// cost = perFrame + perMegapixel * megapixels
+	struct FLinearFit
+	{
+		double perFrame{ 0 };
+		double perMegapixel{ 0 };
+		double rSquared{ 0 };
+	};
+
+	// Needs at least two different pixel counts, points are (megapixels, cost)
+	bool FitLinearCost(const TArray<FVector2D>& points, FLinearFit& outFit)
+	{
+		if (points.Num() < 2)
+			return false;
+
+		double meanX = 0.0;
+		double meanY = 0.0;
+		for (const FVector2D& point : points)
+		{
+			meanX += point.X;
+			meanY += point.Y;
+		}
+		meanX /= points.Num();
+		meanY /= points.Num();
+
+		// Centered sums, so large pixel counts do not cost precision
+		double sxx = 0.0;
+		double sxy = 0.0;
+		double syy = 0.0;
+		for (const FVector2D& point : points)
+		{
+			sxx += (point.X - meanX) * (point.X - meanX);
+			sxy += (point.X - meanX) * (point.Y - meanY);
+			syy += (point.Y - meanY) * (point.Y - meanY);
+		}
+		if (sxx <= 0.0)
+			return false;
+
+		outFit.perMegapixel = sxy / sxx;
+		outFit.perFrame = meanY - outFit.perMegapixel * meanX;
+		outFit.rSquared = syy > 0.0 ? sxy * sxy / (sxx * syy) : 1.0;
+		return true;
+	}
+
+	constexpr int32 SessionJsonVersion = 1;
+
+	TSharedRef<FJsonObject> MetricsToJson(const TArray<FMetricResult>& metrics)
+	{
+		const TSharedRef<FJsonObject> pMetrics = MakeShared<FJsonObject>();
+		for (const FMetricResult& metric : metrics)
+		{
+			const FHistogramSummary& summary = metric.summary;
+			const TSharedRef<FJsonObject> pMetric = MakeShared<FJsonObject>();
+			pMetric->SetNumberField(TEXT("count"), static_cast<double>(summary.count));
+			pMetric->SetNumberField(TEXT("overBudget"), metric.bHasBudget ? static_cast<double>(summary.overBudgetCount) : -1.0);
+			pMetric->SetNumberField(TEXT("min"), summary.min);
+			pMetric->SetNumberField(TEXT("max"), summary.max);
+			pMetric->SetNumberField(TEXT("mean"), summary.mean);
+			pMetric->SetNumberField(TEXT("trimmedMean"), summary.trimmedMean);
+			pMetric->SetNumberField(TEXT("stdDev"), summary.stdDev);
+			pMetric->SetNumberField(TEXT("p50"), summary.p50);
+			pMetric->SetNumberField(TEXT("p90"), summary.p90);
+			pMetric->SetNumberField(TEXT("p95"), summary.p95);
+			pMetric->SetNumberField(TEXT("p99"), summary.p99);
+			pMetric->SetNumberField(TEXT("p999"), summary.p999);
+			pMetrics->SetObjectField(metric.name, pMetric);
+		}
+		return pMetrics;
+	}
+
+	void MetricsFromJson(const TSharedPtr<FJsonObject>& pMetrics, TArray<FMetricResult>& outMetrics)
+	{
+		if (!pMetrics)
+			return;
+
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& entry : pMetrics->Values)
+		{
+			const TSharedPtr<FJsonObject>* ppMetric = nullptr;
+			if (!entry.Value->TryGetObject(ppMetric))
+				continue;
+
+			const FJsonObject& metric = **ppMetric;
+			FHistogramSummary summary;
+			const double overBudget = metric.GetNumberField(TEXT("overBudget"));
+			summary.count = static_cast<uint64>(metric.GetNumberField(TEXT("count")));
+			summary.overBudgetCount = overBudget > 0.0 ? static_cast<uint64>(overBudget) : 0;
+			summary.min = metric.GetNumberField(TEXT("min"));
+			summary.max = metric.GetNumberField(TEXT("max"));
+			summary.mean = metric.GetNumberField(TEXT("mean"));
+			summary.trimmedMean = metric.GetNumberField(TEXT("trimmedMean"));
+			summary.stdDev = metric.GetNumberField(TEXT("stdDev"));
+			summary.p50 = metric.GetNumberField(TEXT("p50"));
+			summary.p90 = metric.GetNumberField(TEXT("p90"));
+			summary.p95 = metric.GetNumberField(TEXT("p95"));
+			summary.p99 = metric.GetNumberField(TEXT("p99"));
+			summary.p999 = metric.GetNumberField(TEXT("p999"));
+			outMetrics.Add({ entry.Key, summary, overBudget >= 0.0 });
+		}
+	}
+
+	TSharedRef<FJsonObject> HitchesToJson(const FHitchSummary& hitches)
+	{
+		const TSharedRef<FJsonObject> pHitches = MakeShared<FJsonObject>();
+		pHitches->SetNumberField(TEXT("frames"), hitches.numFrames);
+		pHitches->SetNumberField(TEXT("seconds"), hitches.trackedSeconds);
+		pHitches->SetNumberField(TEXT("count"), hitches.numHitches);
+		pHitches->SetNumberField(TEXT("clusters"), hitches.numClusters);
+		pHitches->SetNumberField(TEXT("largestCluster"), hitches.largestCluster);
+		pHitches->SetNumberField(TEXT("timeLost"), hitches.timeLostMs);
+		pHitches->SetNumberField(TEXT("meanJitter"), hitches.meanJitter);
+		pHitches->SetNumberField(TEXT("p95Jitter"), hitches.p95Jitter);
+		pHitches->SetNumberField(TEXT("p99Jitter"), hitches.p99Jitter);
+
+		const TSharedRef<FJsonObject> pCauses = MakeShared<FJsonObject>();
+		for (int32 i = 0; i < static_cast<int32>(EHitchCause::Count); ++i)
+		{
+			pCauses->SetNumberField(GetHitchCauseName(static_cast<EHitchCause>(i)), hitches.numPerCause[i]);
+		}
+		pHitches->SetObjectField(TEXT("causes"), pCauses);
+
+		TArray<TSharedPtr<FJsonValue>> frames;
+		for (const FHitch& hitch : hitches.hitches)
+		{
+			const TSharedRef<FJsonObject> pHitch = MakeShared<FJsonObject>();
+			pHitch->SetNumberField(TEXT("frameNumber"), static_cast<double>(hitch.frameNumber));
+			pHitch->SetNumberField(TEXT("frameIndex"), hitch.frameIndex);
+			pHitch->SetNumberField(TEXT("time"), hitch.timestamp);
+			pHitch->SetNumberField(TEXT("frameTime"), hitch.frameTime);
+			pHitch->SetNumberField(TEXT("median"), hitch.medianFrameTime);
+			pHitch->SetNumberField(TEXT("gameThreadTime"), hitch.gameThreadTime);
+			pHitch->SetNumberField(TEXT("renderThreadTime"), hitch.renderThreadTime);
+			pHitch->SetNumberField(TEXT("gpuTime"), hitch.gpuTime);
+			pHitch->SetStringField(TEXT("cause"), GetHitchCauseName(hitch.cause));
+			pHitch->SetNumberField(TEXT("cluster"), hitch.cluster);
+			frames.Add(MakeShared<FJsonValueObject>(pHitch));
+		}
+		pHitches->SetArrayField(TEXT("hitches"), frames);
+		return pHitches;
+	}
+
+	void HitchesFromJson(const FJsonObject& hitches, FHitchSummary& outHitches)
+	{
+		outHitches.numFrames = hitches.GetIntegerField(TEXT("frames"));
+		outHitches.trackedSeconds = hitches.GetNumberField(TEXT("seconds"));
+		outHitches.numHitches = hitches.GetIntegerField(TEXT("count"));
+		outHitches.numClusters = hitches.GetIntegerField(TEXT("clusters"));
+		outHitches.largestCluster = hitches.GetIntegerField(TEXT("largestCluster"));
+		outHitches.timeLostMs = hitches.GetNumberField(TEXT("timeLost"));
+		outHitches.meanJitter = hitches.GetNumberField(TEXT("meanJitter"));
+		outHitches.p95Jitter = hitches.GetNumberField(TEXT("p95Jitter"));
+		outHitches.p99Jitter = hitches.GetNumberField(TEXT("p99Jitter"));
+
+		const TSharedPtr<FJsonObject>* ppCauses = nullptr;
+		if (hitches.TryGetObjectField(TEXT("causes"), ppCauses))
+		{
+			for (int32 i = 0; i < static_cast<int32>(EHitchCause::Count); ++i)
+			{
+				outHitches.numPerCause[i] = (*ppCauses)->GetIntegerField(GetHitchCauseName(static_cast<EHitchCause>(i)));
+			}
+		}
+
+		const TArray<TSharedPtr<FJsonValue>>* pFrames = nullptr;
+		if (!hitches.TryGetArrayField(TEXT("hitches"), pFrames))
+			return;
+
+		for (const TSharedPtr<FJsonValue>& pFrameValue : *pFrames)
+		{
+			const TSharedPtr<FJsonObject>* ppHitch = nullptr;
+			if (!pFrameValue->TryGetObject(ppHitch))
+				continue;
+
+			const FJsonObject& hitch = **ppHitch;
+			const FString cause = hitch.GetStringField(TEXT("cause"));
+			EHitchCause hitchCause = EHitchCause::Unknown;
+			for (int32 i = 0; i < static_cast<int32>(EHitchCause::Count); ++i)
+			{
+				if (cause == GetHitchCauseName(static_cast<EHitchCause>(i)))
+				{
+					hitchCause = static_cast<EHitchCause>(i);
+				}
+			}
+
+			outHitches.hitches.Add({ static_cast<uint64>(hitch.GetNumberField(TEXT("frameNumber"))), hitch.GetIntegerField(TEXT("frameIndex")),
+				hitch.GetNumberField(TEXT("time")), hitch.GetNumberField(TEXT("frameTime")), hitch.GetNumberField(TEXT("median")),
+				hitch.GetNumberField(TEXT("gameThreadTime")), hitch.GetNumberField(TEXT("renderThreadTime")), hitch.GetNumberField(TEXT("gpuTime")),
+				hitchCause, hitch.GetIntegerField(TEXT("cluster")) });
+		}
+	}
+
+	TSharedRef<FJsonObject> OverdrawToJson(const FOverdrawSummary& overdraw)
+	{
+		const TSharedRef<FJsonObject> pOverdraw = MakeShared<FJsonObject>();
+		pOverdraw->SetNumberField(TEXT("gridWidth"), overdraw.gridWidth);
+		pOverdraw->SetNumberField(TEXT("gridHeight"), overdraw.gridHeight);
+		pOverdraw->SetNumberField(TEXT("primitives"), overdraw.numPrimitives);
+		pOverdraw->SetNumberField(TEXT("meanLayers"), overdraw.meanLayers);
+		pOverdraw->SetNumberField(TEXT("meanCoveredLayers"), overdraw.meanCoveredLayers);
+		pOverdraw->SetNumberField(TEXT("maxLayers"), overdraw.maxLayers);
+		pOverdraw->SetNumberField(TEXT("coverage"), overdraw.coverage);
+		pOverdraw->SetNumberField(TEXT("analyzeMs"), overdraw.analyzeMs);
+
+		TArray<TSharedPtr<FJsonValue>> histogram;
+		for (const int32 count : overdraw.histogram)
+		{
+			histogram.Add(MakeShared<FJsonValueNumber>(count));
+		}
+		pOverdraw->SetArrayField(TEXT("histogram"), histogram);
+		return pOverdraw;
+	}
+
+	void OverdrawFromJson(const FJsonObject& overdraw, FOverdrawSummary& outOverdraw)
+	{
+		outOverdraw.gridWidth = overdraw.GetIntegerField(TEXT("gridWidth"));
+		outOverdraw.gridHeight = overdraw.GetIntegerField(TEXT("gridHeight"));
+		outOverdraw.numPrimitives = overdraw.GetIntegerField(TEXT("primitives"));
+		outOverdraw.meanLayers = overdraw.GetNumberField(TEXT("meanLayers"));
+		outOverdraw.meanCoveredLayers = overdraw.GetNumberField(TEXT("meanCoveredLayers"));
+		outOverdraw.maxLayers = overdraw.GetIntegerField(TEXT("maxLayers"));
+		outOverdraw.coverage = overdraw.GetNumberField(TEXT("coverage"));
+		outOverdraw.analyzeMs = overdraw.GetNumberField(TEXT("analyzeMs"));
+
+		const TArray<TSharedPtr<FJsonValue>>* pHistogram = nullptr;
+		if (overdraw.TryGetArrayField(TEXT("histogram"), pHistogram))
+		{
+			for (const TSharedPtr<FJsonValue>& pCount : *pHistogram)
+			{
+				outOverdraw.histogram.Add(static_cast<int32>(pCount->AsNumber()));
+			}
+		}
+	}
+
+	FString MakeRelative(const FString& filePath, const FString& directory)
+	{
+		FString relativePath = filePath;
+		return !filePath.IsEmpty() && FPaths::MakePathRelativeTo(relativePath, *(directory / TEXT(""))) ? relativePath : filePath;
+	}
+
+	FString MakeAbsolute(const FString& filePath, const FString& directory)
+	{
+		return filePath.IsEmpty() || !FPaths::IsRelative(filePath) ? filePath : FPaths::ConvertRelativePathToFull(directory, filePath);
+	}
+}
+
+FString FRunResult::GetMetadata(const FString& key) const
+{
+	const TPair<FString, FString>* pEntry = metadata.FindByPredicate([&key](const TPair<FString, FString>& entry) { return entry.Key == key; });
+	return pEntry ? pEntry->Value : FString();
+}
+
+FString BenchmarkReport::FormatStatsHeader()
+{
+	return TEXT("Stat Name              | Min       | Max       | Average   | StdDev    | P50       | P90       | P95       | P99       | P99.9     | Over Budget\n")
+		TEXT("-------------------------------------------------------------------------------------------------------------------------------------\n");
+}
+
+FString BenchmarkReport::FormatStatsRow(const FMetricResult& metric)
+{
+	const FHistogramSummary& summary = metric.summary;
+	const FString overBudget = metric.bHasBudget ? FString::Printf(TEXT("%llu"), summary.overBudgetCount) : FString(TEXT("-"));
+	return FString::Printf(
+		TEXT("%-22s | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %s\n"),
+		*metric.name, summary.min, summary.max, summary.trimmedMean, summary.stdDev,
+		summary.p50, summary.p90, summary.p95, summary.p99, summary.p999, *overBudget
+	);
+}
+
+FString BenchmarkReport::FormatPathSegments(const TArray<FMetricResult>& pathSegments)
+{
+	if (pathSegments.IsEmpty())
+		return FString();
+
+	FString text = TEXT("\nFrame time per path segment\n") + FormatStatsHeader();
+	for (const FMetricResult& segment : pathSegments)
+	{
+		text += FormatStatsRow(segment);
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatHitches(const FHitchSummary& hitches, const bool bListHitches)
+{
+	if (hitches.numFrames == 0)
+		return FString();
+
+	FString text = FString::Printf(TEXT("Hitches: %d in %d frames (%.1f per minute), %d clusters, largest %d, %.1f ms lost above the median"),
+		hitches.numHitches, hitches.numFrames, hitches.GetHitchesPerMinute(), hitches.numClusters, hitches.largestCluster, hitches.timeLostMs);
+	if (hitches.numHitches > 0)
+	{
+		text += TEXT(" |");
+		for (int32 i = 0; i < static_cast<int32>(EHitchCause::Count); ++i)
+		{
+			text += FString::Printf(TEXT(" %s %d"), GetHitchCauseName(static_cast<EHitchCause>(i)), hitches.numPerCause[i]);
+		}
+	}
+	text += FString::Printf(TEXT("\nFrame pacing: frame to frame change %.2f ms mean, %.2f ms p95, %.2f ms p99\n"),
+		hitches.meanJitter, hitches.p95Jitter, hitches.p99Jitter);
+
+	if (!bListHitches || hitches.hitches.IsEmpty())
+		return text;
+
+	text += TEXT("\nFrame      | Time (s)  | Frame ms  | Median ms | Game ms   | Render ms | GPU ms    | Cause   | Cluster\n");
+	text += TEXT("---------------------------------------------------------------------------------------------------------\n");
+	for (const FHitch& hitch : hitches.hitches)
+	{
+		text += FString::Printf(TEXT("%-10llu | %-9.3f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-9.2f | %-7s | %d\n"),
+			hitch.frameNumber, hitch.timestamp, hitch.frameTime, hitch.medianFrameTime,
+			hitch.gameThreadTime, hitch.renderThreadTime, hitch.gpuTime, GetHitchCauseName(hitch.cause), hitch.cluster);
+	}
+	if (hitches.hitches.Num() < hitches.numHitches)
+	{
+		text += FString::Printf(TEXT("%d more hitches not listed\n"), hitches.numHitches - hitches.hitches.Num());
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatQuality(const FImageQualityResult& quality)
+{
+	if (!quality.bIsValid)
+		return FString();
+
+	if (quality.bIsReference)
+		return TEXT("Image quality: reference\n");
+
+	return FString::Printf(TEXT("Image quality: PSNR %.2f dB | SSIM %.4f | FLIP %.4f\n"), quality.psnr, quality.ssim, quality.flip);
+}
+
+FString BenchmarkReport::FormatOverdraw(const FRunResult& result)
+{
+	const FOverdrawSummary& overdraw = result.overdraw;
+	if (!overdraw.IsValid())
+		return FString();
+
+	FString text = FString::Printf(TEXT("Layers: %.2f mean where covered (%.2f over the view), %d max, %.1f%% covered, %d translucent primitives, %dx%d rays in %.1f ms\n"),
+		overdraw.meanCoveredLayers, overdraw.meanLayers, overdraw.maxLayers, overdraw.coverage * 100.0, overdraw.numPrimitives,
+		overdraw.gridWidth, overdraw.gridHeight, overdraw.analyzeMs);
+
+	// Per layer over the whole view, a frame blends every layer of every pixel
+	if (overdraw.meanLayers > 0.0)
+	{
+		text += TEXT("Per layer:");
+		for (const TCHAR* metricName : { TEXT("FrameTime - ms"), TEXT("GPUTime - ms"), TEXT("Translucency GPU - ms"), TEXT("OIT GPU - ms") })
+		{
+			if (const double median = GetMedian(result, metricName); median > 0.0)
+			{
+				text += FString::Printf(TEXT(" %s %.3f"), metricName, median / overdraw.meanLayers);
+			}
+		}
+		text += TEXT("\n");
+	}
+
+	const int32 numRays = overdraw.gridWidth * overdraw.gridHeight;
+	text += TEXT("Layer histogram:");
+	for (int32 layers = 0; layers < overdraw.histogram.Num(); ++layers)
+	{
+		if (overdraw.histogram[layers] > 0)
+		{
+			const bool bIsLastBin = layers == overdraw.histogram.Num() - 1;
+			text += FString::Printf(TEXT(" %d%s %.1f%%"), layers, bIsLastBin ? TEXT("+") : TEXT(""), 100.0 * overdraw.histogram[layers] / numRays);
+		}
+	}
+	text += TEXT("\n");
+	if (!overdraw.heatmapPath.IsEmpty())
+	{
+		text += FString::Printf(TEXT("Layer heatmap: %s\n"), *overdraw.heatmapPath);
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatParetoTables(const TArray<FRunResult>& results)
+{
+	struct FModeEntry
+	{
+		FString mode;
+		FImageQualityResult quality;
+		double frameTime{ 0 };
+		double gpuTime{ 0 };
+		int32 numRuns{ 0 };
+	};
+
+	// A view is one capture file name, the same in every mode folder. Views keep the order they were measured in
+	TArray<FString> views;
+	TMap<FString, TArray<FModeEntry>> entriesPerView;
+	for (const FRunResult& result : results)
+	{
+		if (!result.quality.bIsValid)
+			continue;
+
+		const FString view = FPaths::GetBaseFilename(result.capturePath);
+		if (!entriesPerView.Contains(view))
+		{
+			views.Add(view);
+		}
+
+		TArray<FModeEntry>& entries = entriesPerView.FindOrAdd(view);
+		FModeEntry* pEntry = entries.FindByPredicate([&result](const FModeEntry& entry) { return entry.mode == result.mode; });
+		if (!pEntry)
+		{
+			pEntry = &entries.AddDefaulted_GetRef();
+			pEntry->mode = result.mode;
+			pEntry->quality = result.quality;
+		}
+
+		// Slices of a view share one capture, their costs are averaged
+		pEntry->frameTime += GetTrimmedMean(result, TEXT("FrameTime - ms"));
+		pEntry->gpuTime += GetTrimmedMean(result, TEXT("GPUTime - ms"));
+		++pEntry->numRuns;
+	}
+
+	if (views.IsEmpty())
+		return FString();
+
+	FString text = TEXT("\nCost and image quality per view\n");
+	for (const FString& view : views)
+	{
+		TArray<FModeEntry>& entries = entriesPerView[view];
+		for (FModeEntry& entry : entries)
+		{
+			entry.frameTime /= entry.numRuns;
+			entry.gpuTime /= entry.numRuns;
+		}
+
+		text += FString::Printf(TEXT("\n== %s ==\n"), *view);
+		text += TEXT("Mode                           | Frame ms  | GPU ms    | PSNR dB   | SSIM      | FLIP      | Pareto\n");
+		text += TEXT("---------------------------------------------------------------------------------------------------------\n");
+		for (const FModeEntry& entry : entries)
+		{
+			// On the front when no other mode is at least as fast and as accurate, and better in one of the two
+			const bool bIsDominated = entries.ContainsByPredicate([&entry](const FModeEntry& other)
+			{
+				return other.frameTime <= entry.frameTime && other.quality.flip <= entry.quality.flip
+					&& (other.frameTime < entry.frameTime || other.quality.flip < entry.quality.flip);
+			});
+
+			text += FString::Printf(TEXT("%-30s | %-9.2f | %-9.2f | %-9.2f | %-9.4f | %-9.4f | %s\n"),
+				*entry.mode, entry.frameTime, entry.gpuTime, entry.quality.psnr, entry.quality.ssim, entry.quality.flip,
+				bIsDominated ? TEXT("-") : TEXT("yes"));
+		}
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatMemoryPerMode(const TArray<FRunResult>& results)
+{
+	struct FMemoryEntry
+	{
+		FString mode;
+		FString metric;
+		TArray<double> medians;
+		double peak{ 0 };
+	};
+
+	// Modes and metrics keep the order they were measured and declared in
+	TArray<FMemoryEntry> entries;
+	for (const FRunResult& result : results)
+	{
+		for (const FMetricResult& metric : result.metrics)
+		{
+			if (!metric.name.EndsWith(TEXT(" - MB")) || metric.summary.count == 0)
+				continue;
+
+			FMemoryEntry* pEntry = entries.FindByPredicate([&](const FMemoryEntry& entry) { return entry.mode == result.mode && entry.metric == metric.name; });
+			if (!pEntry)
+			{
+				pEntry = &entries.AddDefaulted_GetRef();
+				pEntry->mode = result.mode;
+				pEntry->metric = metric.name;
+			}
+			pEntry->medians.Add(metric.summary.p50);
+			pEntry->peak = FMath::Max(pEntry->peak, metric.summary.max);
+		}
+	}
+
+	if (entries.IsEmpty())
+		return FString();
+
+	Algo::StableSortBy(entries, [](const FMemoryEntry& entry) { return entry.mode; });
+
+	FString text = TEXT("\nMemory per mode, steady is the median over the runs and peak the highest sample of any run\n");
+	text += TEXT("Mode                           | Metric                 | Steady MB  | Peak MB\n");
+	text += TEXT("------------------------------------------------------------------------------------\n");
+	for (FMemoryEntry& entry : entries)
+	{
+		entry.medians.Sort();
+		const int32 num = entry.medians.Num();
+		const double steady = num % 2 == 1 ? entry.medians[num / 2] : 0.5 * (entry.medians[num / 2 - 1] + entry.medians[num / 2]);
+		text += FString::Printf(TEXT("%-30s | %-22s | %-10.1f | %.1f\n"), *entry.mode, *entry.metric, steady, entry.peak);
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatObserverEffect(const TArray<FRunResult>& results)
+{
+	struct FInstrumentationEntry
+	{
+		FString view;
+		FString mode;
+		// Sums over the runs, index 0 is fully instrumented and 1 minimal
+		double frameTime[2]{};
+		double loggerTime[2]{};
+		int32 numRuns[2]{};
+	};
+
+	TArray<FInstrumentationEntry> entries;
+	bool bHasMinimalRuns = false;
+	for (const FRunResult& result : results)
+	{
+		const bool bIsMinimal = result.GetMetadata(TEXT("Instrumentation")) == TEXT("Minimal");
+		bHasMinimalRuns |= bIsMinimal;
+
+		const FString view = result.GetMetadata(TEXT("View")).IsEmpty() ? result.scene : result.GetMetadata(TEXT("View"));
+		FInstrumentationEntry* pEntry = entries.FindByPredicate([&](const FInstrumentationEntry& entry) { return entry.view == view && entry.mode == result.mode; });
+		if (!pEntry)
+		{
+			pEntry = &entries.AddDefaulted_GetRef();
+			pEntry->view = view;
+			pEntry->mode = result.mode;
+		}
+
+		const int32 index = bIsMinimal ? 1 : 0;
+		pEntry->frameTime[index] += GetMedian(result, TEXT("FrameTime - ms"));
+		pEntry->loggerTime[index] += GetTrimmedMean(result, TEXT("Logger Update - us"));
+		++pEntry->numRuns[index];
+	}
+
+	if (!bHasMinimalRuns)
+		return FString();
+
+	FString text = TEXT("\nObserver effect, median frame time with full and minimal instrumentation\n");
+	text += TEXT("View                     | Mode                           | Full ms   | Minimal ms | Change   | Full logger us | Minimal logger us\n");
+	text += TEXT("--------------------------------------------------------------------------------------------------------------------------------\n");
+	for (const FInstrumentationEntry& entry : entries)
+	{
+		if (entry.numRuns[0] == 0 || entry.numRuns[1] == 0)
+			continue;
+
+		const double fullFrameTime = entry.frameTime[0] / entry.numRuns[0];
+		const double minimalFrameTime = entry.frameTime[1] / entry.numRuns[1];
+		const double change = minimalFrameTime > 0.0 ? fullFrameTime / minimalFrameTime - 1.0 : 0.0;
+		text += FString::Printf(TEXT("%-24s | %-30s | %-9.3f | %-10.3f | %+7.2f%% | %-14.1f | %.1f\n"),
+			*entry.view, *entry.mode, fullFrameTime, minimalFrameTime, change * 100.0,
+			entry.loggerTime[0] / entry.numRuns[0], entry.loggerTime[1] / entry.numRuns[1]);
+	}
+	return text;
+}
+
+FString BenchmarkReport::FormatResolutionScaling(const TArray<FRunResult>& results)
+{
+	struct FScalingEntry
+	{
+		FString view;
+		FString mode;
+		// Megapixels and median of every run
+		TMap<FString, TArray<FVector2D>> pointsPerMetric;
+		TSet<double> megapixels;
+	};
+
+	static const TCHAR* MetricNames[] = { TEXT("FrameTime - ms"), TEXT("GPUTime - ms"), TEXT("Translucency GPU - ms"), TEXT("OIT GPU - ms") };
+
+	TArray<FScalingEntry> entries;
+	for (const FRunResult& result : results)
+	{
+		// Minimal runs only time frames, the full run of the same resolution covers them
+		const FString view = result.GetMetadata(TEXT("ScalingView"));
+		const double renderPixels = FCString::Atod(*result.GetMetadata(TEXT("RenderPixels")));
+		if (view.IsEmpty() || renderPixels <= 0.0 || result.GetMetadata(TEXT("Instrumentation")) == TEXT("Minimal"))
+			continue;
+
+		FScalingEntry* pEntry = entries.FindByPredicate([&](const FScalingEntry& entry) { return entry.view == view && entry.mode == result.mode; });
+		if (!pEntry)
+		{
+			pEntry = &entries.AddDefaulted_GetRef();
+			pEntry->view = view;
+			pEntry->mode = result.mode;
+		}
+
+		const double megapixels = renderPixels / 1.0e6;
+		pEntry->megapixels.Add(megapixels);
+		for (const TCHAR* metricName : MetricNames)
+		{
+			const FMetricResult* pMetric = result.metrics.FindByPredicate([metricName](const FMetricResult& metric) { return metric.name == metricName; });
+			if (pMetric && pMetric->summary.count > 0)
+			{
+				pEntry->pointsPerMetric.FindOrAdd(metricName).Emplace(megapixels, pMetric->summary.p50);
+			}
+		}
+	}
+
+	// 720p and 1080p for the lower-end targets, 2160p for 4K
+	static constexpr double TargetMegapixels[] = { 1280.0 * 720.0 / 1.0e6, 1920.0 * 1080.0 / 1.0e6, 3840.0 * 2160.0 / 1.0e6 };
+
+	FString text;
+	for (const FScalingEntry& entry : entries)
+	{
+		if (entry.megapixels.Num() < 2)
+			continue;
+
+		for (const TCHAR* metricName : MetricNames)
+		{
+			const TArray<FVector2D>* pPoints = entry.pointsPerMetric.Find(metricName);
+			FLinearFit fit;
+			if (!pPoints || !FitLinearCost(*pPoints, fit))
+				continue;
+
+			text += FString::Printf(TEXT("%-24s | %-30s | %-22s | %-4d | %-9.3f | %-9.3f | %-6.3f | %-9.2f | %-9.2f | %.2f\n"),
+				*entry.view, *entry.mode, metricName, pPoints->Num(), fit.perFrame, fit.perMegapixel, fit.rSquared,
+				fit.perFrame + fit.perMegapixel * TargetMegapixels[0], fit.perFrame + fit.perMegapixel * TargetMegapixels[1],
+				fit.perFrame + fit.perMegapixel * TargetMegapixels[2]);
+		}
+	}
+
+	if (text.IsEmpty())
+		return text;
+
+	return TEXT("\nResolution scaling, median cost = per frame + per megapixel * render megapixels\n")
+		TEXT("View                     | Mode                           | Metric                 | Runs | Frame ms  | ms / MP   | R2     | 720p ms   | 1080p ms  | 2160p ms\n")
+		TEXT("-------------------------------------------------------------------------------------------------------------------------------------------------------\n")
+		+ text;
+}
+
+bool BenchmarkReport::WriteSessionReport(const FString& filePath, const TArray<FRunResult>& results)
+{
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(filePath));
+
+	std::ofstream file(TCHAR_TO_UTF8(*filePath));
+	if (!file.is_open())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write session report to %s."), *filePath);
+		return false;
+	}
+
+	// Keep the order runs were measured in, but group them so a scene/mode reads as one block
+	TArray<const FRunResult*> sortedResults;
+	for (const FRunResult& result : results)
+	{
+		sortedResults.Add(&result);
+	}
+	Algo::StableSortBy(sortedResults, [](const FRunResult* pResult) { return pResult->scene + TEXT("|") + pResult->mode; });
+
+	file << "Benchmark session: " << results.Num() << " runs\n";
+	if (results.Num() > 0)
+	{
+		for (const TCHAR* key : { TEXT("Project"), TEXT("BuildVersion"), TEXT("BuildConfiguration"), TEXT("RHI"), TEXT("GPU"), TEXT("Profile") })
+		{
+			file << TCHAR_TO_UTF8(key) << ": " << TCHAR_TO_UTF8(*results[0].GetMetadata(key)) << '\n';
+		}
+	}
+
+	for (const FRunResult* pResult : sortedResults)
+	{
+		file << "\n== " << TCHAR_TO_UTF8(*pResult->scene) << " | " << TCHAR_TO_UTF8(*pResult->mode)
+			<< " | Position " << TCHAR_TO_UTF8(*pResult->GetMetadata(TEXT("Position")));
+		if (const FString slice = pResult->GetMetadata(TEXT("Slice")); !slice.IsEmpty())
+		{
+			file << " | Slice " << TCHAR_TO_UTF8(*slice);
+		}
+		if (const FString resolution = pResult->GetMetadata(TEXT("RenderResolution")); !resolution.IsEmpty())
+		{
+			file << " | " << TCHAR_TO_UTF8(*pResult->GetMetadata(TEXT("ScreenPercentage"))) << "% (" << TCHAR_TO_UTF8(*resolution) << ")";
+		}
+		if (pResult->GetMetadata(TEXT("Instrumentation")) == TEXT("Minimal"))
+		{
+			file << " | Minimal instrumentation";
+		}
+		file << " ==\n";
+		file << TCHAR_TO_UTF8(*FormatStatsHeader());
+		for (const FMetricResult& metric : pResult->metrics)
+		{
+			file << TCHAR_TO_UTF8(*FormatStatsRow(metric));
+		}
+		file << TCHAR_TO_UTF8(*FormatPathSegments(pResult->pathSegments));
+		file << TCHAR_TO_UTF8(*FormatHitches(pResult->hitches, false));
+		file << TCHAR_TO_UTF8(*FormatQuality(pResult->quality));
+		file << TCHAR_TO_UTF8(*FormatOverdraw(*pResult));
+
+		// Loading and precaching happen before the tracked window, their hitches are listed on their own
+		for (const TCHAR* key : { TEXT("LevelLoad"), TEXT("Precache"), TEXT("PreloadNextLevel") })
+		{
+			if (const FString value = pResult->GetMetadata(key); !value.IsEmpty())
+			{
+				file << TCHAR_TO_UTF8(key) << ": " << TCHAR_TO_UTF8(*value) << '\n';
+			}
+		}
+		if (pResult->numDroppedTraceFrames > 0)
+		{
+			file << "Trace dropped " << pResult->numDroppedTraceFrames << " frames\n";
+		}
+	}
+	file << TCHAR_TO_UTF8(*FormatParetoTables(results));
+	file << TCHAR_TO_UTF8(*FormatMemoryPerMode(results));
+	file << TCHAR_TO_UTF8(*FormatObserverEffect(results));
+	file << TCHAR_TO_UTF8(*FormatResolutionScaling(results));
+
+	UE_LOG(LogTemp, Log, TEXT("Written session report with %d runs to: %s"), results.Num(), *filePath);
+	return true;
+}
+
+bool BenchmarkReport::WriteSessionJson(const FString& filePath, const TArray<FRunResult>& results)
+{
+	const FString directory = FPaths::GetPath(FPaths::ConvertRelativePathToFull(filePath));
+
+	TArray<TSharedPtr<FJsonValue>> runs;
+	for (const FRunResult& result : results)
+	{
+		const TSharedRef<FJsonObject> pRun = MakeShared<FJsonObject>();
+		pRun->SetStringField(TEXT("name"), result.scene);
+		pRun->SetStringField(TEXT("mode"), result.mode);
+		pRun->SetStringField(TEXT("log"), MakeRelative(FPaths::ConvertRelativePathToFull(result.logFilePath), directory));
+		pRun->SetStringField(TEXT("trace"), result.traceFilePath.IsEmpty() ? FString() : MakeRelative(FPaths::ConvertRelativePathToFull(result.traceFilePath), directory));
+		pRun->SetStringField(TEXT("capture"), result.capturePath.IsEmpty() ? FString() : MakeRelative(FPaths::ConvertRelativePathToFull(result.capturePath), directory));
+		pRun->SetNumberField(TEXT("droppedTraceFrames"), static_cast<double>(result.numDroppedTraceFrames));
+
+		const TSharedRef<FJsonObject> pMetadata = MakeShared<FJsonObject>();
+		for (const TPair<FString, FString>& entry : result.metadata)
+		{
+			pMetadata->SetStringField(entry.Key, entry.Value);
+		}
+		pRun->SetObjectField(TEXT("metadata"), pMetadata);
+		pRun->SetObjectField(TEXT("metrics"), MetricsToJson(result.metrics));
+		pRun->SetObjectField(TEXT("pathSegments"), MetricsToJson(result.pathSegments));
+		pRun->SetObjectField(TEXT("hitches"), HitchesToJson(result.hitches));
+		if (result.overdraw.IsValid())
+		{
+			const TSharedRef<FJsonObject> pOverdraw = OverdrawToJson(result.overdraw);
+			pOverdraw->SetStringField(TEXT("heatmap"), result.overdraw.heatmapPath.IsEmpty() ? FString() : MakeRelative(FPaths::ConvertRelativePathToFull(result.overdraw.heatmapPath), directory));
+			pRun->SetObjectField(TEXT("overdraw"), pOverdraw);
+		}
+
+		if (result.quality.bIsValid)
+		{
+			const TSharedRef<FJsonObject> pQuality = MakeShared<FJsonObject>();
+			pQuality->SetBoolField(TEXT("reference"), result.quality.bIsReference);
+			pQuality->SetNumberField(TEXT("psnr"), result.quality.psnr);
+			pQuality->SetNumberField(TEXT("ssim"), result.quality.ssim);
+			pQuality->SetNumberField(TEXT("flip"), result.quality.flip);
+			pRun->SetObjectField(TEXT("quality"), pQuality);
+		}
+
+		runs.Add(MakeShared<FJsonValueObject>(pRun));
+	}
+
+	const TSharedRef<FJsonObject> pRoot = MakeShared<FJsonObject>();
+	pRoot->SetNumberField(TEXT("version"), SessionJsonVersion);
+	pRoot->SetArrayField(TEXT("runs"), runs);
+
+	FString json;
+	if (!FJsonSerializer::Serialize(pRoot, TJsonWriterFactory<>::Create(&json)) || !FFileHelper::SaveStringToFile(json, *filePath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write session results to %s."), *filePath);
+		return false;
+	}
+
+	return true;
+}
+
+bool BenchmarkReport::ReadSessionJson(const FString& filePath, TArray<FRunResult>& outResults)
+{
+	FString json;
+	TSharedPtr<FJsonObject> pRoot;
+	if (!FFileHelper::LoadFileToString(json, *filePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(json), pRoot) || !pRoot)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not read session results from %s."), *filePath);
+		return false;
+	}
+
+	if (pRoot->GetIntegerField(TEXT("version")) != SessionJsonVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s has an unsupported session results version."), *filePath);
+		return false;
+	}
+
+	const FString directory = FPaths::GetPath(FPaths::ConvertRelativePathToFull(filePath));
+	const TArray<TSharedPtr<FJsonValue>>* pRuns = nullptr;
+	if (!pRoot->TryGetArrayField(TEXT("runs"), pRuns))
+		return false;
+
+	for (const TSharedPtr<FJsonValue>& pRunValue : *pRuns)
+	{
+		const TSharedPtr<FJsonObject>* ppRun = nullptr;
+		if (!pRunValue->TryGetObject(ppRun))
+			continue;
+
+		const FJsonObject& run = **ppRun;
+		FRunResult& result = outResults.AddDefaulted_GetRef();
+		result.scene = run.GetStringField(TEXT("name"));
+		result.mode = run.GetStringField(TEXT("mode"));
+		result.logFilePath = MakeAbsolute(run.GetStringField(TEXT("log")), directory);
+		result.traceFilePath = MakeAbsolute(run.GetStringField(TEXT("trace")), directory);
+		result.capturePath = MakeAbsolute(run.GetStringField(TEXT("capture")), directory);
+		result.numDroppedTraceFrames = static_cast<uint64>(run.GetNumberField(TEXT("droppedTraceFrames")));
+
+		const TSharedPtr<FJsonObject>* ppMetadata = nullptr;
+		if (run.TryGetObjectField(TEXT("metadata"), ppMetadata))
+		{
+			for (const TPair<FString, TSharedPtr<FJsonValue>>& entry : (*ppMetadata)->Values)
+			{
+				result.metadata.Emplace(entry.Key, entry.Value->AsString());
+			}
+		}
+
+		const TSharedPtr<FJsonObject>* ppMetrics = nullptr;
+		if (run.TryGetObjectField(TEXT("metrics"), ppMetrics))
+		{
+			MetricsFromJson(*ppMetrics, result.metrics);
+		}
+		if (run.TryGetObjectField(TEXT("pathSegments"), ppMetrics))
+		{
+			MetricsFromJson(*ppMetrics, result.pathSegments);
+		}
+
+		const TSharedPtr<FJsonObject>* ppHitches = nullptr;
+		if (run.TryGetObjectField(TEXT("hitches"), ppHitches))
+		{
+			HitchesFromJson(**ppHitches, result.hitches);
+		}
+
+		const TSharedPtr<FJsonObject>* ppOverdraw = nullptr;
+		if (run.TryGetObjectField(TEXT("overdraw"), ppOverdraw))
+		{
+			OverdrawFromJson(**ppOverdraw, result.overdraw);
+			result.overdraw.heatmapPath = MakeAbsolute((*ppOverdraw)->GetStringField(TEXT("heatmap")), directory);
+		}
+
+		const TSharedPtr<FJsonObject>* ppQuality = nullptr;
+		if (run.TryGetObjectField(TEXT("quality"), ppQuality))
+		{
+			result.quality.bIsValid = true;
+			result.quality.bIsReference = (*ppQuality)->GetBoolField(TEXT("reference"));
+			result.quality.psnr = (*ppQuality)->GetNumberField(TEXT("psnr"));
+			result.quality.ssim = (*ppQuality)->GetNumberField(TEXT("ssim"));
+			result.quality.flip = (*ppQuality)->GetNumberField(TEXT("flip"));
+		}
+	}
+
+	return true;
+}
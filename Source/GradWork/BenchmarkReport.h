@@ -0,0 +1,67 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FrameTrace.h"
+#include "HitchAnalyzer.h"
+#include "ImageQuality.h"
+#include "OverdrawAnalyzer.h"
+#include "StreamingHistogram.h"
+
+struct FMetricResult
+{
+	FString name;
+	FHistogramSummary summary;
+	bool bHasBudget;
+};
+
+// Everything one tracking window produced, kept in memory for the session report
+struct FRunResult
+{
+	FString scene;
+	FString mode;
+	FFrameTraceMetadata metadata;
+	TArray<FMetricResult> metrics;
+	// Frame time per equal part of the camera path, empty for a static view
+	TArray<FMetricResult> pathSegments;
+	FHitchSummary hitches;
+	// Translucent layers seen from where the run started, invalid when the view was not analyzed
+	FOverdrawSummary overdraw;
+	FString logFilePath;
+	FString traceFilePath;
+	// Screenshot taken at the end of the run and how it compares to the reference mode
+	FString capturePath;
+	FImageQualityResult quality;
+	uint64 numDroppedTraceFrames;
+
+	FString GetMetadata(const FString& key) const;
+};
+
+namespace BenchmarkReport
+{
+	FString FormatStatsHeader();
+	FString FormatStatsRow(const FMetricResult& metric);
+	// Stats header and rows for the path segments, empty when there are none
+	FString FormatPathSegments(const TArray<FMetricResult>& pathSegments);
+	// Hitch counts, clusters and frame pacing, optionally followed by a row per recorded hitch
+	FString FormatHitches(const FHitchSummary& hitches, bool bListHitches);
+	// One line with PSNR, SSIM and FLIP, empty when the run was not compared
+	FString FormatQuality(const FImageQualityResult& quality);
+	// Layer counts of the view and the frame and translucency times divided by the mean layers, empty without an analysis
+	FString FormatOverdraw(const FRunResult& result);
+	// Frame time against FLIP per mode for every captured view, marking the modes no other mode beats on both
+	FString FormatParetoTables(const TArray<FRunResult>& results);
+	// Steady (median of the runs' medians) and peak memory of every memory metric per mode, empty without memory metrics
+	FString FormatMemoryPerMode(const TArray<FRunResult>& results);
+	// Median frame time of fully instrumented against minimally instrumented runs of every view and mode, empty without them
+	FString FormatObserverEffect(const TArray<FRunResult>& results);
+	// Least squares fit of per-frame and per-megapixel cost to the runs of a resolution sweep, per view and mode,
+	// extrapolated to common render resolutions. Empty when no view was measured at two or more resolutions
+	FString FormatResolutionScaling(const TArray<FRunResult>& results);
+
+	// One file with every run of the session, grouped per scene and mode
+	bool WriteSessionReport(const FString& filePath, const TArray<FRunResult>& results);
+
+	// Machine-readable version of the session report, log and trace paths are stored relative to the file
+	bool WriteSessionJson(const FString& filePath, const TArray<FRunResult>& results);
+	bool ReadSessionJson(const FString& filePath, TArray<FRunResult>& outResults);
+}
@@ -0,0 +1,197 @@
+#include "BenchmarkSettings.h"
+
+namespace
+{
+	TArray<FString> ParseList(const TCHAR* commandLine, const TCHAR* key)
+	{
+		FString value;
+		TArray<FString> entries;
+		if (FParse::Value(commandLine, key, value, false))
+		{
+			value.ParseIntoArray(entries, TEXT(","), true);
+		}
+		return entries;
+	}
+}
+
+bool FBenchmarkSettings::ParseCommandLine(const TCHAR* commandLine, const TArray<FName>& defaultScenes, FBenchmarkSettings& outSettings)
+{
+	if (!FParse::Param(commandLine, TEXT("benchmark")))
+		return false;
+
+	outSettings = FBenchmarkSettings();
+
+	// -BenchScenes=A,B, the scenes configured on the player controller when left out
+	for (const FString& scene : ParseList(commandLine, TEXT("BenchScenes=")))
+	{
+		outSettings.scenes.Add(FName(scene.TrimStartAndEnd()));
+	}
+	if (outSettings.scenes.IsEmpty())
+	{
+		outSettings.scenes = defaultScenes;
+	}
+
+	// -BenchModes=odt,oit,raytracing, every mode when left out
+	for (const FString& modeString : ParseList(commandLine, TEXT("BenchModes=")))
+	{
+		EMode mode;
+		if (!TransparencyMode::Parse(modeString, mode))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Unknown benchmark mode '%s'."), *modeString);
+			return false;
+		}
+		outSettings.modes.AddUnique(mode);
+	}
+	if (outSettings.modes.IsEmpty())
+	{
+		outSettings.modes = { EMode::odt, EMode::oit, EMode::raytracing };
+	}
+
+	// -BenchPositions=0,1,path, position 0 when left out. Position "path" plays the scene's camera path and always runs all of it
+	for (const FString& position : ParseList(commandLine, TEXT("BenchPositions=")))
+	{
+		if (position.TrimStartAndEnd().Equals(TEXT("path"), ESearchCase::IgnoreCase))
+		{
+			outSettings.positions.AddUnique(FBenchmarkRun::PathPosition);
+			continue;
+		}
+
+		if (!position.IsNumeric())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Invalid benchmark position '%s'."), *position);
+			return false;
+		}
+		outSettings.positions.AddUnique(FCString::Atoi(*position));
+	}
+	if (outSettings.positions.IsEmpty())
+	{
+		outSettings.positions.Add(0);
+	}
+
+	// 0 waits until frame times are steady, up to BenchMaxWarmup seconds, a positive value is a fixed warm-up
+	FParse::Value(commandLine, TEXT("BenchWarmup="), outSettings.warmupSeconds);
+	FParse::Value(commandLine, TEXT("BenchMaxWarmup="), outSettings.maxWarmupSeconds);
+	// Seconds per slice, a run stops earlier after BenchMinDuration once the 95% intervals on mean and p95 frame time
+	// are within BenchPrecision
+	FParse::Value(commandLine, TEXT("BenchDuration="), outSettings.durationSeconds);
+	FParse::Value(commandLine, TEXT("BenchMinDuration="), outSettings.minDurationSeconds);
+	FParse::Value(commandLine, TEXT("BenchPrecision="), outSettings.targetPrecision);
+	// Rounds per scene and position, each measures the modes in a random order seeded by BenchSeed, so drift hits every mode alike
+	FParse::Value(commandLine, TEXT("BenchSlices="), outSettings.slices);
+	FParse::Value(commandLine, TEXT("BenchSeed="), outSettings.seed);
+	// The camera path is played with a fixed timestep of 1/BenchPathFPS
+	FParse::Value(commandLine, TEXT("BenchPathFPS="), outSettings.pathFrameRate);
+	// Screenshots spread over the tracked window, on top of the one every run ends with
+	FParse::Value(commandLine, TEXT("BenchCaptures="), outSettings.capturesPerRun);
+	outSettings.capturesPerRun = FMath::Max(0, outSettings.capturesPerRun);
+	// A freshly loaded scene renders this many frames in every mode and waits for the PSO precache before the warm-up
+	FParse::Value(commandLine, TEXT("BenchPrecacheFrames="), outSettings.precacheFramesPerMode);
+	outSettings.precacheFramesPerMode = FMath::Max(0, outSettings.precacheFramesPerMode);
+	// Otherwise the next scene loads in the background after the precache, the warm-up waits for that load
+	outSettings.bPreloadLevels = !FParse::Param(commandLine, TEXT("BenchNoPreload"));
+	// A frame is a hitch above BenchHitchBudget ms (0 leaves it out) or above BenchHitchFactor times the median of the
+	// frames before it
+	FParse::Value(commandLine, TEXT("BenchHitchBudget="), outSettings.hitchBudgetMs);
+	FParse::Value(commandLine, TEXT("BenchHitchFactor="), outSettings.hitchMedianMultiplier);
+	outSettings.hitchMedianMultiplier = FMath::Max(1.0, outSettings.hitchMedianMultiplier);
+	// Tracked frames between reads of the memory stats: process, LLM tags with -llm and RHI textures
+	FParse::Value(commandLine, TEXT("BenchMemoryInterval="), outSettings.memorySampleInterval);
+	outSettings.memorySampleInterval = FMath::Max(1, outSettings.memorySampleInterval);
+	// Tracked frames between reads of the RHI resource memory (render targets, OIT buffers, acceleration structures), 0 leaves it out
+	FParse::Value(commandLine, TEXT("BenchResourceInterval="), outSettings.resourceSampleInterval);
+	outSettings.resourceSampleInterval = FMath::Max(0, outSettings.resourceSampleInterval);
+	// Seconds between refreshes of the on-screen progress, 0 hides it
+	FParse::Value(commandLine, TEXT("BenchOnScreenInterval="), outSettings.onScreenInterval);
+	// Every run is measured twice back to back in a random order, fully instrumented and with only the frame time
+	outSettings.bObserverAB = FParse::Param(commandLine, TEXT("BenchObserverAB"));
+	// Columns of rays that count the translucent layers of the view before a run is tracked, 0 leaves it out
+	FParse::Value(commandLine, TEXT("BenchLayerGrid="), outSettings.layerGridWidth);
+	outSettings.layerGridWidth = FMath::Max(0, outSettings.layerGridWidth);
+	// -BenchScreenPercentages=50,100,200 measures every mode at each render resolution, interleaved with the modes of a slice
+	for (const FString& percentage : ParseList(commandLine, TEXT("BenchScreenPercentages=")))
+	{
+		// The same bounds r.ScreenPercentage clamps to
+		const float value = FCString::Atof(*percentage);
+		if (!percentage.IsNumeric() || value < 1.f || value > 400.f)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Invalid benchmark screen percentage '%s', expected 1 to 400."), *percentage);
+			return false;
+		}
+		outSettings.screenPercentages.AddUnique(value);
+	}
+	// Root of the logs and screenshots instead of the project directory
+	FParse::Value(commandLine, TEXT("BenchOutput="), outSettings.outputDirectory);
+	// No GPU timings, RHI counters or screenshots, implied by -nullrhi
+	outSettings.bCPUOnly = GUsingNullRHI || FParse::Param(commandLine, TEXT("BenchCPUOnly"));
+
+	if (outSettings.scenes.IsEmpty() || outSettings.durationSeconds <= 0.f)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Benchmark needs at least one scene and a positive duration."));
+		return false;
+	}
+
+	if (outSettings.warmupSeconds < 0.f || outSettings.targetPrecision < 0.0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Benchmark warm-up and precision cannot be negative."));
+		return false;
+	}
+
+	if (outSettings.slices < 1 || outSettings.pathFrameRate <= 0.f)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Benchmark needs at least one slice per mode and a positive path frame rate."));
+		return false;
+	}
+
+	return true;
+}
+
+TArray<FBenchmarkRun> FBenchmarkSettings::BuildMatrix() const
+{
+	TArray<FBenchmarkRun> runs;
+	// Without a sweep every run keeps the project's screen percentage
+	const TArray<float> percentages = screenPercentages.IsEmpty() ? TArray<float>{ 0.f } : screenPercentages;
+	runs.Reserve(scenes.Num() * positions.Num() * modes.Num() * percentages.Num() * slices * (bObserverAB ? 2 : 1));
+
+	FRandomStream randomStream(seed);
+	TArray<TPair<EMode, float>> order;
+
+	for (const FName& scene : scenes)
+	{
+		for (const int32 position : positions)
+		{
+			for (int32 slice = 0; slice < slices; ++slice)
+			{
+				// Fisher-Yates, seeded so a session can be repeated in the same order
+				// Resolutions are shuffled with the modes, so neither drifts along with the other
+				order.Reset();
+				for (const EMode mode : modes)
+				{
+					for (const float percentage : percentages)
+					{
+						order.Emplace(mode, percentage);
+					}
+				}
+				for (int32 i = order.Num() - 1; i > 0; --i)
+				{
+					order.Swap(i, randomStream.RandRange(0, i));
+				}
+
+				for (const TPair<EMode, float>& entry : order)
+				{
+					if (bObserverAB == false)
+					{
+						runs.Add({ scene, entry.Key, position, slice, entry.Value, false });
+						continue;
+					}
+
+					// Neither instrumentation level always gets the first (or the warmer) slot
+					const bool bIsMinimalFirst = randomStream.RandRange(0, 1) == 1;
+					runs.Add({ scene, entry.Key, position, slice, entry.Value, bIsMinimalFirst });
+					runs.Add({ scene, entry.Key, position, slice, entry.Value, !bIsMinimalFirst });
+				}
+			}
+		}
+	}
+
+	return runs;
+}
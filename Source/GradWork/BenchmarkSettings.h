@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TransparencyMode.h"
+
+struct FBenchmarkRun
+{
+	// Position that plays back the scene's camera path instead of a fixed view
+	static constexpr int32 PathPosition = -1;
+
+	FName scene;
+	EMode mode;
+	int32 position;
+	// Which round of interleaved modes this run belongs to
+	int32 slice;
+	// r.ScreenPercentage of the run, 0 leaves the project setting alone
+	float screenPercentage;
+	// Tracks only the frame time, paired with a fully instrumented run to measure the observer effect
+	bool bIsMinimalInstrumentation;
+};
+
+/**
+ * Unattended benchmark configuration, parsed from the command line when -benchmark is on it.
+ * Every flag is described next to where it is parsed in BenchmarkSettings.cpp.
+ */
+struct FBenchmarkSettings
+{
+	TArray<FName> scenes;
+	TArray<EMode> modes;
+	TArray<int32> positions;
+	float warmupSeconds{ 0.f };
+	float maxWarmupSeconds{ 60.f };
+	float durationSeconds{ 30.f };
+	float minDurationSeconds{ 10.f };
+	double targetPrecision{ 0.01 };
+	int32 slices{ 1 };
+	int32 seed{ 0 };
+	float pathFrameRate{ 60.f };
+	int32 capturesPerRun{ 0 };
+	int32 precacheFramesPerMode{ 30 };
+	bool bPreloadLevels{ true };
+	double hitchBudgetMs{ 0.0 };
+	double hitchMedianMultiplier{ 2.0 };
+	int32 memorySampleInterval{ 30 };
+	int32 resourceSampleInterval{ DefaultResourceSampleInterval };
+	float onScreenInterval{ 0.5f };
+	bool bObserverAB{ false };
+	int32 layerGridWidth{ 160 };
+	TArray<float> screenPercentages;
+	FString outputDirectory;
+	bool bCPUOnly{ false };
+
+	static constexpr int32 DefaultResourceSampleInterval = 120;
+
+	// Returns false when -benchmark is not on the command line or the arguments are invalid
+	static bool ParseCommandLine(const TCHAR* commandLine, const TArray<FName>& defaultScenes, FBenchmarkSettings& outSettings);
+
+	// Scene major, so every scene is only loaded once, then position, then the interleaved mode and resolution slices
+	TArray<FBenchmarkRun> BuildMatrix() const;
+};
@@ -0,0 +1,212 @@
+#include "BenchmarkSubsystem.h"
+
+#include "FrameMetrics.h"
+#include "ImageQuality.h"
+#include "Kismet/GameplayStatics.h"
+#include "LiveTelemetry.h"
+#include "Misc/PackageName.h"
+#include "PerformanceLogger.h"
+#include "ScreenshotCapture.h"
+#include "TransparencyMode.h"
+
+void UBenchmarkSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	m_SessionStart = FDateTime::Now();
+
+	// Names and duration are set per level by the player controller
+	m_pPerformanceLogger = MakeUnique<FPerformanceLogger>(30.f, 0.1f, TEXT("Unnamed"), TEXT("Unnamed"));
+	m_pPerformanceLogger->SetOnRunFinished([this](FRunResult&& result)
+	{
+		m_Results.Add(MoveTemp(result));
+	});
+
+	m_pScreenshotCapture = MakeUnique<FScreenshotCapture>();
+
+	// -LiveTelemetry or -LiveTelemetry=<segment>, watched with -run=LiveTelemetry from another process
+	FString telemetryName = LiveTelemetry::DefaultName;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LiveTelemetry="), telemetryName) || FParse::Param(FCommandLine::Get(), TEXT("LiveTelemetry")))
+	{
+		m_pPerformanceLogger->EnableLiveTelemetry(telemetryName);
+	}
+
+	// Only resources created after this are tracked, so it has to happen before the first benchmark level loads
+	int32 resourceSampleInterval = FBenchmarkSettings::DefaultResourceSampleInterval;
+	FParse::Value(FCommandLine::Get(), TEXT("BenchResourceInterval="), resourceSampleInterval);
+	if (FParse::Param(FCommandLine::Get(), TEXT("benchmark")) && resourceSampleInterval > 0)
+	{
+		FrameMetrics::StartResourceTracking();
+	}
+}
+
+void UBenchmarkSubsystem::Deinitialize()
+{
+	m_pPerformanceLogger->StopTracking();
+	WriteSessionReport();
+	m_pPerformanceLogger.Reset();
+	m_pScreenshotCapture.Reset();
+
+	Super::Deinitialize();
+}
+
+void UBenchmarkSubsystem::OpenLevel(const UObject* pWorldContext, const FName levelName)
+{
+	m_OpenLevelTime = FPlatformTime::Seconds();
+	m_bIsOpeningPreloaded = levelName == m_PreloadedLevel;
+	UGameplayStatics::OpenLevel(pWorldContext, levelName);
+}
+
+void UBenchmarkSubsystem::OnLevelOpened(const FName levelName)
+{
+	if (m_OpenLevelTime > 0.0)
+	{
+		const double loadSeconds = FPlatformTime::Seconds() - m_OpenLevelTime;
+		m_pPerformanceLogger->SetTraceMetadata("LevelLoad", FString::Printf(TEXT("%.2f s (%s)"), loadSeconds, m_bIsOpeningPreloaded ? TEXT("preloaded") : TEXT("cold")));
+		UE_LOG(LogTemp, Log, TEXT("Opened %s in %.2f s%s."), *levelName.ToString(), loadSeconds, m_bIsOpeningPreloaded ? TEXT(", preloaded") : TEXT(""));
+		m_OpenLevelTime = 0.0;
+	}
+
+	// The engine owns the world now
+	if (levelName == m_PreloadedLevel)
+	{
+		m_pPreloadedWorld = nullptr;
+		m_PreloadedLevel = NAME_None;
+	}
+}
+
+void UBenchmarkSubsystem::PreloadLevel(const FName levelName)
+{
+	if (levelName.IsNone() || levelName == m_PreloadedLevel || levelName == m_PreloadingLevel)
+		return;
+
+	// PIE worlds are duplicated under their own package names, a preloaded package would never be used
+	if (GIsEditor)
+		return;
+
+	FString packageName = levelName.ToString();
+	if (FPackageName::IsShortPackageName(packageName) && !FPackageName::SearchForPackageOnDisk(packageName, &packageName))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cannot preload %s, the package does not exist."), *levelName.ToString());
+		return;
+	}
+
+	// Only one preloaded level at a time, the previous one is no longer needed
+	m_pPreloadedWorld = nullptr;
+	m_PreloadedLevel = NAME_None;
+	m_PreloadingLevel = levelName;
+	m_PreloadStartTime = FPlatformTime::Seconds();
+
+	LoadPackageAsync(packageName, FLoadPackageAsyncDelegate::CreateWeakLambda(this, [this, levelName](const FName&, UPackage* pPackage, const EAsyncLoadingResult::Type result)
+	{
+		if (levelName != m_PreloadingLevel)
+			return;
+
+		m_PreloadingLevel = NAME_None;
+		UWorld* pWorld = pPackage && result == EAsyncLoadingResult::Succeeded ? UWorld::FindWorldInPackage(pPackage) : nullptr;
+		if (!pWorld)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Preloading %s failed, it will be loaded when it is opened."), *levelName.ToString());
+			return;
+		}
+
+		m_pPreloadedWorld = pWorld;
+		m_PreloadedLevel = levelName;
+		UE_LOG(LogTemp, Log, TEXT("Preloaded %s in %.2f s."), *levelName.ToString(), FPlatformTime::Seconds() - m_PreloadStartTime);
+	}));
+}
+
+void UBenchmarkSubsystem::SetLastRunCapture(const FString& filePath)
+{
+	if (!m_Results.IsEmpty())
+	{
+		m_Results.Last().capturePath = filePath;
+	}
+}
+
+void UBenchmarkSubsystem::WriteSessionReport()
+{
+	if (m_NumReportedResults == m_Results.Num())
+		return;
+
+	CompareCaptures();
+
+	const FString& outputDirectory = m_SessionState.settings.outputDirectory;
+	const FString root = outputDirectory.IsEmpty() ? FPaths::ProjectDir() / "PerformanceLogs" : outputDirectory;
+	const FString filePath = root / m_SessionStart.ToString(TEXT("%Y-%m-%d")) / FString::Printf(TEXT("Session_%s.txt"), *m_SessionStart.ToString(TEXT("%H-%M-%S")));
+
+	if (BenchmarkReport::WriteSessionReport(filePath, m_Results) && BenchmarkReport::WriteSessionJson(FPaths::ChangeExtension(filePath, TEXT("json")), m_Results))
+	{
+		m_NumReportedResults = m_Results.Num();
+	}
+}
+
+void UBenchmarkSubsystem::CompareCaptures()
+{
+	const FString referenceMode = TransparencyMode::GetDisplayString(EMode::raytracing);
+	const double startTime = FPlatformTime::Seconds();
+	int32 numCompared = 0;
+
+	// Slices of a view overwrite the same capture, each file is compared once
+	TMap<FString, FImageQualityResult> comparedCaptures;
+
+	for (int32 i = m_NumReportedResults; i < m_Results.Num(); ++i)
+	{
+		FRunResult& result = m_Results[i];
+		if (result.capturePath.IsEmpty() || result.quality.bIsValid)
+			continue;
+
+		if (result.mode == referenceMode)
+		{
+			result.quality.bIsValid = true;
+			result.quality.bIsReference = true;
+			result.quality.psnr = ImageQuality::MaxPSNR;
+			result.quality.ssim = 1.0;
+			result.quality.flip = 0.0;
+			continue;
+		}
+
+		if (const FImageQualityResult* pCompared = comparedCaptures.Find(result.capturePath))
+		{
+			result.quality = *pCompared;
+			continue;
+		}
+
+		// Every mode captures a view under the same file name in its own folder
+		const FString fileName = FPaths::GetCleanFilename(result.capturePath);
+		const FRunResult* pReference = m_Results.FindByPredicate([&referenceMode, &fileName](const FRunResult& other)
+		{
+			return other.mode == referenceMode && FPaths::GetCleanFilename(other.capturePath) == fileName;
+		});
+		if (!pReference)
+			continue;
+
+		FQualityImage referenceImage;
+		FQualityImage testImage;
+		if (!ImageQuality::LoadImage(pReference->capturePath, referenceImage) || !ImageQuality::LoadImage(result.capturePath, testImage))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Cannot compare %s, one of the captures could not be read."), *result.capturePath);
+			continue;
+		}
+
+		TArray<float> flipMap;
+		TArray<float> ssimErrorMap;
+		if (!ImageQuality::Compare(referenceImage, testImage, result.quality, &flipMap, &ssimErrorMap))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Cannot compare %s, the reference capture has a different size."), *result.capturePath);
+			continue;
+		}
+
+		const FString basePath = FPaths::GetBaseFilename(result.capturePath, false);
+		ImageQuality::WriteHeatmap(basePath + TEXT("_flip.png"), flipMap, testImage.width, testImage.height);
+		ImageQuality::WriteHeatmap(basePath + TEXT("_ssim.png"), ssimErrorMap, testImage.width, testImage.height);
+
+		comparedCaptures.Add(result.capturePath, result.quality);
+		++numCompared;
+	}
+
+	if (numCompared > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Compared %d captures against %s in %.2f s."), numCompared, *referenceMode, FPlatformTime::Seconds() - startTime);
+	}
+}
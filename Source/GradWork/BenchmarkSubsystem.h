@@ -0,0 +1,82 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "BenchmarkReport.h"
+#include "BenchmarkSettings.h"
+#include "BenchmarkSubsystem.generated.h"
+
+class FPerformanceLogger;
+class FScreenshotCapture;
+
+// State of the automated runs that has to survive OpenLevel
+struct FBenchmarkSessionState
+{
+	bool bIsSimulating{ false };
+	int32 currentScene{ -1 };
+
+	bool bHasParsedCommandLine{ false };
+	bool bIsBenchmarking{ false };
+	bool bIsAwaitingLevel{ false };
+	FBenchmarkSettings settings;
+	TArray<FBenchmarkRun> runs;
+	int32 currentRun{ 0 };
+	int32 numFailedRuns{ 0 };
+	// r.ScreenPercentage from before a sweep run overrode it, 0 while it is not overridden
+	float savedScreenPercentage{ 0 };
+};
+
+/**
+ * Owns the performance logger for the lifetime of the game instance, so it is not rebuilt on every level load,
+ * and collects the result of every tracked window into one session report.
+ */
+UCLASS()
+class GRADWORK_API UBenchmarkSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	FPerformanceLogger& GetPerformanceLogger() const { return *m_pPerformanceLogger; }
+	FScreenshotCapture& GetScreenshotCapture() const { return *m_pScreenshotCapture; }
+	FBenchmarkSessionState& GetSessionState() { return m_SessionState; }
+	const TArray<FRunResult>& GetResults() const { return m_Results; }
+
+	// OpenLevel that records how long the level takes to open and whether it was preloaded
+	void OpenLevel(const UObject* pWorldContext, FName levelName);
+	// From BeginPlay of the opened level, adds the load time to the trace metadata and lets go of the preload
+	void OnLevelOpened(FName levelName);
+
+	// Loads the level's package in the background, a later OpenLevel finds it in memory instead of reading it from disk
+	void PreloadLevel(FName levelName);
+	bool IsPreloading() const { return !m_PreloadingLevel.IsNone(); }
+
+	// Screenshot of the run that finished last, compared against the reference mode when the report is written
+	void SetLastRunCapture(const FString& filePath);
+
+	// Writes every result collected since the last report, also happens automatically on shutdown
+	void WriteSessionReport();
+
+private:
+	TUniquePtr<FPerformanceLogger> m_pPerformanceLogger;
+	TUniquePtr<FScreenshotCapture> m_pScreenshotCapture;
+	FBenchmarkSessionState m_SessionState;
+
+	TArray<FRunResult> m_Results;
+	int32 m_NumReportedResults{ 0 };
+	FDateTime m_SessionStart;
+
+	// Keeps the preloaded world alive until OpenLevel takes it over
+	UPROPERTY()
+	TObjectPtr<UWorld> m_pPreloadedWorld;
+	FName m_PreloadedLevel;
+	FName m_PreloadingLevel;
+	double m_PreloadStartTime{ 0 };
+	double m_OpenLevelTime{ 0 };
+	bool m_bIsOpeningPreloaded{ false };
+
+	// Every capture has to be written by then, the players wait for them before moving on
+	void CompareCaptures();
+};
@@ -0,0 +1,98 @@
+#include "CameraPath.h"
+
+#include "Algo/BinarySearch.h"
+#include "Components/SplineComponent.h"
+#include "HAL/PlatformFileManager.h"
+#include <fstream>
+
+void FCameraPath::AddKey(const float time, const FTransform& transform)
+{
+	// Keys have to stay sorted for the binary search in Evaluate
+	if (!m_Keys.IsEmpty() && time <= m_Keys.Last().time)
+		return;
+
+	m_Keys.Add({ time, transform });
+}
+
+FTransform FCameraPath::Evaluate(const float time) const
+{
+	if (m_Keys.IsEmpty())
+		return FTransform::Identity;
+
+	if (time <= m_Keys[0].time)
+		return m_Keys[0].transform;
+	if (time >= m_Keys.Last().time)
+		return m_Keys.Last().transform;
+
+	const int32 next = Algo::UpperBoundBy(m_Keys, time, [](const FCameraPathKey& key) { return key.time; });
+	const FCameraPathKey& from = m_Keys[next - 1];
+	const FCameraPathKey& to = m_Keys[next];
+	const float alpha = (time - from.time) / (to.time - from.time);
+
+	return FTransform(
+		FQuat::Slerp(from.transform.GetRotation(), to.transform.GetRotation(), alpha),
+		FMath::Lerp(from.transform.GetLocation(), to.transform.GetLocation(), static_cast<double>(alpha)),
+		FMath::Lerp(from.transform.GetScale3D(), to.transform.GetScale3D(), static_cast<double>(alpha)));
+}
+
+bool FCameraPath::LoadFromFile(const FString& filePath)
+{
+	Reset();
+
+	std::ifstream file(TCHAR_TO_UTF8(*filePath));
+	if (!file.is_open())
+		return false;
+
+	float time;
+	double x, y, z, qx, qy, qz, qw;
+	while (file >> time >> x >> y >> z >> qx >> qy >> qz >> qw)
+	{
+		AddKey(time, FTransform(FQuat(qx, qy, qz, qw).GetNormalized(), FVector(x, y, z)));
+	}
+
+	return !IsEmpty();
+}
+
+bool FCameraPath::SaveToFile(const FString& filePath) const
+{
+	FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*FPaths::GetPath(filePath));
+
+	std::ofstream file(TCHAR_TO_UTF8(*filePath));
+	if (!file.is_open())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not save camera path to %s."), *filePath);
+		return false;
+	}
+
+	file.precision(9);
+	for (const FCameraPathKey& key : m_Keys)
+	{
+		const FVector location = key.transform.GetLocation();
+		const FQuat rotation = key.transform.GetRotation();
+		file << key.time << ' ' << location.X << ' ' << location.Y << ' ' << location.Z << ' '
+			<< rotation.X << ' ' << rotation.Y << ' ' << rotation.Z << ' ' << rotation.W << '\n';
+	}
+
+	return true;
+}
+
+FCameraPath FCameraPath::FromSpline(const USplineComponent& spline, const float durationSeconds, const float keysPerSecond)
+{
+	FCameraPath path;
+	const int32 numKeys = FMath::Max(2, FMath::CeilToInt(durationSeconds * keysPerSecond) + 1);
+	const float splineDuration = spline.Duration;
+
+	for (int32 i = 0; i < numKeys; ++i)
+	{
+		const float time = durationSeconds * static_cast<float>(i) / static_cast<float>(numKeys - 1);
+		const float splineTime = splineDuration * static_cast<float>(i) / static_cast<float>(numKeys - 1);
+		path.AddKey(time, spline.GetTransformAtTime(splineTime, ESplineCoordinateSpace::World, true, false));
+	}
+
+	return path;
+}
+
+FString FCameraPath::GetRecordingPath(const FString& sceneName)
+{
+	return FPaths::ProjectDir() / TEXT("CameraPaths") / sceneName + TEXT(".txt");
+}
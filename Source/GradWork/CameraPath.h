@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+class USplineComponent;
+
+struct FCameraPathKey
+{
+	float time;
+	FTransform transform;
+};
+
+/**
+ * Timed camera transforms, either recorded while flying through a level or sampled from a spline.
+ * Played back with a fixed timestep every run evaluates the path at the same times, so it renders the same frames.
+ * Saved as text, one key per line: time, location xyz, rotation quaternion xyzw.
+ */
+class FCameraPath final
+{
+public:
+	void Reset() { m_Keys.Reset(); }
+	void AddKey(float time, const FTransform& transform);
+
+	bool IsEmpty() const { return m_Keys.IsEmpty(); }
+	float GetDuration() const { return m_Keys.IsEmpty() ? 0.f : m_Keys.Last().time; }
+
+	// Location is interpolated linearly, rotation spherically, times outside the path are clamped
+	FTransform Evaluate(float time) const;
+
+	bool LoadFromFile(const FString& filePath);
+	bool SaveToFile(const FString& filePath) const;
+
+	// Keys at a fixed rate along the spline, with the camera looking along its tangent unless the spline rotates it
+	static FCameraPath FromSpline(const USplineComponent& spline, float durationSeconds, float keysPerSecond = 30.f);
+	// <Project>/CameraPaths/<scene>.txt
+	static FString GetRecordingPath(const FString& sceneName);
+
+private:
+	TArray<FCameraPathKey> m_Keys;
+};
@@ -0,0 +1,16 @@
+#include "CameraPathActor.h"
+
+#include "Components/SplineComponent.h"
+
+ACameraPathActor::ACameraPathActor()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	m_pSpline = CreateDefaultSubobject<USplineComponent>(TEXT("Spline"));
+	SetRootComponent(m_pSpline);
+}
+
+FCameraPath ACameraPathActor::BuildPath() const
+{
+	return FCameraPath::FromSpline(*m_pSpline, m_DurationSeconds);
+}
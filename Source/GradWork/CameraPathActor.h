@@ -0,0 +1,30 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "CameraPath.h"
+#include "CameraPathActor.generated.h"
+
+class USplineComponent;
+
+/**
+ * Spline flythrough placed in a level, the benchmark plays it back for position "path".
+ * Takes precedence over a recorded path for the same scene.
+ */
+UCLASS()
+class GRADWORK_API ACameraPathActor : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ACameraPathActor();
+
+	FCameraPath BuildPath() const;
+
+private:
+	UPROPERTY(VisibleAnywhere, DisplayName="Spline")
+	USplineComponent* m_pSpline{ nullptr };
+
+	UPROPERTY(EditAnywhere, DisplayName="Duration", meta=(ClampMin=1))
+	float m_DurationSeconds{ 30.f };
+};
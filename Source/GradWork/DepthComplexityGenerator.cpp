@@ -0,0 +1,157 @@
+#include "DepthComplexityGenerator.h"
+
+#include "Async/ParallelFor.h"
+
+namespace
+{
+	// Edge length of /Engine/BasicShapes/Cube at scale 1
+	constexpr float CubeEdge = 100.f;
+
+	constexpr int32 GridWidth = 64;
+	constexpr int32 GridHeight = 36;
+	constexpr int32 MaxLimitIterations = 4;
+
+	// Screen footprint of a cube in tangent space (x = right / forward, y = up / forward)
+	struct FFootprint
+	{
+		float centerX;
+		float centerY;
+		// Projected area at size 1, an axis aligned cube seen along d covers edge^2 * (|dx| + |dy| + |dz|)
+		float unitArea;
+	};
+
+	float EstimateMaxLayers(const TArray<FFootprint>& footprints, const float sizeScale, const float tanHalfWidth, const float tanHalfHeight)
+	{
+		const float tileWidth = 2.f * tanHalfWidth / GridWidth;
+		const float tileHeight = 2.f * tanHalfHeight / GridHeight;
+		const float tileArea = tileWidth * tileHeight;
+		const float areaScale = sizeScale * sizeScale;
+
+		TArray<float> rowMax;
+		rowMax.SetNumZeroed(GridHeight);
+
+		ParallelFor(GridHeight, [&](const int32 row)
+		{
+			float layers[GridWidth] = {};
+			const float rowMin = -tanHalfHeight + row * tileHeight;
+			const float rowMaxY = rowMin + tileHeight;
+
+			for (const FFootprint& footprint : footprints)
+			{
+				// Square with the same area as the projected cube
+				const float halfSide = 0.5f * FMath::Sqrt(footprint.unitArea * areaScale);
+				const float overlapY = FMath::Min(rowMaxY, footprint.centerY + halfSide) - FMath::Max(rowMin, footprint.centerY - halfSide);
+				if (overlapY <= 0.f)
+					continue;
+
+				const float left = footprint.centerX - halfSide;
+				const float right = footprint.centerX + halfSide;
+				const int32 firstColumn = FMath::Clamp(FMath::FloorToInt((left + tanHalfWidth) / tileWidth), 0, GridWidth - 1);
+				const int32 lastColumn = FMath::Clamp(FMath::FloorToInt((right + tanHalfWidth) / tileWidth), 0, GridWidth - 1);
+				for (int32 column = firstColumn; column <= lastColumn; ++column)
+				{
+					const float columnMin = -tanHalfWidth + column * tileWidth;
+					const float overlapX = FMath::Min(columnMin + tileWidth, right) - FMath::Max(columnMin, left);
+					if (overlapX > 0.f)
+						layers[column] += overlapX * overlapY / tileArea;
+				}
+			}
+
+			rowMax[row] = *std::max_element(std::begin(layers), std::end(layers));
+		});
+
+		return *std::max_element(rowMax.begin(), rowMax.end());
+	}
+}
+
+FString FDepthComplexityParams::ToString() const
+{
+	return FString::Printf(TEXT("seed %d, %d cubes, layers %.2f (max %.2f), coverage %.2f, distance %.0f-%.0f, size %.2f-%.2f ^%.2f"),
+		seed, cubeCount, targetAverageLayers, maxLayers, screenCoverage, minDistance, maxDistance, minSize, maxSize, sizeExponent);
+}
+
+void DepthComplexity::ParseCommandLine(const TCHAR* commandLine, FDepthComplexityParams& params)
+{
+	FParse::Value(commandLine, TEXT("CubeCount="), params.cubeCount);
+	FParse::Value(commandLine, TEXT("CubeSeed="), params.seed);
+	FParse::Value(commandLine, TEXT("CubeLayers="), params.targetAverageLayers);
+	FParse::Value(commandLine, TEXT("CubeMaxLayers="), params.maxLayers);
+	FParse::Value(commandLine, TEXT("CubeCoverage="), params.screenCoverage);
+	params.cubeCount = FMath::Max(1, params.cubeCount);
+}
+
+FDepthComplexityLayout DepthComplexity::Generate(const FDepthComplexityParams& params, const float horizontalFov, const float aspectRatio)
+{
+	FDepthComplexityLayout layout;
+	const int32 cubeCount = FMath::Max(1, params.cubeCount);
+
+	const float tanHalfWidth = FMath::Tan(FMath::DegreesToRadians(horizontalFov * 0.5f));
+	const float tanHalfHeight = tanHalfWidth / aspectRatio;
+	const float coverage = FMath::Clamp(params.screenCoverage, 0.01f, 1.f);
+	const float coverageScale = FMath::Sqrt(coverage);
+
+	TArray<FVector> locations;
+	TArray<float> relativeSizes;
+	TArray<FFootprint> footprints;
+	locations.SetNumUninitialized(cubeCount);
+	relativeSizes.SetNumUninitialized(cubeCount);
+	footprints.SetNumUninitialized(cubeCount);
+	layout.colors.SetNumUninitialized(cubeCount);
+
+	ParallelFor(cubeCount, [&](const int32 i)
+	{
+		FRandomStream randomStream(static_cast<int32>(HashCombine(GetTypeHash(params.seed), GetTypeHash(i))));
+
+		// Uniform over the covered part of the screen
+		const float screenX = randomStream.FRandRange(-1.f, 1.f) * tanHalfWidth * coverageScale;
+		const float screenY = randomStream.FRandRange(-1.f, 1.f) * tanHalfHeight * coverageScale;
+
+		// Square root distribution, more cubes further away
+		const float distance = FMath::Lerp(params.minDistance, params.maxDistance, FMath::Sqrt(randomStream.FRand()));
+		const FVector direction = FVector(1.f, screenX, screenY).GetSafeNormal();
+		locations[i] = direction * distance;
+
+		relativeSizes[i] = FMath::Lerp(params.minSize, params.maxSize, FMath::Pow(randomStream.FRand(), params.sizeExponent));
+
+		const float depth = static_cast<float>(locations[i].X);
+		const float edge = CubeEdge * relativeSizes[i];
+		const float silhouette = static_cast<float>(FMath::Abs(direction.X) + FMath::Abs(direction.Y) + FMath::Abs(direction.Z));
+		footprints[i] = { screenX, screenY, edge * edge * silhouette / (depth * depth) };
+
+		// Brightened, like the material expects
+		layout.colors[i] = FLinearColor::MakeFromHSV8(static_cast<uint8>(randomStream.RandRange(0, 255)), 255, 255) * 1.5f;
+	});
+
+	// Summed in order, a parallel reduction would make the result depend on scheduling
+	double totalUnitArea = 0.0;
+	for (const FFootprint& footprint : footprints)
+	{
+		totalUnitArea += footprint.unitArea;
+	}
+
+	const double coveredArea = 4.0 * tanHalfWidth * tanHalfHeight * coverage;
+	float sizeScale = 1.f;
+	if (params.targetAverageLayers > 0.f && totalUnitArea > 0.0)
+	{
+		sizeScale = static_cast<float>(FMath::Sqrt(params.targetAverageLayers * coveredArea / totalUnitArea));
+	}
+
+	float maxLayers = EstimateMaxLayers(footprints, sizeScale, tanHalfWidth, tanHalfHeight);
+	for (int32 i = 0; i < MaxLimitIterations && params.maxLayers > 0.f && maxLayers > params.maxLayers; ++i)
+	{
+		// Lowers the average too, the achieved values end up in the layout
+		sizeScale *= FMath::Sqrt(params.maxLayers / maxLayers);
+		maxLayers = EstimateMaxLayers(footprints, sizeScale, tanHalfWidth, tanHalfHeight);
+	}
+
+	layout.estimatedAverageLayers = static_cast<float>(totalUnitArea * sizeScale * sizeScale / coveredArea);
+	layout.estimatedMaxLayers = maxLayers;
+
+	layout.transforms.SetNumUninitialized(cubeCount);
+	ParallelFor(cubeCount, [&](const int32 i)
+	{
+		layout.transforms[i] = FTransform(FQuat::Identity, locations[i], FVector(relativeSizes[i] * sizeScale));
+	});
+
+	return layout;
+}
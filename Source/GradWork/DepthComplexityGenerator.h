@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DepthComplexityGenerator.generated.h"
+
+// Everything that shapes the transparency stress scene, the same parameters always give the same cubes
+USTRUCT()
+struct FDepthComplexityParams
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	int32 seed{ 1 };
+	UPROPERTY(EditAnywhere, meta=(ClampMin=1))
+	int32 cubeCount{ 2500 };
+
+	// Average translucent layers over the covered part of the screen, cube sizes are scaled to reach it. 0 keeps the sizes as they are
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0))
+	float targetAverageLayers{ 0.f };
+	// Cubes are shrunk until no region of the screen has more layers than this. 0 disables the limit
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0))
+	float maxLayers{ 0.f };
+	// Fraction of the view, centered, that the cubes are placed in
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0.01, ClampMax=1))
+	float screenCoverage{ 1.f };
+
+	UPROPERTY(EditAnywhere)
+	float minDistance{ 1000.f };
+	UPROPERTY(EditAnywhere)
+	float maxDistance{ 7500.f };
+
+	// Relative cube sizes, skewed towards the minimum for an exponent above 1
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0.01))
+	float minSize{ 1.f };
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0.01))
+	float maxSize{ 1.f };
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0.01))
+	float sizeExponent{ 1.f };
+
+	FString ToString() const;
+};
+
+struct FDepthComplexityLayout
+{
+	TArray<FTransform> transforms;
+	TArray<FLinearColor> colors;
+	// Estimated on a coarse screen grid, so the maximum is averaged over a tile rather than per pixel
+	float estimatedAverageLayers{ 0.f };
+	float estimatedMaxLayers{ 0.f };
+};
+
+namespace DepthComplexity
+{
+	// Places the cubes in front of the origin, looking down +X. Every cube draws from its own seeded stream, so the
+	// placement is computed with ParallelFor and still does not depend on scheduling
+	FDepthComplexityLayout Generate(const FDepthComplexityParams& params, float horizontalFov = 90.f, float aspectRatio = 16.f / 9.f);
+
+	// -CubeCount=<n> -CubeSeed=<n> -CubeLayers=<avg> -CubeMaxLayers=<max> -CubeCoverage=<0-1>, missing values are left as they are
+	void ParseCommandLine(const TCHAR* commandLine, FDepthComplexityParams& params);
+}
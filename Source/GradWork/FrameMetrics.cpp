@@ -0,0 +1,73 @@
+#include "FrameMetrics.h"
+
+#include "HAL/LowLevelMemTracker.h"
+
+double FrameMetrics::GetLLMTagMemoryMB(const ELLMMemory tag)
+{
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (!FLowLevelMemTracker::IsEnabled())
+		return -1.0;
+
+	static constexpr ELLMTag Tags[] = { ELLMTag::TrackedTotal, ELLMTag::RenderTargets, ELLMTag::SceneRender, ELLMTag::RHIMisc, ELLMTag::Textures };
+	return FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, Tags[static_cast<int32>(tag)]) / BytesPerMB;
+#else
+	return -1.0;
+#endif
+}
+
+double FrameMetrics::GetTextureMemoryMB()
+{
+	if (GUsingNullRHI)
+		return -1.0;
+
+	FTextureMemoryStats stats;
+	RHIGetTextureMemoryStats(stats);
+	return (stats.StreamingMemorySize + stats.NonStreamingMemorySize) / BytesPerMB;
+}
+
+void FrameMetrics::StartResourceTracking()
+{
+#if RHI_ENABLE_RESOURCE_INFO
+	FRHIResource::StartTrackingAllResources();
+#endif
+}
+
+void FrameMetrics::GatherResourceMemory(int64 (&outBytes)[static_cast<int32>(EResourceMemory::Count)])
+{
+#if RHI_ENABLE_RESOURCE_INFO
+	TArray<TSharedPtr<FRHIResourceStats>> resources;
+	RHIGetTrackedResourceStats(resources);
+
+	for (int64& bytes : outBytes)
+	{
+		bytes = 0;
+	}
+
+	TStringBuilder<128> name;
+	for (const TSharedPtr<FRHIResourceStats>& pResource : resources)
+	{
+		if (!pResource || pResource->bMarkedForDelete)
+			continue;
+
+		const int64 size = static_cast<int64>(pResource->SizeInBytes);
+		outBytes[static_cast<int32>(EResourceMemory::Total)] += size;
+
+		// The OIT passes name their RDG textures OIT.*, pooled textures keep the name they were first allocated with
+		name.Reset();
+		pResource->Name.AppendString(name);
+		if (name.ToView().StartsWith(TEXT("OIT")))
+		{
+			outBytes[static_cast<int32>(EResourceMemory::OIT)] += size;
+		}
+		else if (pResource->bRenderTarget || pResource->bDepthStencil)
+		{
+			outBytes[static_cast<int32>(EResourceMemory::RenderTargets)] += size;
+		}
+
+		if (pResource->bRayTracingAccelerationStructure)
+		{
+			outBytes[static_cast<int32>(EResourceMemory::RayTracing)] += size;
+		}
+	}
+#endif
+}
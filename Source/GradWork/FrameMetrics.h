@@ -0,0 +1,279 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GPUPassTimings.h"
+#include "MetricSchema.h"
+#include "RenderCore.h"
+#include "RenderStatsRing.h"
+#include "RHI.h"
+
+// What the game thread samplers read, gathered once per tracked frame
+struct FFrameContext
+{
+	uint64 frameNumber;
+	double frameTime;
+	double pathProgress;
+	// -1 for passes that are not measured
+	double gpuPassTimes[FGPUPassTimings::NumPasses];
+	// Only read on the frames the periodic metrics are sampled
+	FPlatformMemoryStats memoryStats;
+	double loggerTime;
+	// Reported by the scene, -1 when it does not sort its instances
+	double instanceSortTime;
+	double instanceUploadKB;
+};
+
+/**
+ * Every column of a tracked frame. A metric declares its value type, how it is named and aggregated, how often it is
+ * sampled and how it is sampled, the logger, the trace and the reports pick it up from here.
+ * Values below 0 were not measured: a pass the mode does not render, a frame between memory samples, no RHI, ...
+ */
+namespace FrameMetrics
+{
+	constexpr double BytesPerMB = 1024.0 * 1024.0;
+
+	// Low-Level Memory Tracker tags worth following for transparency, see GetLLMTagMemoryMB
+	enum class ELLMMemory : uint8
+	{
+		TrackedTotal,
+		RenderTargets,
+		SceneRender,
+		RHIMisc,
+		Textures,
+	};
+
+	// -1 unless the build has LLM and it runs with -llm
+	double GetLLMTagMemoryMB(ELLMMemory tag);
+	// Streaming and non-streaming texture memory as the RHI accounts it, -1 without an RHI
+	double GetTextureMemoryMB();
+	// RHI resources are only tracked from this call on, builds without RHI resource info track nothing
+	void StartResourceTracking();
+	// Render thread, walks every tracked RHI resource so only call it every few frames. Leaves the buckets alone without RHI resource info
+	void GatherResourceMemory(int64 (&outBytes)[static_cast<int32>(EResourceMemory::Count)]);
+
+	struct FFrameNumber
+	{
+		using FValue = uint64;
+		static constexpr FMetricDesc Desc{ TEXT("FrameNumber"), nullptr, TEXT(""), 1.0, false, EMetricRate::Always };
+		static FValue Sample(const FFrameContext& context) { return context.frameNumber; }
+	};
+
+	struct FFrameTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("FrameTime"), TEXT("FrameTime - ms"), TEXT("ms"), 1000.0, true, EMetricRate::Always };
+		static FValue Sample(const FFrameContext& context) { return context.frameTime; }
+	};
+
+	struct FGameThreadTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("GameThreadTime"), TEXT("GameThreadTime - ms"), TEXT("ms"), 1000.0, true, EMetricRate::EveryFrame };
+		static FValue Sample(const FFrameContext&) { return FPlatformTime::ToMilliseconds(GGameThreadTime); }
+	};
+
+	struct FRenderThreadTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("RenderThreadTime"), TEXT("RenderThreadTime - ms"), TEXT("ms"), 1000.0, true, EMetricRate::EveryFrame };
+		static FValue Sample(const FFrameContext&) { return FPlatformTime::ToMilliseconds(GRenderThreadTime); }
+	};
+
+	struct FGPUTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("GPUTime"), TEXT("GPUTime - ms"), TEXT("ms"), 1000.0, true, EMetricRate::EveryFrame };
+		// Without an RHI there is no GPU work, the metric is left out of the report
+		static FValue Sample(const FFrameContext&) { return GUsingNullRHI ? -1.0 : FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles()); }
+	};
+
+	template <FGPUPassTimings::EPass Pass>
+	struct TPassGPUTime
+	{
+		using FValue = double;
+		static FValue Sample(const FFrameContext& context) { return context.gpuPassTimes[static_cast<int32>(Pass)]; }
+	};
+
+	struct FBasePassGPUTime : TPassGPUTime<FGPUPassTimings::EPass::BasePass>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("BasePassGPUTime"), TEXT("BasePass GPU - ms"), TEXT("ms"), 1000.0, false, EMetricRate::EveryFrame };
+	};
+
+	struct FTranslucencyGPUTime : TPassGPUTime<FGPUPassTimings::EPass::Translucency>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("TranslucencyGPUTime"), TEXT("Translucency GPU - ms"), TEXT("ms"), 1000.0, false, EMetricRate::EveryFrame };
+	};
+
+	struct FOITGPUTime : TPassGPUTime<FGPUPassTimings::EPass::OIT>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("OITGPUTime"), TEXT("OIT GPU - ms"), TEXT("ms"), 1000.0, false, EMetricRate::EveryFrame };
+	};
+
+	struct FRayTracingTranslucencyGPUTime : TPassGPUTime<FGPUPassTimings::EPass::RayTracingTranslucency>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("RayTracingTranslucencyGPUTime"), TEXT("RT Translucency GPU - ms"), TEXT("ms"), 1000.0, false, EMetricRate::EveryFrame };
+	};
+
+	struct FDrawCalls
+	{
+		using FValue = int32;
+		static constexpr FMetricDesc Desc{ TEXT("DrawCalls"), TEXT("DrawCalls"), TEXT(""), 1.0, false, EMetricRate::RenderThread };
+		static FValue Sample(const FRenderStatsSample& stats) { return stats.drawCalls; }
+	};
+
+	struct FPrimitivesDrawn
+	{
+		using FValue = int32;
+		static constexpr FMetricDesc Desc{ TEXT("PrimitivesDrawn"), TEXT("PrimitivesDrawn"), TEXT(""), 1.0, false, EMetricRate::RenderThread };
+		static FValue Sample(const FRenderStatsSample& stats) { return stats.primitivesDrawn; }
+	};
+
+	struct FPhysicalMemory
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("PhysicalMemoryMB"), TEXT("Physical Memory - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+		static FValue Sample(const FFrameContext& context) { return context.memoryStats.UsedPhysical / BytesPerMB; }
+	};
+
+	struct FVirtualMemory
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("VirtualMemoryMB"), TEXT("Virtual Memory - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+		static FValue Sample(const FFrameContext& context) { return context.memoryStats.UsedVirtual / BytesPerMB; }
+	};
+
+	template <ELLMMemory Tag>
+	struct TLLMTagMemory
+	{
+		using FValue = double;
+		static FValue Sample(const FFrameContext&) { return GetLLMTagMemoryMB(Tag); }
+	};
+
+	struct FLLMTotalMemory : TLLMTagMemory<ELLMMemory::TrackedTotal>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("LLMTotalMB"), TEXT("LLM Total - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+	};
+
+	struct FLLMRenderTargetMemory : TLLMTagMemory<ELLMMemory::RenderTargets>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("LLMRenderTargetsMB"), TEXT("LLM RenderTargets - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+	};
+
+	struct FLLMSceneRenderMemory : TLLMTagMemory<ELLMMemory::SceneRender>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("LLMSceneRenderMB"), TEXT("LLM SceneRender - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+	};
+
+	struct FLLMRHIMiscMemory : TLLMTagMemory<ELLMMemory::RHIMisc>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("LLMRHIMiscMB"), TEXT("LLM RHIMisc - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+	};
+
+	struct FLLMTextureMemory : TLLMTagMemory<ELLMMemory::Textures>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("LLMTexturesMB"), TEXT("LLM Textures - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+	};
+
+	struct FTextureMemory
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("TextureMemoryMB"), TEXT("Texture Memory - MB"), TEXT("MB"), 1024.0, false, EMetricRate::Periodic };
+		static FValue Sample(const FFrameContext&) { return GetTextureMemoryMB(); }
+	};
+
+	template <EResourceMemory Bucket>
+	struct TResourceMemory
+	{
+		using FValue = double;
+		static FValue Sample(const FRenderStatsSample& stats)
+		{
+			const int64 bytes = stats.resourceBytes[static_cast<int32>(Bucket)];
+			return bytes >= 0 ? bytes / BytesPerMB : -1.0;
+		}
+	};
+
+	struct FRenderTargetMemory : TResourceMemory<EResourceMemory::RenderTargets>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("RenderTargetMemoryMB"), TEXT("Render Targets - MB"), TEXT("MB"), 1024.0, false, EMetricRate::RenderThread };
+	};
+
+	struct FOITMemory : TResourceMemory<EResourceMemory::OIT>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("OITMemoryMB"), TEXT("OIT Buffers - MB"), TEXT("MB"), 1024.0, false, EMetricRate::RenderThread };
+	};
+
+	struct FRayTracingMemory : TResourceMemory<EResourceMemory::RayTracing>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("RayTracingMemoryMB"), TEXT("Ray Tracing AS - MB"), TEXT("MB"), 1024.0, false, EMetricRate::RenderThread };
+	};
+
+	struct FResourceMemory : TResourceMemory<EResourceMemory::Total>
+	{
+		static constexpr FMetricDesc Desc{ TEXT("ResourceMemoryMB"), TEXT("RHI Resources - MB"), TEXT("MB"), 1024.0, false, EMetricRate::RenderThread };
+	};
+
+	// CPU time of the per-frame back-to-front instance sort, 0 on frames the view did not move enough to sort
+	struct FInstanceSortTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("InstanceSortTime"), TEXT("Instance Sort - us"), TEXT("us"), 1000.0, false, EMetricRate::EveryFrame };
+		static FValue Sample(const FFrameContext& context) { return context.instanceSortTime; }
+	};
+
+	// Instance transforms and custom data that changed place in the sort and were sent to the renderer again
+	struct FInstanceUpload
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("InstanceUploadKB"), TEXT("Instance Upload - KB"), TEXT("KB"), 10.0, false, EMetricRate::EveryFrame };
+		static FValue Sample(const FFrameContext& context) { return context.instanceUploadKB; }
+	};
+
+	// 0-1 along the camera path being played back, -1 for a static view
+	struct FPathProgress
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("PathProgress"), nullptr, TEXT(""), 1.0, false, EMetricRate::Always };
+		static FValue Sample(const FFrameContext& context) { return context.pathProgress; }
+	};
+
+	// Microseconds the logger itself spent on the frame
+	struct FLoggerTime
+	{
+		using FValue = double;
+		static constexpr FMetricDesc Desc{ TEXT("LoggerTime"), TEXT("Logger Update - us"), TEXT("us"), 1000.0, false, EMetricRate::Logger };
+		static FValue Sample(const FFrameContext& context) { return context.loggerTime; }
+	};
+}
+
+// Declaration order is the column order of the trace and the row order of the stats tables
+using FFrameMetricSchema = TMetricSchema<
+	FrameMetrics::FFrameNumber,
+	FrameMetrics::FFrameTime,
+	FrameMetrics::FGameThreadTime,
+	FrameMetrics::FRenderThreadTime,
+	FrameMetrics::FGPUTime,
+	FrameMetrics::FBasePassGPUTime,
+	FrameMetrics::FTranslucencyGPUTime,
+	FrameMetrics::FOITGPUTime,
+	FrameMetrics::FRayTracingTranslucencyGPUTime,
+	FrameMetrics::FDrawCalls,
+	FrameMetrics::FPrimitivesDrawn,
+	FrameMetrics::FPhysicalMemory,
+	FrameMetrics::FVirtualMemory,
+	FrameMetrics::FLLMTotalMemory,
+	FrameMetrics::FLLMRenderTargetMemory,
+	FrameMetrics::FLLMSceneRenderMemory,
+	FrameMetrics::FLLMRHIMiscMemory,
+	FrameMetrics::FLLMTextureMemory,
+	FrameMetrics::FTextureMemory,
+	FrameMetrics::FRenderTargetMemory,
+	FrameMetrics::FOITMemory,
+	FrameMetrics::FRayTracingMemory,
+	FrameMetrics::FResourceMemory,
+	FrameMetrics::FInstanceSortTime,
+	FrameMetrics::FInstanceUpload,
+	FrameMetrics::FPathProgress,
+	FrameMetrics::FLoggerTime>;
+
+using FFrameSample = FFrameMetricSchema::FSample;
+using FFrameSampleStore = FFrameMetricSchema::FStore;
@@ -0,0 +1,405 @@
+#include "FrameTrace.h"
+
+#include "HAL/PlatformFileManager.h"
+#include "HAL/RunnableThread.h"
+#include <fstream>
+
+namespace
+{
+	void WriteBytes(IFileHandle& file, const void* pData, const int64 numBytes)
+	{
+		if (numBytes > 0)
+			file.Write(static_cast<const uint8*>(pData), numBytes);
+	}
+
+	template <typename T>
+	void WriteValue(IFileHandle& file, const T& value)
+	{
+		WriteBytes(file, &value, sizeof(T));
+	}
+
+	void WriteString(IFileHandle& file, const FString& string)
+	{
+		const FTCHARToUTF8 utf8(*string);
+		WriteValue(file, static_cast<uint32>(utf8.Length()));
+		WriteBytes(file, utf8.Get(), utf8.Length());
+	}
+
+	template <typename T>
+	bool ReadValue(IFileHandle& file, T& outValue)
+	{
+		return file.Read(reinterpret_cast<uint8*>(&outValue), sizeof(T));
+	}
+}
+
+int32 FrameTrace::GetColumnTypeSize(const EColumnType type)
+{
+	switch (type)
+	{
+	case EColumnType::Int32:
+		return sizeof(int32);
+	case EColumnType::UInt64:
+		return sizeof(uint64);
+	case EColumnType::Double:
+		return sizeof(double);
+	}
+
+	return 0;
+}
+
+FFrameTraceWriter::FFrameTraceWriter(const FString& filePath, const FFrameTraceMetadata& metadata, const size_t framesPerChunk)
+	: m_FilePath(filePath)
+	, m_Metadata(metadata)
+	, m_ActiveChunk(0)
+	, m_SubmittedChunk(INDEX_NONE)
+	, m_bFinishRequested(false)
+	, m_NumDroppedFrames(0)
+	, m_pWakeEvent(FPlatformProcess::GetSynchEventFromPool())
+	, m_pThread(nullptr)
+	, m_NumWrittenFrames(0)
+{
+	for (FFrameSampleStore& chunk : m_Chunks)
+	{
+		chunk.Reserve(framesPerChunk);
+	}
+
+	m_pThread = FRunnableThread::Create(this, TEXT("FrameTraceWriter"), 0, TPri_BelowNormal);
+}
+
+FFrameTraceWriter::~FFrameTraceWriter()
+{
+	if (m_pThread)
+	{
+		Finish();
+		m_pThread->WaitForCompletion();
+		delete m_pThread;
+		m_pThread = nullptr;
+	}
+
+	FPlatformProcess::ReturnSynchEventToPool(m_pWakeEvent);
+}
+
+void FFrameTraceWriter::Append(const FFrameSample& sample)
+{
+	if (m_bFinishRequested.load(std::memory_order_relaxed))
+		return;
+
+	if (m_Chunks[m_ActiveChunk].IsFull())
+	{
+		// The other chunk is only free once the writer has written and cleared it
+		if (m_SubmittedChunk.load(std::memory_order_acquire) != INDEX_NONE)
+		{
+			++m_NumDroppedFrames;
+			return;
+		}
+
+		m_SubmittedChunk.store(m_ActiveChunk, std::memory_order_release);
+		m_pWakeEvent->Trigger();
+		m_ActiveChunk ^= 1;
+	}
+
+	m_Chunks[m_ActiveChunk].Add(sample);
+}
+
+void FFrameTraceWriter::Finish()
+{
+	if (m_bFinishRequested.exchange(true, std::memory_order_acq_rel) == false)
+	{
+		m_pWakeEvent->Trigger();
+	}
+}
+
+uint32 FFrameTraceWriter::Run()
+{
+	IPlatformFile& platformFile = FPlatformFileManager::Get().GetPlatformFile();
+	platformFile.CreateDirectoryTree(*FPaths::GetPath(m_FilePath));
+
+	const TUniquePtr<IFileHandle> pFile(platformFile.OpenWrite(*m_FilePath));
+	if (!pFile)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not open frame trace %s for writing."), *m_FilePath);
+	}
+	else
+	{
+		WriteHeader(*pFile);
+	}
+
+	while (true)
+	{
+		m_pWakeEvent->Wait();
+
+		// Check the finish flag first, everything the game thread submitted before finishing is visible after it
+		const bool bFinishing = m_bFinishRequested.load(std::memory_order_acquire);
+
+		if (const int32 submitted = m_SubmittedChunk.load(std::memory_order_acquire); submitted != INDEX_NONE)
+		{
+			if (pFile)
+				WriteChunk(*pFile, m_Chunks[submitted]);
+
+			m_Chunks[submitted].Clear();
+			m_SubmittedChunk.store(INDEX_NONE, std::memory_order_release);
+		}
+
+		if (bFinishing)
+		{
+			// The game thread no longer appends, so the active chunk is ours now
+			if (pFile)
+			{
+				WriteChunk(*pFile, m_Chunks[m_ActiveChunk]);
+				WriteValue(*pFile, static_cast<uint32>(0));
+				WriteValue(*pFile, m_NumWrittenFrames);
+				WriteValue(*pFile, m_NumDroppedFrames);
+				pFile->Flush();
+			}
+
+			m_Chunks[m_ActiveChunk].Clear();
+			break;
+		}
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Written %llu frames to trace %s (%llu dropped)."), m_NumWrittenFrames, *m_FilePath, m_NumDroppedFrames);
+	return 0;
+}
+
+void FFrameTraceWriter::WriteHeader(IFileHandle& file) const
+{
+	WriteValue(file, FrameTrace::Magic);
+	WriteValue(file, FrameTrace::Version);
+
+	WriteValue(file, static_cast<uint32>(m_Metadata.Num()));
+	for (const TPair<FString, FString>& entry : m_Metadata)
+	{
+		WriteString(file, entry.Key);
+		WriteString(file, entry.Value);
+	}
+
+	uint32 numColumns = 0;
+	m_Chunks[0].ForEachColumn([&numColumns](const TCHAR*, const auto&) { ++numColumns; });
+	WriteValue(file, numColumns);
+
+	m_Chunks[0].ForEachColumn([&file](const TCHAR* name, const auto& column)
+	{
+		using FValueType = typename std::decay_t<decltype(column)>::value_type;
+		WriteString(file, name);
+		WriteValue(file, static_cast<uint8>(FrameTrace::TColumnType<FValueType>::Value));
+	});
+}
+
+void FFrameTraceWriter::WriteChunk(IFileHandle& file, const FFrameSampleStore& chunk)
+{
+	if (chunk.Num() == 0)
+		return;
+
+	WriteValue(file, static_cast<uint32>(chunk.Num()));
+	chunk.ForEachColumn([&file](const TCHAR*, const auto& column)
+	{
+		WriteBytes(file, column.data(), static_cast<int64>(column.size() * sizeof(column[0])));
+	});
+
+	m_NumWrittenFrames += chunk.Num();
+}
+
+FFrameTraceReader::FFrameTraceReader()
+	: m_bIsComplete(false)
+	, m_NumFrames(0)
+	, m_NumDroppedFrames(0)
+{
+}
+
+FFrameTraceReader::~FFrameTraceReader() = default;
+
+bool FFrameTraceReader::Open(const FString& filePath)
+{
+	m_pFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*filePath));
+	m_Metadata.Reset();
+	m_Columns.Reset();
+	m_bIsComplete = false;
+
+	if (!m_pFile)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not open frame trace %s."), *filePath);
+		return false;
+	}
+
+	uint32 magic = 0, version = 0;
+	if (!ReadValue(*m_pFile, magic) || magic != FrameTrace::Magic || !ReadValue(*m_pFile, version) || version != FrameTrace::Version)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not a supported frame trace."), *filePath);
+		return false;
+	}
+
+	uint32 numEntries = 0;
+	if (!ReadValue(*m_pFile, numEntries))
+		return false;
+
+	for (uint32 i = 0; i < numEntries; ++i)
+	{
+		FString key, value;
+		if (!ReadString(key) || !ReadString(value))
+			return false;
+
+		m_Metadata.Emplace(MoveTemp(key), MoveTemp(value));
+	}
+
+	uint32 numColumns = 0;
+	if (!ReadValue(*m_pFile, numColumns))
+		return false;
+
+	for (uint32 i = 0; i < numColumns; ++i)
+	{
+		FColumn column;
+		uint8 type = 0;
+		if (!ReadString(column.name) || !ReadValue(*m_pFile, type))
+			return false;
+
+		column.type = static_cast<FrameTrace::EColumnType>(type);
+		m_Columns.Add(MoveTemp(column));
+	}
+
+	return true;
+}
+
+bool FFrameTraceReader::ReadChunk(uint32& outNumRows, TArray<TArray<uint8>>& outColumns)
+{
+	outNumRows = 0;
+	if (!m_pFile || !ReadValue(*m_pFile, outNumRows))
+		return false;
+
+	if (outNumRows == 0)
+	{
+		m_bIsComplete = ReadValue(*m_pFile, m_NumFrames) && ReadValue(*m_pFile, m_NumDroppedFrames);
+		return false;
+	}
+
+	outColumns.SetNum(m_Columns.Num());
+	for (int32 i = 0; i < m_Columns.Num(); ++i)
+	{
+		const int64 numBytes = static_cast<int64>(outNumRows) * FrameTrace::GetColumnTypeSize(m_Columns[i].type);
+		outColumns[i].SetNumUninitialized(static_cast<int32>(numBytes));
+		if (!m_pFile->Read(outColumns[i].GetData(), numBytes))
+		{
+			outNumRows = 0;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FString FFrameTraceReader::FormatValue(const FrameTrace::EColumnType type, const uint8* pValue)
+{
+	switch (type)
+	{
+	case FrameTrace::EColumnType::Int32:
+		return FString::Printf(TEXT("%d"), *reinterpret_cast<const int32*>(pValue));
+	case FrameTrace::EColumnType::UInt64:
+		return FString::Printf(TEXT("%llu"), *reinterpret_cast<const uint64*>(pValue));
+	case FrameTrace::EColumnType::Double:
+		return FString::Printf(TEXT("%.4f"), *reinterpret_cast<const double*>(pValue));
+	}
+
+	return FString();
+}
+
+double FFrameTraceReader::ToDouble(const FrameTrace::EColumnType type, const uint8* pValue)
+{
+	switch (type)
+	{
+	case FrameTrace::EColumnType::Int32:
+		return *reinterpret_cast<const int32*>(pValue);
+	case FrameTrace::EColumnType::UInt64:
+		return static_cast<double>(*reinterpret_cast<const uint64*>(pValue));
+	case FrameTrace::EColumnType::Double:
+		return *reinterpret_cast<const double*>(pValue);
+	}
+
+	return 0.0;
+}
+
+void FFrameTraceReader::ReadColumns(const TArray<FString>& names, TArray<TArray<double>>& outColumns)
+{
+	outColumns.SetNum(names.Num());
+	TArray<int32> columnIndices;
+	for (const FString& name : names)
+	{
+		columnIndices.Add(m_Columns.IndexOfByPredicate([&name](const FColumn& column) { return column.name == name; }));
+	}
+
+	uint32 numRows = 0;
+	TArray<TArray<uint8>> columns;
+	while (ReadChunk(numRows, columns))
+	{
+		for (int32 i = 0; i < names.Num(); ++i)
+		{
+			const int32 columnIndex = columnIndices[i];
+			if (columnIndex == INDEX_NONE)
+				continue;
+
+			const FrameTrace::EColumnType type = m_Columns[columnIndex].type;
+			const int32 typeSize = FrameTrace::GetColumnTypeSize(type);
+			for (uint32 row = 0; row < numRows; ++row)
+			{
+				outColumns[i].Add(ToDouble(type, columns[columnIndex].GetData() + row * typeSize));
+			}
+		}
+	}
+}
+
+bool FFrameTraceReader::ExportToCsv(const FString& csvFilePath)
+{
+	std::ofstream file(TCHAR_TO_UTF8(*csvFilePath));
+	if (!file.is_open())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not open %s for writing."), *csvFilePath);
+		return false;
+	}
+
+	for (const TPair<FString, FString>& entry : m_Metadata)
+	{
+		file << "# " << TCHAR_TO_UTF8(*entry.Key) << '=' << TCHAR_TO_UTF8(*entry.Value) << '\n';
+	}
+
+	for (int32 i = 0; i < m_Columns.Num(); ++i)
+	{
+		file << (i > 0 ? "," : "") << TCHAR_TO_UTF8(*m_Columns[i].name);
+	}
+	file << '\n';
+
+	uint32 numRows = 0;
+	TArray<TArray<uint8>> columns;
+	while (ReadChunk(numRows, columns))
+	{
+		for (uint32 row = 0; row < numRows; ++row)
+		{
+			for (int32 i = 0; i < m_Columns.Num(); ++i)
+			{
+				const int32 typeSize = FrameTrace::GetColumnTypeSize(m_Columns[i].type);
+				file << (i > 0 ? "," : "") << TCHAR_TO_UTF8(*FormatValue(m_Columns[i].type, columns[i].GetData() + row * typeSize));
+			}
+			file << '\n';
+		}
+	}
+
+	if (!m_bIsComplete)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Frame trace ended early, exported the frames that were written."));
+	}
+
+	return true;
+}
+
+bool FFrameTraceReader::ReadString(FString& outString) const
+{
+	uint32 length = 0;
+	if (!ReadValue(*m_pFile, length))
+		return false;
+
+	TArray<ANSICHAR> buffer;
+	buffer.SetNumUninitialized(length);
+	if (length > 0 && !m_pFile->Read(reinterpret_cast<uint8*>(buffer.GetData()), length))
+		return false;
+
+	const FUTF8ToTCHAR converted(buffer.GetData(), length);
+	outString = FString(converted.Length(), converted.Get());
+	return true;
+}
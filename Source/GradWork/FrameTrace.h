@@ -0,0 +1,128 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "FrameMetrics.h"
+#include <atomic>
+
+class FRunnableThread;
+class IFileHandle;
+
+/**
+ * Columnar binary trace of every tracked frame.
+ * Layout: magic, version, metadata (key/value strings), column table (name + type),
+ * then chunks of [row count, column 0 data, column 1 data, ...], a chunk with 0 rows and a footer with the frame counts.
+ */
+namespace FrameTrace
+{
+	constexpr uint32 Magic = 0x52545747; // "GWTR"
+	constexpr uint32 Version = 1;
+	constexpr const TCHAR* Extension = TEXT("gwtrace");
+
+	enum class EColumnType : uint8
+	{
+		Int32,
+		UInt64,
+		Double,
+	};
+
+	template <typename T> struct TColumnType;
+	template <> struct TColumnType<int32> { static constexpr EColumnType Value = EColumnType::Int32; };
+	template <> struct TColumnType<uint64> { static constexpr EColumnType Value = EColumnType::UInt64; };
+	template <> struct TColumnType<double> { static constexpr EColumnType Value = EColumnType::Double; };
+
+	int32 GetColumnTypeSize(EColumnType type);
+}
+
+using FFrameTraceMetadata = TArray<TPair<FString, FString>>;
+
+/**
+ * Streams frames to a trace file from a background thread.
+ * The game thread appends into one of two preallocated chunks, full chunks are handed to the writer thread.
+ * When the writer falls behind, frames are dropped and counted rather than buffered, so memory stays bounded.
+ */
+class FFrameTraceWriter final : public FRunnable
+{
+public:
+	FFrameTraceWriter(const FString& filePath, const FFrameTraceMetadata& metadata, size_t framesPerChunk);
+	virtual ~FFrameTraceWriter() override;
+
+	FFrameTraceWriter(const FFrameTraceWriter&) = delete;
+	FFrameTraceWriter& operator=(const FFrameTraceWriter&) = delete;
+
+	// Game thread, never blocks and never touches the disk
+	void Append(const FFrameSample& sample);
+	// Hands the last partial chunk to the writer thread, which closes the file in the background
+	void Finish();
+
+	const FString& GetFilePath() const { return m_FilePath; }
+	const FFrameTraceMetadata& GetMetadata() const { return m_Metadata; }
+	uint64 GetNumDroppedFrames() const { return m_NumDroppedFrames; }
+
+	virtual uint32 Run() override;
+	virtual void Stop() override { Finish(); }
+
+private:
+	FString m_FilePath;
+	FFrameTraceMetadata m_Metadata;
+
+	FFrameSampleStore m_Chunks[2];
+	int32 m_ActiveChunk;
+	std::atomic<int32> m_SubmittedChunk;
+	std::atomic<bool> m_bFinishRequested;
+	uint64 m_NumDroppedFrames;
+
+	FEvent* m_pWakeEvent;
+	FRunnableThread* m_pThread;
+
+	// Writer thread only
+	uint64 m_NumWrittenFrames;
+	void WriteHeader(IFileHandle& file) const;
+	void WriteChunk(IFileHandle& file, const FFrameSampleStore& chunk);
+};
+
+/**
+ * Reads a trace chunk by chunk, so traces of any length can be converted with bounded memory.
+ */
+class FFrameTraceReader final
+{
+public:
+	struct FColumn
+	{
+		FString name;
+		FrameTrace::EColumnType type;
+	};
+
+	FFrameTraceReader();
+	~FFrameTraceReader();
+
+	bool Open(const FString& filePath);
+
+	const FFrameTraceMetadata& GetMetadata() const { return m_Metadata; }
+	const TArray<FColumn>& GetColumns() const { return m_Columns; }
+
+	// Reads the next chunk into one raw buffer per column, returns false once the end (or a truncated tail) is reached
+	bool ReadChunk(uint32& outNumRows, TArray<TArray<uint8>>& outColumns);
+	static FString FormatValue(FrameTrace::EColumnType type, const uint8* pValue);
+	static double ToDouble(FrameTrace::EColumnType type, const uint8* pValue);
+
+	// Reads every remaining chunk, one array per requested column, left empty when the trace has no such column
+	void ReadColumns(const TArray<FString>& names, TArray<TArray<double>>& outColumns);
+
+	// Only valid once ReadChunk returned false on a complete trace
+	bool IsComplete() const { return m_bIsComplete; }
+	uint64 GetNumFrames() const { return m_NumFrames; }
+	uint64 GetNumDroppedFrames() const { return m_NumDroppedFrames; }
+
+	bool ExportToCsv(const FString& csvFilePath);
+
+private:
+	TUniquePtr<IFileHandle> m_pFile;
+	FFrameTraceMetadata m_Metadata;
+	TArray<FColumn> m_Columns;
+	bool m_bIsComplete;
+	uint64 m_NumFrames;
+	uint64 m_NumDroppedFrames;
+
+	bool ReadString(FString& outString) const;
+};
@@ -0,0 +1,64 @@
+#include "FrameTraceExportCommandlet.h"
+
+#include "FrameTrace.h"
+#include "HAL/FileManager.h"
+
+UFrameTraceExportCommandlet::UFrameTraceExportCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UFrameTraceExportCommandlet::Main(const FString& Params)
+{
+	FString tracePath;
+	if (!FParse::Value(*Params, TEXT("trace="), tracePath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=FrameTraceExport -trace=<file or directory> [-csv=<file or directory>]"));
+		return 1;
+	}
+
+	FString csvPath;
+	const bool bHasCsvPath = FParse::Value(*Params, TEXT("csv="), csvPath);
+
+	// A directory converts every trace in it, next to the original or at the same relative path under the -csv directory
+	TArray<FString> traceFiles;
+	const bool bIsTraceDirectory = FPaths::DirectoryExists(tracePath);
+	if (bIsTraceDirectory)
+	{
+		IFileManager::Get().FindFilesRecursive(traceFiles, *tracePath, *(FString(TEXT("*.")) + FrameTrace::Extension), true, false);
+	}
+	else
+	{
+		traceFiles.Add(tracePath);
+	}
+
+	int32 numFailed = 0;
+	for (const FString& traceFile : traceFiles)
+	{
+		FString outputPath = FPaths::ChangeExtension(traceFile, TEXT("csv"));
+		if (bHasCsvPath && bIsTraceDirectory)
+		{
+			FPaths::MakePathRelativeTo(outputPath, *(tracePath / TEXT("")));
+			outputPath = csvPath / outputPath;
+			IFileManager::Get().MakeDirectory(*FPaths::GetPath(outputPath), true);
+		}
+		else if (bHasCsvPath)
+		{
+			outputPath = csvPath;
+		}
+
+		FFrameTraceReader reader;
+		if (!reader.Open(traceFile) || !reader.ExportToCsv(outputPath))
+		{
+			++numFailed;
+			continue;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Exported %s to %s (%llu frames, %llu dropped)."), *traceFile, *outputPath, reader.GetNumFrames(), reader.GetNumDroppedFrames());
+	}
+
+	return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "FrameTraceExportCommandlet.generated.h"
+
+/**
+ * Converts frame traces written by the performance logger to CSV.
+ * A directory of traces is converted next to the originals, or mirrored into the -csv directory.
+ * Usage: -run=FrameTraceExport -trace=<file or directory> [-csv=<file or directory>]
+ */
+UCLASS()
+class GRADWORK_API UFrameTraceExportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UFrameTraceExportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,84 @@
+#include "GPUPassTimings.h"
+
+#if STATS
+#include "Stats/StatsData.h"
+#endif
+
+FGPUPassTimings::FGPUPassTimings()
+	: m_bIsEnabled(false)
+{
+	SetStatName(EPass::BasePass, TEXT("BasePass"));
+	SetStatName(EPass::Translucency, TEXT("Translucency"));
+	SetStatName(EPass::OIT, TEXT("OIT"));
+	SetStatName(EPass::RayTracingTranslucency, TEXT("RayTracingTranslucency"));
+}
+
+bool FGPUPassTimings::Enable(UWorld* pWorld)
+{
+#if STATS
+	// stat GPU toggles, so it is only sent once for the whole session
+	if (!m_bIsEnabled && GEngine)
+	{
+		// -GPUPassStatNames=BasePass,Translucency,OIT,RayTracingTranslucency renames the stats in pass order
+		FString names;
+		if (FParse::Value(FCommandLine::Get(), TEXT("GPUPassStatNames="), names, false))
+		{
+			TArray<FString> entries;
+			names.ParseIntoArray(entries, TEXT(","), true);
+			for (int32 pass = 0; pass < FMath::Min(entries.Num(), NumPasses); ++pass)
+			{
+				SetStatName(static_cast<EPass>(pass), entries[pass].TrimStartAndEnd());
+			}
+		}
+
+		// Collected for Sample, never drawn on the viewport
+		GEngine->Exec(pWorld, TEXT("stat GPU -nodisplay"));
+		m_bIsEnabled = true;
+	}
+#else
+	UE_LOG(LogTemp, Warning, TEXT("Per pass GPU timings need a build with stats."));
+#endif
+
+	return m_bIsEnabled;
+}
+
+void FGPUPassTimings::SetStatName(const EPass pass, const FString& statName)
+{
+	m_ShortNames[static_cast<int32>(pass)] = FName(TEXT("Stat_GPU_") + statName);
+}
+
+void FGPUPassTimings::Sample(double (&outTimes)[NumPasses]) const
+{
+	for (double& time : outTimes)
+	{
+		time = -1.0;
+	}
+
+#if STATS
+	if (!m_bIsEnabled)
+		return;
+
+	const FGameThreadStatsData* pStatsData = FLatestGameThreadStatsData::Get().Latest;
+	if (!pStatsData)
+		return;
+
+	static const FName GPUGroupName(TEXT("STATGROUP_GPU"));
+	for (int32 groupIndex = 0; groupIndex < pStatsData->GroupNames.Num(); ++groupIndex)
+	{
+		if (pStatsData->GroupNames[groupIndex] != GPUGroupName)
+			continue;
+
+		for (const FComplexStatMessage& counter : pStatsData->ActiveStatGroups[groupIndex].CountersAggregate)
+		{
+			const FName shortName = counter.GetShortName();
+			for (int32 pass = 0; pass < NumPasses; ++pass)
+			{
+				if (shortName == m_ShortNames[pass])
+				{
+					outTimes[pass] = counter.GetValue_double(EComplexStatField::IncAve);
+				}
+			}
+		}
+	}
+#endif
+}
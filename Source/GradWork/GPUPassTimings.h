@@ -0,0 +1,39 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * GPU time of the passes that matter for transparency, read from the engine's GPU stats (the ones behind stat GPU).
+ * Only available in builds with stats. The values are whatever the stats thread published last,
+ * which trails the game thread by a few frames like the whole-frame GPU time does.
+ */
+class FGPUPassTimings final
+{
+public:
+	enum class EPass : uint8
+	{
+		BasePass,
+		Translucency,
+		OIT,
+		RayTracingTranslucency,
+		Count
+	};
+	static constexpr int32 NumPasses = static_cast<int32>(EPass::Count);
+
+	FGPUPassTimings();
+
+	// Turns the GPU stat group on through stat GPU -nodisplay. Its overlay is left off: drawing it costs game and render
+	// thread time every tracked frame, and its text would end up in the captures. Returns false without stats
+	bool Enable(UWorld* pWorld);
+	bool IsEnabled() const { return m_bIsEnabled; }
+
+	// The name the engine declared the GPU stat with, looked up as Stat_GPU_<name>
+	void SetStatName(EPass pass, const FString& statName);
+
+	// Milliseconds per pass, -1 for a pass that was not found (not enabled, or not rendered in this mode)
+	void Sample(double (&outTimes)[NumPasses]) const;
+
+private:
+	FName m_ShortNames[NumPasses];
+	bool m_bIsEnabled;
+};
@@ -6,23 +6,122 @@
 #include "EnhancedInputComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "EnhancedInputSubsystems.h"
+#include "BenchmarkSubsystem.h"
+#include "CameraPathActor.h"
+#include "EngineUtils.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/GameViewportClient.h"
+#include "OverdrawAnalyzer.h"
 #include "PerformanceLogger.h"
+#include "PipelineStateCache.h"
+#include "ShaderPipelineCache.h"
+#include "ScreenshotCapture.h"
+#include "TransparentHeavyLevel.h"
+#if WITH_EDITOR
+#include "ShaderCompiler.h"
+#endif
+
+namespace
+{
+	// PSOs still compiling from precache requests, plus shader compile jobs when running uncooked
+	uint32 GetNumPendingShaderWork()
+	{
+		uint32 numPending = PipelineStateCache::NumActivePrecacheRequests() + FShaderPipelineCache::NumPrecompilesRemaining();
+#if WITH_EDITOR
+		if (GShaderCompilingManager)
+		{
+			numPending += GShaderCompilingManager->GetNumRemainingJobs();
+		}
+#endif
+		return numPending;
+	}
+
+	FString GetScreenPercentageName(const float percentage)
+	{
+		return TEXT("sp") + FString::SanitizeFloat(percentage, 0);
+	}
+}
 
 void AGWPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
 
-	int currentScene = m_CurrentScene;
+	UBenchmarkSubsystem* pBenchmarkSubsystem = GetBenchmarkSubsystem();
+	m_pPerformanceLogger = &pBenchmarkSubsystem->GetPerformanceLogger();
+	m_pSession = &pBenchmarkSubsystem->GetSessionState();
+	pBenchmarkSubsystem->OnLevelOpened(FName(UGameplayStatics::GetCurrentLevelName(GetWorld())));
+
+	if (m_pSession->bHasParsedCommandLine == false)
+	{
+		ParseBenchmarkCommandLine();
+	}
+
+	int currentScene = m_pSession->currentScene;
 	if (currentScene == -1)
 		currentScene = 0;
+
+	// A window cannot span a level load, the logger outlives the level so close it here
+	if (m_pPerformanceLogger->IsTracking())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Level changed while tracking, the window is cut short."));
+		m_pPerformanceLogger->StopTracking();
+	}
 	
-	m_pPerformanceLogger = new FPerformanceLogger(30.f, 0.1f, m_SceneNames[currentScene].ToString(), GetPlayerModeString());
+	const FBenchmarkSettings& settings = m_pSession->settings;
+	m_pPerformanceLogger->SetDuration(settings.durationSeconds);
+	m_pPerformanceLogger->SetEarlyStop(settings.minDurationSeconds, settings.targetPrecision);
+	m_pPerformanceLogger->SetHitchThresholds(settings.hitchBudgetMs, settings.hitchMedianMultiplier);
+	m_pPerformanceLogger->SetProbeIntervals(settings.memorySampleInterval, settings.resourceSampleInterval, settings.onScreenInterval);
+	m_pPerformanceLogger->SetRunNames(m_SceneNames[currentScene].ToString(), GetPlayerModeString());
+	m_pPerformanceLogger->SetOutputDirectory(settings.outputDirectory);
+	if (settings.bCPUOnly == false && FParse::Param(FCommandLine::Get(), TEXT("GPUPassStats")))
+	{
+		m_pPerformanceLogger->EnableGPUPassTimings(GetWorld());
+	}
+
+	FWarmupDetector::FSettings warmupSettings;
+	warmupSettings.maxSeconds = settings.maxWarmupSeconds;
+	m_WarmupDetector = FWarmupDetector(warmupSettings);
 
-	if (m_bIsSimulating && m_CurrentScene != 4)
+	m_bIsRecordingPath = m_pSession->bIsBenchmarking == false && FParse::Param(FCommandLine::Get(), TEXT("RecordCameraPath"));
+
+	if (m_pSession->bIsBenchmarking)
+	{
+		StartBenchmarkRun();
+		return;
+	}
+
+	// The mode set on the controller is what gets rendered, not just the name of the output folder
+	TransparencyMode::Apply(m_CurrentMode);
+
+	if (m_pSession->bIsSimulating && UsesFixedPositions())
 	{
 		m_CurrentPos = 0;
 		GetPawn()->SetActorTransform(m_Positions[m_CurrentPos]);
 	}
+
+	if (m_pSession->bIsSimulating && m_SceneNames.IsValidIndex(m_pSession->currentScene + 1))
+	{
+		pBenchmarkSubsystem->PreloadLevel(m_SceneNames[m_pSession->currentScene + 1]);
+	}
+
+	SetTracePosition();
+}
+
+void AGWPlayerController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopPathPlayback();
+
+	if (m_bIsRecordingPath && !m_CameraPath.IsEmpty())
+	{
+		const FString filePath = FCameraPath::GetRecordingPath(UGameplayStatics::GetCurrentLevelName(GetWorld()));
+		if (m_CameraPath.SaveToFile(filePath))
+		{
+			UE_LOG(LogTemp, Log, TEXT("Recorded %.1f s camera path to: %s"), m_CameraPath.GetDuration(), *filePath);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AGWPlayerController::SetupInputComponent()
@@ -48,47 +147,80 @@ void AGWPlayerController::Tick(float DeltaTime)
 
 	m_pPerformanceLogger->Update(DeltaTime);
 
-	if (m_bIsSimulating == false)
+	if (m_bIsRecordingPath && GetPawn())
+	{
+		m_PathTime += DeltaTime;
+		m_CameraPath.AddKey(m_PathTime, GetPawn()->GetActorTransform());
+	}
+
+	if (m_bIsAwaitingCaptures)
+	{
+		m_CaptureWaitTime += DeltaTime;
+		if (m_CaptureWaitTime > MaxCaptureWaitSeconds)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Screenshots did not finish within %.0f s, continuing without them."), MaxCaptureWaitSeconds);
+			OnCapturesFinished(m_CaptureWaitId);
+		}
+		return;
+	}
+
+	if (m_pSession->bIsBenchmarking)
+	{
+		TickBenchmark(DeltaTime);
+		return;
+	}
+
+	if (m_pSession->bIsSimulating == false)
 		return;
 
-	constexpr int offset = 20;
-	if (m_AccuTime > offset && m_AccuTime < offset + 0.5)
-		m_pPerformanceLogger->StartTracking();
-	
 	m_AccuTime += DeltaTime;
 
-	if (m_AccuTime > m_SimulationTimePerScene)
+	if (m_bIsRunTracking == false)
 	{
-		TakeScreenshot_Helper(m_CurrentScene, m_CurrentPos);
-		
-		++m_CurrentScene;
-		if (m_CurrentScene >= m_SceneNames.Num())
+		if (m_bHasAnalyzedOverdraw || TickWarmup(DeltaTime))
+			StartRunTracking();
+		return;
+	}
+
+	// The logger stops by itself after the duration or once the stats are precise enough
+	if (m_pPerformanceLogger->IsTracking())
+		return;
+
+	GetBenchmarkSubsystem()->SetLastRunCapture(TakeScreenshot_Helper(m_pSession->currentScene, m_CurrentPos));
+
+	// The level only changes once the screenshot is on disk
+	WaitForCaptures([this]()
+	{
+		++m_pSession->currentScene;
+		if (m_pSession->currentScene >= m_SceneNames.Num())
 		{
-			m_CurrentScene = 0;
-			m_bIsSimulating = false;
+			m_pSession->currentScene = 0;
+			m_pSession->bIsSimulating = false;
+			GetBenchmarkSubsystem()->WriteSessionReport();
 		}
 
-		UGameplayStatics::OpenLevel(GetWorld(), m_SceneNames[m_CurrentScene]);
-	}
+		GetBenchmarkSubsystem()->OpenLevel(GetWorld(), m_SceneNames[m_pSession->currentScene]);
+	});
 }
 
 
 void AGWPlayerController::SwitchScene(const FInputActionValue& value)
 {
-	if (m_bIsSimulating || m_pPerformanceLogger->IsTracking())
+	if (m_pSession->bIsSimulating || m_pSession->bIsBenchmarking || m_pPerformanceLogger->IsTracking())
 		return;
 	
-	m_CurrentScene = GetWrappedIndex(m_CurrentScene, value.Get<bool>() ? 1 : -1, m_SceneNames.Num());
-	UGameplayStatics::OpenLevel(GetWorld(), m_SceneNames[m_CurrentScene]);
+	m_pSession->currentScene = GetWrappedIndex(m_pSession->currentScene, value.Get<bool>() ? 1 : -1, m_SceneNames.Num());
+	GetBenchmarkSubsystem()->OpenLevel(GetWorld(), m_SceneNames[m_pSession->currentScene]);
 }
 
 void AGWPlayerController::SwitchPos(const FInputActionValue& value)
 {
-	if (m_pPerformanceLogger->IsTracking())
+	if (m_pSession->bIsBenchmarking || m_pPerformanceLogger->IsTracking())
 		return;
 	
 	m_CurrentPos = GetWrappedIndex(m_CurrentPos, value.Get<bool>() ? 1 : -1, m_Positions.Num());
 	GetPawn()->SetActorTransform(m_Positions[m_CurrentPos]);
+	SetTracePosition();
 }
 
 void AGWPlayerController::TakeScreenshot(const FInputActionValue& value)
@@ -97,8 +229,8 @@ void AGWPlayerController::TakeScreenshot(const FInputActionValue& value)
 	if (m_CurrentPos == -1)
 		curPos = 0;
 
-	auto curScene = m_CurrentScene;
-	if (m_CurrentScene == -1)
+	auto curScene = m_pSession->currentScene;
+	if (m_pSession->currentScene == -1)
 		curScene = 0;
 	
 	TakeScreenshot_Helper(curScene, curPos);
@@ -106,10 +238,10 @@ void AGWPlayerController::TakeScreenshot(const FInputActionValue& value)
 
 void AGWPlayerController::TrackStats(const FInputActionValue&)
 {
-	if (m_bIsSimulating)
+	if (m_pSession->bIsSimulating || m_pSession->bIsBenchmarking)
 		return;
 	
-	if (m_CurrentPos != 0 && m_CurrentScene != 4)
+	if (m_CurrentPos != 0 && UsesFixedPositions())
 	{
 		GEngine->AddOnScreenDebugMessage(-1, 2.f, FColor::Red, "Not at correct position to track stats!");
 		return;
@@ -120,48 +252,639 @@ void AGWPlayerController::TrackStats(const FInputActionValue&)
 
 void AGWPlayerController::StartSimulation(const FInputActionValue&)
 {
-	if (m_bIsSimulating == false)
+	if (m_pSession->bIsSimulating == false && m_pSession->bIsBenchmarking == false)
 	{
-		m_bIsSimulating = true;
-		// m_pPerformanceLogger->StopTracking();
-		m_pPerformanceLogger->StartTracking();
+		m_pSession->bIsSimulating = true;
 		
-		m_CurrentScene = 0;
-		UGameplayStatics::OpenLevel(GetWorld(), m_SceneNames[m_CurrentScene]);
+		m_pSession->currentScene = 0;
+		GetBenchmarkSubsystem()->OpenLevel(GetWorld(), m_SceneNames[m_pSession->currentScene]);
+	}
+}
+
+bool AGWPlayerController::TickWarmup(const float deltaTime)
+{
+	// Post-load work of the level loading in the background runs on the game thread, the warm-up waits it out
+	if (GetBenchmarkSubsystem()->IsPreloading() && m_AccuTime < m_pSession->settings.maxWarmupSeconds)
+	{
+		m_PreloadStats.AddFrame(deltaTime);
+		return false;
+	}
+
+	// A fixed warm-up overrides the detector
+	if (m_pSession->settings.warmupSeconds > 0.f)
+		return m_AccuTime >= m_pSession->settings.warmupSeconds;
+
+	return m_WarmupDetector.AddFrame(deltaTime * 1000.0, deltaTime);
+}
+
+void AGWPlayerController::StartRunTracking()
+{
+	// The rays cost a few frames' worth of time, they get a frame of their own so the first tracked frame does not pay for them
+	if (m_bHasAnalyzedOverdraw == false && m_pSession->settings.layerGridWidth > 0 && !IsMinimalInstrumentationRun())
+	{
+		AnalyzeOverdraw();
+		m_bHasAnalyzedOverdraw = true;
+		return;
+	}
+	m_bHasAnalyzedOverdraw = false;
+
+	FString warmup;
+	if (m_pSession->settings.warmupSeconds > 0.f)
+		warmup = FString::Printf(TEXT("%.1f s (fixed)"), m_AccuTime);
+	else
+		warmup = FString::Printf(TEXT("%.1f s (%s)"), m_WarmupDetector.GetElapsedSeconds(), m_WarmupDetector.HasTimedOut() ? TEXT("timed out") : TEXT("steady"));
+
+	if (m_WarmupDetector.HasTimedOut())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Frame times did not settle within %.0f s, tracking anyway."), m_pSession->settings.maxWarmupSeconds);
+	}
+
+	m_pPerformanceLogger->SetTraceMetadata("Warmup", warmup);
+	if (m_PreloadStats.numFrames > 0)
+	{
+		m_pPerformanceLogger->SetTraceMetadata("PreloadNextLevel", m_PreloadStats.ToString());
+		m_PreloadStats = FLoadPhaseStats();
+	}
+	else
+	{
+		m_pPerformanceLogger->RemoveTraceMetadata("PreloadNextLevel");
+	}
+	m_pPerformanceLogger->StartTracking();
+	m_bIsRunTracking = true;
+
+	if (m_CurrentPos == FBenchmarkRun::PathPosition && m_pSession->bIsBenchmarking)
+	{
+		StartPathPlayback();
+	}
+}
+
+bool AGWPlayerController::LoadCameraPath()
+{
+	// A spline in the level wins over a recording
+	for (TActorIterator<ACameraPathActor> it(GetWorld()); it; ++it)
+	{
+		m_CameraPath = it->BuildPath();
+		if (!m_CameraPath.IsEmpty())
+			return true;
+	}
+
+	return m_CameraPath.LoadFromFile(FCameraPath::GetRecordingPath(UGameplayStatics::GetCurrentLevelName(GetWorld())));
+}
+
+void AGWPlayerController::StartPathPlayback()
+{
+	// Every run simulates the same times along the path, however long the frames take to render
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / m_pSession->settings.pathFrameRate);
+
+	m_PathTime = 0;
+	m_bIsPlayingPath = true;
+	m_pPerformanceLogger->SetPathProgress(0.f);
+}
+
+void AGWPlayerController::TickPathPlayback(const float deltaTime)
+{
+	m_PathTime += deltaTime;
+	GetPawn()->SetActorTransform(m_CameraPath.Evaluate(m_PathTime));
+
+	// Applies to the frame rendered from the transform that was just set
+	const float duration = m_CameraPath.GetDuration();
+	m_pPerformanceLogger->SetPathProgress(duration > 0.f ? FMath::Min(1.f, m_PathTime / duration) : 1.f);
+}
+
+void AGWPlayerController::StopPathPlayback()
+{
+	if (m_bIsPlayingPath == false)
+		return;
+
+	FApp::SetUseFixedTimeStep(false);
+	m_bIsPlayingPath = false;
+	m_pPerformanceLogger->SetPathProgress(-1.f);
+}
+
+void AGWPlayerController::ParseBenchmarkCommandLine()
+{
+	m_pSession->bHasParsedCommandLine = true;
+
+	const TCHAR* commandLine = FCommandLine::Get();
+	if (!FParse::Param(commandLine, TEXT("benchmark")))
+		return;
+
+	if (!FBenchmarkSettings::ParseCommandLine(commandLine, m_SceneNames, m_pSession->settings))
+	{
+		EndBenchmark(2);
+		return;
+	}
+
+	// Only scenes the controller knows about have positions and screenshots names
+	for (const FName& scene : m_pSession->settings.scenes)
+	{
+		if (!m_SceneNames.Contains(scene))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Benchmark scene %s is not in the controller's scene list."), *scene.ToString());
+			EndBenchmark(2);
+			return;
+		}
+	}
+
+	m_pSession->runs = m_pSession->settings.BuildMatrix();
+	m_pSession->currentRun = 0;
+	m_pSession->numFailedRuns = 0;
+	m_pSession->bIsBenchmarking = true;
+
+	UE_LOG(LogTemp, Display, TEXT("Benchmark: %d runs (%d scenes x %d modes x %d positions x %d resolutions), %s profile."),
+		m_pSession->runs.Num(), m_pSession->settings.scenes.Num(), m_pSession->settings.modes.Num(), m_pSession->settings.positions.Num(),
+		FMath::Max(1, m_pSession->settings.screenPercentages.Num()), m_pSession->settings.bCPUOnly ? TEXT("CPU-only") : TEXT("full"));
+}
+
+void AGWPlayerController::StartBenchmarkRun()
+{
+	if (m_pSession->currentRun >= m_pSession->runs.Num())
+	{
+		EndBenchmark(m_pSession->numFailedRuns > 0 ? 1 : 0);
+		return;
+	}
+
+	const FBenchmarkRun& run = m_pSession->runs[m_pSession->currentRun];
+	m_pSession->currentScene = m_SceneNames.IndexOfByKey(run.scene);
+
+	if (UGameplayStatics::GetCurrentLevelName(GetWorld()) != run.scene.ToString())
+	{
+		if (m_pSession->bIsAwaitingLevel)
+		{
+			// We asked for this level and ended up somewhere else, every run of the scene fails
+			UE_LOG(LogTemp, Error, TEXT("Benchmark could not load %s."), *run.scene.ToString());
+			m_pSession->bIsAwaitingLevel = false;
+
+			const FName failedScene = run.scene;
+			while (m_pSession->currentRun < m_pSession->runs.Num() && m_pSession->runs[m_pSession->currentRun].scene == failedScene)
+			{
+				++m_pSession->currentRun;
+				++m_pSession->numFailedRuns;
+			}
+			StartBenchmarkRun();
+			return;
+		}
+
+		m_pSession->bIsAwaitingLevel = true;
+		GetBenchmarkSubsystem()->OpenLevel(GetWorld(), run.scene);
+		return;
+	}
+	m_pSession->bIsAwaitingLevel = false;
+
+	m_CurrentMode = run.mode;
+	TransparencyMode::Apply(m_CurrentMode);
+	m_CurrentPos = run.position;
+	if (run.screenPercentage > 0.f)
+	{
+		ApplyScreenPercentage(run.screenPercentage);
+	}
+
+	const FBenchmarkSettings& settings = m_pSession->settings;
+	const bool bIsPathRun = m_CurrentPos == FBenchmarkRun::PathPosition;
+	if (bIsPathRun)
+	{
+		if (!LoadCameraPath())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Benchmark scene %s has no camera path."), *run.scene.ToString());
+			FinishBenchmarkRun(false);
+			return;
+		}
+
+		GetPawn()->SetActorTransform(m_CameraPath.Evaluate(0.f));
+		m_pPerformanceLogger->SetTraceMetadata("Position", FString::Printf(TEXT("Path (%.1f s at %.0f fps)"), m_CameraPath.GetDuration(), settings.pathFrameRate));
+	}
+	else if (UsesFixedPositions())
+	{
+		if (!m_Positions.IsValidIndex(m_CurrentPos))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Benchmark position %d does not exist."), m_CurrentPos);
+			FinishBenchmarkRun(false);
+			return;
+		}
+
+		GetPawn()->SetActorTransform(m_Positions[m_CurrentPos]);
+	}
+
+	// Falling back to the base material would measure uncolored cubes, which is not the scene the actor mode renders
+	if (const ATransparentHeavyLevel* pHeavyLevel = GetTransparentHeavyLevel(); pHeavyLevel && !pHeavyLevel->CanRenderSpawnMode())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Benchmark scene %s needs /Game/Materials/M_Translucent_Emissive_Instanced for its spawn mode, create it with -run=InstancedMaterial."),
+			*run.scene.ToString());
+		FinishBenchmarkRun(false);
+		return;
+	}
+
+	if (!bIsPathRun)
+	{
+		SetTracePosition();
+	}
+
+	// A path always plays from start to end, stopping early would leave segments out
+	m_pPerformanceLogger->SetDuration(bIsPathRun ? m_CameraPath.GetDuration() : settings.durationSeconds);
+	m_pPerformanceLogger->SetEarlyStop(settings.minDurationSeconds, bIsPathRun ? 0.0 : settings.targetPrecision);
+
+	// Runs of the same view are compared across modes and sessions
+	const FString viewName = GetViewName(m_pSession->currentScene, m_CurrentPos);
+	m_pPerformanceLogger->SetTraceMetadata("View", viewName);
+
+	FString runName = FString::Printf(TEXT("%s_%s"), *run.scene.ToString(), *GetPositionName(m_CurrentPos));
+	if (run.screenPercentage > 0.f)
+	{
+		// The resolution fit groups the runs that only differ in screen percentage
+		runName += '_' + GetScreenPercentageName(run.screenPercentage);
+		m_pPerformanceLogger->SetTraceMetadata("ScalingView", GetViewName(m_pSession->currentScene, m_CurrentPos, false));
+	}
+	if (m_pSession->settings.slices > 1)
+	{
+		runName += FString::Printf(TEXT("_s%d"), run.slice);
+		m_pPerformanceLogger->SetTraceMetadata("Slice", FString::Printf(TEXT("%d/%d"), run.slice + 1, m_pSession->settings.slices));
+	}
+	if (const ATransparentHeavyLevel* pHeavyLevel = GetTransparentHeavyLevel(); pHeavyLevel && pHeavyLevel->GetNumSweepSteps() > 1)
+	{
+		runName += '_' + pHeavyLevel->GetSweepStepName();
+	}
+	if (run.bIsMinimalInstrumentation)
+	{
+		runName += TEXT("_min");
+	}
+	m_pPerformanceLogger->SetMinimalInstrumentation(run.bIsMinimalInstrumentation);
+	m_pPerformanceLogger->SetRunNames(runName, GetPlayerModeString());
+	m_AccuTime = 0;
+	m_bIsRunTracking = false;
+	m_bHasAnalyzedOverdraw = false;
+	m_NextCapture = 0;
+	m_WarmupDetector.Reset();
+
+	if (m_bHasPrecached == false)
+	{
+		StartPrecache();
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Benchmark run %d/%d: %s, %s, position %s, slice %d%s%s."),
+		m_pSession->currentRun + 1, m_pSession->runs.Num(), *run.scene.ToString(), *GetPlayerModeString(), *GetPositionName(m_CurrentPos), run.slice + 1,
+		run.screenPercentage > 0.f ? *FString::Printf(TEXT(", %s%% screen percentage"), *FString::SanitizeFloat(run.screenPercentage, 0)) : TEXT(""),
+		run.bIsMinimalInstrumentation ? TEXT(", minimal instrumentation") : TEXT(""));
+}
+
+void AGWPlayerController::TickBenchmark(const float deltaTime)
+{
+	// Nothing to measure until the next level is loaded
+	if (m_pSession->bIsAwaitingLevel)
+		return;
+
+	if (m_bIsPrecaching)
+	{
+		TickPrecache(deltaTime);
+		return;
+	}
+
+	m_AccuTime += deltaTime;
+
+	if (m_bIsRunTracking == false)
+	{
+		if (m_bHasAnalyzedOverdraw || TickWarmup(deltaTime))
+			StartRunTracking();
+		return;
+	}
+
+	// The logger stops by itself after the duration or once the stats are precise enough
+	if (m_pPerformanceLogger->IsTracking())
+	{
+		if (m_bIsPlayingPath)
+		{
+			TickPathPlayback(deltaTime);
+		}
+
+		const FBenchmarkSettings& settings = m_pSession->settings;
+		const float runDuration = m_bIsPlayingPath ? m_CameraPath.GetDuration() : settings.durationSeconds;
+
+		// Spread over the run, captured and encoded off the game thread so the tracked frames do not see them
+		if (settings.bCPUOnly == false && !IsMinimalInstrumentationRun() && m_NextCapture < settings.capturesPerRun
+			&& m_pPerformanceLogger->GetElapsedTime() >= runDuration * static_cast<float>(m_NextCapture + 1) / static_cast<float>(settings.capturesPerRun + 1))
+		{
+			TakeScreenshot_Helper(m_pSession->currentScene, m_CurrentPos, FString::Printf(TEXT("_c%d"), m_NextCapture));
+			++m_NextCapture;
+		}
+
+		const float timeout = FMath::Max(settings.warmupSeconds, settings.maxWarmupSeconds) + runDuration * 2.f + 60.f;
+		if (m_AccuTime > timeout)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Benchmark run %d timed out."), m_pSession->currentRun + 1);
+			m_pPerformanceLogger->StopTracking();
+			FinishBenchmarkRun(false);
+		}
+		return;
+	}
+
+	FinishBenchmarkRun(true);
+}
+
+void AGWPlayerController::StartPrecache()
+{
+	m_bHasPrecached = true;
+
+	const FBenchmarkSettings& settings = m_pSession->settings;
+	if (settings.bCPUOnly || settings.precacheFramesPerMode == 0)
+	{
+		m_pPerformanceLogger->RemoveTraceMetadata("Precache");
+		PreloadNextLevel();
+		return;
+	}
+
+	m_bIsPrecaching = true;
+	m_PrecacheMode = 0;
+	m_PrecacheFrames = 0;
+	m_PrecacheStats = FLoadPhaseStats();
+	TransparencyMode::Apply(settings.modes[m_PrecacheMode]);
+}
+
+void AGWPlayerController::TickPrecache(const float deltaTime)
+{
+	m_PrecacheStats.AddFrame(deltaTime);
+
+	// Every mode draws its translucency permutations from the run's view, which requests their PSOs
+	const FBenchmarkSettings& settings = m_pSession->settings;
+	if (m_PrecacheMode < settings.modes.Num())
+	{
+		if (++m_PrecacheFrames < settings.precacheFramesPerMode)
+			return;
+
+		m_PrecacheFrames = 0;
+		if (++m_PrecacheMode < settings.modes.Num())
+		{
+			TransparencyMode::Apply(settings.modes[m_PrecacheMode]);
+			return;
+		}
+
+		TransparencyMode::Apply(m_CurrentMode);
+	}
+
+	// The requests compile in the background, the warm-up only starts once they are done
+	const uint32 numPending = GetNumPendingShaderWork();
+	if (numPending > 0 && m_PrecacheStats.seconds < MaxPrecacheSeconds)
+		return;
+
+	if (numPending > 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%u PSOs and shaders were still compiling after %.0f s of precaching."), numPending, MaxPrecacheSeconds);
+	}
+
+	m_bIsPrecaching = false;
+	m_pPerformanceLogger->SetTraceMetadata("Precache", m_PrecacheStats.ToString());
+	UE_LOG(LogTemp, Log, TEXT("Precached %d modes: %s."), settings.modes.Num(), *m_PrecacheStats.ToString());
+
+	m_AccuTime = 0;
+	m_WarmupDetector.Reset();
+	PreloadNextLevel();
+}
+
+void AGWPlayerController::PreloadNextLevel() const
+{
+	if (m_pSession->settings.bPreloadLevels == false)
+		return;
+
+	// Runs are scene major, the first run on another scene is the next level that gets opened
+	const FName currentScene = m_pSession->runs[m_pSession->currentRun].scene;
+	for (int32 i = m_pSession->currentRun + 1; i < m_pSession->runs.Num(); ++i)
+	{
+		if (m_pSession->runs[i].scene != currentScene)
+		{
+			GetBenchmarkSubsystem()->PreloadLevel(m_pSession->runs[i].scene);
+			return;
+		}
 	}
 }
 
+void AGWPlayerController::FinishBenchmarkRun(const bool bSucceeded)
+{
+	StopPathPlayback();
+
+	if (bSucceeded == false)
+	{
+		++m_pSession->numFailedRuns;
+	}
+	else if (m_pSession->settings.bCPUOnly == false && !IsMinimalInstrumentationRun())
+	{
+		// Compared against the raytracing capture of the same view when the session report is written
+		GetBenchmarkSubsystem()->SetLastRunCapture(TakeScreenshot_Helper(m_pSession->currentScene, m_CurrentPos));
+	}
+
+	// The next run changes the view, the scene or the level, so every capture of this run has to be done first
+	WaitForCaptures([this, bSucceeded]() { ContinueBenchmark(bSucceeded); });
+}
+
+void AGWPlayerController::ContinueBenchmark(const bool bSucceeded)
+{
+	// Not before the captures are done, they are taken at the run's resolution
+	RestoreScreenPercentage();
+
+	// A depth complexity sweep repeats the run once per step, the level stays loaded in between
+	if (ATransparentHeavyLevel* pHeavyLevel = GetTransparentHeavyLevel())
+	{
+		const int32 nextStep = pHeavyLevel->GetSweepStep() + 1;
+		if (bSucceeded && nextStep < pHeavyLevel->GetNumSweepSteps())
+		{
+			pHeavyLevel->ApplySweepStep(nextStep);
+			StartBenchmarkRun();
+			return;
+		}
+
+		if (pHeavyLevel->GetSweepStep() != 0)
+			pHeavyLevel->ApplySweepStep(0);
+	}
+
+	++m_pSession->currentRun;
+	StartBenchmarkRun();
+}
+
+void AGWPlayerController::WaitForCaptures(TFunction<void()> onFinished)
+{
+	m_bIsAwaitingCaptures = true;
+	m_CaptureWaitTime = 0;
+	m_OnCapturesFinished = MoveTemp(onFinished);
+
+	const uint32 waitId = ++m_CaptureWaitId;
+	GetBenchmarkSubsystem()->GetScreenshotCapture().NotifyWhenIdle([pWeakThis = TWeakObjectPtr<AGWPlayerController>(this), waitId]()
+	{
+		if (AGWPlayerController* pThis = pWeakThis.Get())
+		{
+			pThis->OnCapturesFinished(waitId);
+		}
+	});
+}
+
+void AGWPlayerController::OnCapturesFinished(const uint32 waitId)
+{
+	// Either the captures finished or the wait timed out, only the first one continues.
+	// A wait that timed out may still report in later, during the next one
+	if (m_bIsAwaitingCaptures == false || waitId != m_CaptureWaitId)
+		return;
+
+	m_bIsAwaitingCaptures = false;
+	const TFunction<void()> onFinished = MoveTemp(m_OnCapturesFinished);
+	m_OnCapturesFinished = nullptr;
+	onFinished();
+}
+
+void AGWPlayerController::EndBenchmark(const int32 exitCode)
+{
+	m_pSession->bIsBenchmarking = false;
+	RestoreScreenPercentage();
+
+	UE_LOG(LogTemp, Display, TEXT("Benchmark finished: %d runs, %d failed, exit code %d."), m_pSession->runs.Num(), m_pSession->numFailedRuns, exitCode);
+	GetBenchmarkSubsystem()->WriteSessionReport();
+	FPlatformMisc::RequestExitWithStatus(false, static_cast<uint8>(exitCode));
+}
+
+UBenchmarkSubsystem* AGWPlayerController::GetBenchmarkSubsystem() const
+{
+	return GetGameInstance()->GetSubsystem<UBenchmarkSubsystem>();
+}
+
+ATransparentHeavyLevel* AGWPlayerController::GetTransparentHeavyLevel() const
+{
+	return Cast<ATransparentHeavyLevel>(GetWorld()->GetLevelScriptActor());
+}
+
 FString AGWPlayerController::GetPlayerModeString() const
 {
-	switch (m_CurrentMode)
+	return TransparencyMode::GetDisplayString(m_CurrentMode);
+}
+
+FString AGWPlayerController::GetPositionName(const int32 position) const
+{
+	return position == FBenchmarkRun::PathPosition ? FString(TEXT("path")) : FString::FromInt(position);
+}
+
+FString AGWPlayerController::GetViewName(const int32 scene, const int32 position, const bool bWithScreenPercentage) const
+{
+	FString viewName = m_SceneNames[scene].ToString() + '_' + GetPositionName(position);
+	if (const ATransparentHeavyLevel* pHeavyLevel = GetTransparentHeavyLevel(); pHeavyLevel && pHeavyLevel->GetNumSweepSteps() > 1)
 	{
-	case EMode::odt:
-		return "Order-Dependant Transparency";
-	case EMode::oit:
-		return "Order-Independent Transparency";
-	case EMode::raytracing:
-		return "Raytracing";
+		viewName += '_' + pHeavyLevel->GetSweepStepName();
 	}
-	
-	return "";
+	// Captures at different resolutions are compared separately, so they need their own names
+	if (const float screenPercentage = GetRunScreenPercentage(); bWithScreenPercentage && screenPercentage > 0.f)
+	{
+		viewName += '_' + GetScreenPercentageName(screenPercentage);
+	}
+	return viewName;
+}
+
+float AGWPlayerController::GetRunScreenPercentage() const
+{
+	return m_pSession->bIsBenchmarking && m_pSession->runs.IsValidIndex(m_pSession->currentRun)
+		? m_pSession->runs[m_pSession->currentRun].screenPercentage : 0.f;
 }
 
-void AGWPlayerController::TakeScreenshot_Helper(const int curScene, const int curPos) const
+void AGWPlayerController::ApplyScreenPercentage(const float percentage)
 {
-	FString fileName = m_SceneNames[curScene].ToString() + '_';
-	fileName.AppendInt(curPos);
+	if (IConsoleVariable* pCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.ScreenPercentage")))
+	{
+		if (m_pSession->savedScreenPercentage <= 0.f)
+		{
+			m_pSession->savedScreenPercentage = pCVar->GetFloat();
+		}
+		pCVar->Set(percentage, ECVF_SetByCode);
+	}
+
+	// Scaled per axis, so the pixel count goes with the square of the percentage
+	int32 viewportWidth = 0;
+	int32 viewportHeight = 0;
+	GetViewportSize(viewportWidth, viewportHeight);
+	const int32 renderWidth = FMath::Max(1, FMath::RoundToInt32(viewportWidth * percentage / 100.f));
+	const int32 renderHeight = FMath::Max(1, FMath::RoundToInt32(viewportHeight * percentage / 100.f));
+
+	m_pPerformanceLogger->SetTraceMetadata("ScreenPercentage", FString::SanitizeFloat(percentage, 0));
+	m_pPerformanceLogger->SetTraceMetadata("RenderResolution", FString::Printf(TEXT("%dx%d"), renderWidth, renderHeight));
+	m_pPerformanceLogger->SetTraceMetadata("RenderPixels", FString::Printf(TEXT("%lld"), static_cast<int64>(renderWidth) * renderHeight));
+}
+
+void AGWPlayerController::RestoreScreenPercentage()
+{
+	if (m_pSession->savedScreenPercentage <= 0.f)
+		return;
+
+	if (IConsoleVariable* pCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("r.ScreenPercentage")))
+	{
+		pCVar->Set(m_pSession->savedScreenPercentage, ECVF_SetByCode);
+	}
+	m_pSession->savedScreenPercentage = 0.f;
+
+	m_pPerformanceLogger->RemoveTraceMetadata("ScreenPercentage");
+	m_pPerformanceLogger->RemoveTraceMetadata("RenderResolution");
+	m_pPerformanceLogger->RemoveTraceMetadata("RenderPixels");
+}
+
+bool AGWPlayerController::UsesFixedPositions() const
+{
+	// The transparency heavy level spawns its cubes in front of the origin, it does not use the Sponza positions
+	return m_pSession->currentScene != 4;
+}
+
+bool AGWPlayerController::IsMinimalInstrumentationRun() const
+{
+	return m_pSession->bIsBenchmarking && m_pSession->runs.IsValidIndex(m_pSession->currentRun)
+		&& m_pSession->runs[m_pSession->currentRun].bIsMinimalInstrumentation;
+}
+
+void AGWPlayerController::SetTracePosition() const
+{
+	if (m_Positions.IsValidIndex(m_CurrentPos))
+	{
+		m_pPerformanceLogger->SetTraceMetadata("Position", FString::Printf(TEXT("%d (%s)"), m_CurrentPos, *m_Positions[m_CurrentPos].ToString()));
+	}
+	else if (const APawn* pPawn = GetPawn())
+	{
+		m_pPerformanceLogger->SetTraceMetadata("Position", FString::Printf(TEXT("Free (%s)"), *pPawn->GetActorTransform().ToString()));
+	}
+}
+
+void AGWPlayerController::AnalyzeOverdraw() const
+{
+	if (!PlayerCameraManager)
+		return;
+
+	// Same aspect ratio as the frames being measured, a path run is analyzed from where it starts
+	FVector2D viewportSize(16.0, 9.0);
+	if (GEngine->GameViewport)
+	{
+		GEngine->GameViewport->GetViewportSize(viewportSize);
+	}
+	const int32 gridWidth = m_pSession->settings.layerGridWidth;
+	const int32 gridHeight = FMath::Max(1, FMath::RoundToInt32(gridWidth * viewportSize.Y / FMath::Max(1.0, viewportSize.X)));
+
+	FBoxBVH bvh;
+	const double buildStartTime = FPlatformTime::Seconds();
+	bvh.Build(OverdrawAnalysis::GatherTranslucentBounds(GetWorld()));
+	const double buildMs = (FPlatformTime::Seconds() - buildStartTime) * 1000.0;
+
+	TArray<float> layerMap;
+	FOverdrawSummary overdraw = OverdrawAnalysis::Analyze(bvh, PlayerCameraManager->GetCameraLocation(), PlayerCameraManager->GetCameraRotation(),
+		PlayerCameraManager->GetFOVAngle(), gridWidth, gridHeight, &layerMap);
+	overdraw.analyzeMs += buildMs;
+
+	UE_LOG(LogTemp, Log, TEXT("View has %.2f translucent layers where covered, %d max, over %d primitives (%.1f ms)."),
+		overdraw.meanCoveredLayers, overdraw.maxLayers, overdraw.numPrimitives, overdraw.analyzeMs);
+	m_pPerformanceLogger->SetOverdraw(overdraw, MoveTemp(layerMap));
+}
+
+FString AGWPlayerController::TakeScreenshot_Helper(const int curScene, const int curPos, const FString& suffix) const
+{
+	const FString fileName = GetViewName(curScene, curPos) + suffix;
 	
 	const FString timestamp = FDateTime::Now().ToString(TEXT("%Y-%m-%d"));
-	const FString directoryPath = FPaths::ProjectDir() / "Screenshots" / timestamp;
-	if (!FPaths::DirectoryExists(directoryPath))
+	const FString root = m_pSession->settings.outputDirectory.IsEmpty() ? FPaths::ProjectDir() : m_pSession->settings.outputDirectory;
+	FString directoryPath = root / "Screenshots" / timestamp;
+	if (m_pSession->bIsBenchmarking)
 	{
-		FPlatformFileManager::Get().GetPlatformFile().CreateDirectoryTree(*directoryPath);
+		// Every mode is captured from the same positions
+		directoryPath /= GetPlayerModeString();
 	}
 
-	const FString fullFilePath = directoryPath / fileName;
-	FScreenshotRequest::RequestScreenshot(fullFilePath, false, false);
-
-	UE_LOG(LogTemp, Log, TEXT("Screenshot saved to: %s"), *fullFilePath);
+	// The directory is created by the file writer, no file system work on the game thread
+	return GetBenchmarkSubsystem()->GetScreenshotCapture().Request(directoryPath / fileName);
 }
 
 int32 AGWPlayerController::GetWrappedIndex(const int32 currentIndex, const int32 increment, const int32 max)
@@ -4,19 +4,42 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "CameraPath.h"
+#include "SteadyStateDetector.h"
+#include "TransparencyMode.h"
 #include "GWPlayerController.generated.h"
 
 class FPerformanceLogger;
+struct FBenchmarkSessionState;
+class UBenchmarkSubsystem;
+class ATransparentHeavyLevel;
 struct FInputActionValue;
 class UInputMappingContext;
 class UInputAction;
 
-UENUM(BlueprintType)  // This makes the enum available in both C++ and Blueprints
-enum class EMode : uint8
+// Frames spent precaching or loading in the background, kept out of the tracked stats and reported next to them
+struct FLoadPhaseStats
 {
-	odt			UMETA(DisplayName = "Order-Dependant Transparency"),
-	oit			UMETA(DisplayName = "Order-Independant Transparency"),
-	raytracing	UMETA(DisplayName = "Raytracing"),
+	static constexpr float HitchThresholdMs = 50.f;
+
+	int32 numFrames{ 0 };
+	int32 numHitches{ 0 };
+	float worstFrameMs{ 0 };
+	float seconds{ 0 };
+
+	void AddFrame(const float deltaTime)
+	{
+		const float frameMs = deltaTime * 1000.f;
+		++numFrames;
+		numHitches += frameMs > HitchThresholdMs ? 1 : 0;
+		worstFrameMs = FMath::Max(worstFrameMs, frameMs);
+		seconds += deltaTime;
+	}
+
+	FString ToString() const
+	{
+		return FString::Printf(TEXT("%.1f s, %d frames, %d hitches over %.0f ms, worst %.1f ms"), seconds, numFrames, numHitches, HitchThresholdMs, worstFrameMs);
+	}
 };
 
 UCLASS()
@@ -26,12 +49,18 @@ class GRADWORK_API AGWPlayerController : public APlayerController
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void SetupInputComponent() override;
 
 	virtual void Tick(float DeltaTime) override;
 
+	// Pawn transforms of the fixed views, also read from the class default object by the reference compositor
+	const TArray<FTransform>& GetPositions() const { return m_Positions; }
+
 private:
-	TObjectPtr<FPerformanceLogger> m_pPerformanceLogger{ nullptr };
+	// Both owned by the benchmark subsystem and shared across level loads
+	FPerformanceLogger* m_pPerformanceLogger{ nullptr };
+	FBenchmarkSessionState* m_pSession{ nullptr };
 	
 	UPROPERTY(EditAnywhere, Category = Input, DisplayName= "Input Mapping Context")
 	UInputMappingContext* m_pInputMappingContext{ nullptr }; 
@@ -46,13 +75,39 @@ private:
 	UPROPERTY(EditAnywhere, Category = Input, DisplayName= "Input Action to Start Simulation")
 	UInputAction* m_pInputToStartSimulation{ nullptr };
 
-	static inline bool m_bIsSimulating{ false };
-	float m_AccuTime{ 0 }, m_SimulationTimePerScene{ 60 };
+	float m_AccuTime{ 0 };
+	bool m_bIsRunTracking{ false };
+	// The view was analyzed on this frame, tracking starts on the next one
+	bool m_bHasAnalyzedOverdraw{ false };
+	FWarmupDetector m_WarmupDetector;
+
+	// Played back with a fixed timestep for position "path", or recorded with -RecordCameraPath
+	FCameraPath m_CameraPath;
+	float m_PathTime{ 0 };
+	bool m_bIsPlayingPath{ false };
+	bool m_bIsRecordingPath{ false };
+
+	// Screenshots in flight hold back the next run or level
+	static constexpr float MaxCaptureWaitSeconds = 10.f;
+	bool m_bIsAwaitingCaptures{ false };
+	float m_CaptureWaitTime{ 0 };
+	uint32 m_CaptureWaitId{ 0 };
+	TFunction<void()> m_OnCapturesFinished;
+	int32 m_NextCapture{ 0 };
+
+	// The first run on a level renders every mode before its warm-up, so PSOs and shaders compile outside the tracked window
+	static constexpr float MaxPrecacheSeconds = 60.f;
+	bool m_bHasPrecached{ false };
+	bool m_bIsPrecaching{ false };
+	int32 m_PrecacheMode{ 0 };
+	int32 m_PrecacheFrames{ 0 };
+	FLoadPhaseStats m_PrecacheStats;
+	// Warm-up frames that waited for the next level to load in the background
+	FLoadPhaseStats m_PreloadStats;
 	
 	UPROPERTY(EditAnywhere, DisplayName="Current Mode")
 	EMode m_CurrentMode = EMode::odt;
 	
-	static inline int m_CurrentScene{ -1 };
 	UPROPERTY(EditAnywhere, DisplayName="Scene Names")
 	TArray<FName> m_SceneNames;
 
@@ -66,7 +121,45 @@ private:
 	void TrackStats(const FInputActionValue& value);
 	void StartSimulation(const FInputActionValue& value);
 
+	bool TickWarmup(float deltaTime);
+	void StartRunTracking();
+
+	bool LoadCameraPath();
+	void StartPathPlayback();
+	void TickPathPlayback(float deltaTime);
+	void StopPathPlayback();
+
+	void ParseBenchmarkCommandLine();
+	void StartBenchmarkRun();
+	void TickBenchmark(float deltaTime);
+	void StartPrecache();
+	void TickPrecache(float deltaTime);
+	void PreloadNextLevel() const;
+	void FinishBenchmarkRun(bool bSucceeded);
+	void ContinueBenchmark(bool bSucceeded);
+	void WaitForCaptures(TFunction<void()> onFinished);
+	void OnCapturesFinished(uint32 waitId);
+	void EndBenchmark(int32 exitCode);
+
+	UBenchmarkSubsystem* GetBenchmarkSubsystem() const;
+	ATransparentHeavyLevel* GetTransparentHeavyLevel() const;
 	FString GetPlayerModeString() const;
-	void TakeScreenshot_Helper(int curScene, int curPos) const;
+	FString GetPositionName(int32 position) const;
+	// Scene, position, sweep step and the screen percentage of a resolution sweep, the same in every mode and slice
+	FString GetViewName(int32 scene, int32 position, bool bWithScreenPercentage = true) const;
+	// 0 outside a benchmark and for runs that keep the project's screen percentage
+	float GetRunScreenPercentage() const;
+	// Sets r.ScreenPercentage for a run of a resolution sweep and records the render resolution it leads to
+	void ApplyScreenPercentage(float percentage);
+	// Puts back the screen percentage the sweep overrode, once the run and its captures are done
+	void RestoreScreenPercentage();
+	bool UsesFixedPositions() const;
+	// Runs that only time frames take no captures, the paired full run captures the same view
+	bool IsMinimalInstrumentationRun() const;
+	void SetTracePosition() const;
+	// Counts the translucent layers of the current view for the run that is about to be tracked
+	void AnalyzeOverdraw() const;
+	// Returns the file the capture will be written to
+	FString TakeScreenshot_Helper(int curScene, int curPos, const FString& suffix = FString()) const;
 	static int32 GetWrappedIndex(int32 currentIndex, int32 increment, int32 max);
 };
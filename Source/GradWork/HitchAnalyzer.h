@@ -0,0 +1,232 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreamingHistogram.h"
+#include <algorithm>
+
+// The thread that took longest in a hitch frame
+enum class EHitchCause : uint8
+{
+	GameThread,
+	RenderThread,
+	GPU,
+	// None of the measured threads explains the frame, e.g. a stall on IO or on present
+	Unknown,
+	Count
+};
+
+inline const TCHAR* GetHitchCauseName(const EHitchCause cause)
+{
+	switch (cause)
+	{
+	case EHitchCause::GameThread:	return TEXT("Game");
+	case EHitchCause::RenderThread:	return TEXT("Render");
+	case EHitchCause::GPU:			return TEXT("GPU");
+	default:						return TEXT("Unknown");
+	}
+}
+
+struct FHitch
+{
+	uint64 frameNumber;
+	// Frame of the tracked window and wall clock seconds since tracking started
+	int32 frameIndex;
+	double timestamp;
+	double frameTime;
+	// Rolling median of the frames before the hitch
+	double medianFrameTime;
+	double gameThreadTime;
+	double renderThreadTime;
+	double gpuTime;
+	EHitchCause cause;
+	int32 cluster;
+};
+
+struct FHitchSummary
+{
+	int32 numFrames{ 0 };
+	double trackedSeconds{ 0 };
+	int32 numHitches{ 0 };
+	int32 numPerCause[static_cast<int32>(EHitchCause::Count)]{};
+	// Hitches a few frames apart are one cluster, a player sees a cluster as a single stutter
+	int32 numClusters{ 0 };
+	int32 largestCluster{ 0 };
+	// Time the hitches took above the median, what a player actually loses
+	double timeLostMs{ 0 };
+	// Frame pacing, the absolute change in frame time between consecutive frames
+	double meanJitter{ 0 };
+	double p95Jitter{ 0 };
+	double p99Jitter{ 0 };
+	// The first hitches of the window, the counts above include the ones that did not fit
+	TArray<FHitch> hitches;
+
+	double GetHitchesPerMinute() const { return trackedSeconds > 0.0 ? numHitches * 60.0 / trackedSeconds : 0.0; }
+};
+
+/**
+ * Finds the frames a trimmed mean hides: a frame is a hitch when it is over an absolute budget or over a multiple of the
+ * median of the frames before it. Each hitch is blamed on the game thread, render thread or GPU, whichever took longest.
+ * The rolling median keeps a sorted copy of a fixed window, so every frame costs the same and nothing is allocated
+ * while tracking.
+ */
+class FHitchAnalyzer
+{
+public:
+	struct FSettings
+	{
+		// 0 only uses the median
+		double budgetMs{ 0.0 };
+		double medianMultiplier{ 2.0 };
+		int32 clusterGapFrames{ 10 };
+		int32 maxRecordedHitches{ 256 };
+	};
+
+	explicit FHitchAnalyzer(const FSettings& settings = FSettings())
+		: m_Settings(settings)
+		, m_JitterHistogram(1000.0)
+	{
+		m_Hitches.Reserve(m_Settings.maxRecordedHitches);
+		Reset();
+	}
+
+	void SetThresholds(const double budgetMs, const double medianMultiplier)
+	{
+		m_Settings.budgetMs = budgetMs;
+		m_Settings.medianMultiplier = medianMultiplier;
+	}
+
+	void Reset()
+	{
+		m_Summary = FHitchSummary();
+		m_Hitches.Reset();
+		m_JitterHistogram.Reset();
+		m_NumWindowFrames = 0;
+		m_WindowHead = 0;
+		m_PreviousFrameTime = -1.0;
+		m_LastHitchFrameIndex = INDEX_NONE;
+		m_CurrentClusterSize = 0;
+	}
+
+	void AddFrame(const uint64 frameNumber, const double timestamp, const double frameTime,
+		const double gameThreadTime, const double renderThreadTime, const double gpuTime)
+	{
+		const int32 frameIndex = m_Summary.numFrames++;
+
+		if (m_PreviousFrameTime >= 0.0)
+		{
+			m_JitterHistogram.Record(FMath::Abs(frameTime - m_PreviousFrameTime));
+		}
+		m_PreviousFrameTime = frameTime;
+
+		// Compared against the frames before it, so a hitch does not raise its own threshold
+		const double median = GetMedian();
+		const bool bIsOverBudget = m_Settings.budgetMs > 0.0 && frameTime > m_Settings.budgetMs;
+		const bool bIsOverMedian = m_NumWindowFrames >= MinWindowFrames && frameTime > median * m_Settings.medianMultiplier;
+		if (bIsOverBudget || bIsOverMedian)
+		{
+			AddHitch({ frameNumber, frameIndex, timestamp, frameTime, median, gameThreadTime, renderThreadTime, gpuTime,
+				Classify(frameTime, gameThreadTime, renderThreadTime, gpuTime), 0 });
+		}
+
+		AddToWindow(frameTime);
+	}
+
+	FHitchSummary Summarize(const double trackedSeconds) const
+	{
+		FHitchSummary summary = m_Summary;
+		summary.trackedSeconds = trackedSeconds;
+		summary.hitches = m_Hitches;
+
+		const FHistogramSummary jitter = m_JitterHistogram.Summarize(0.0);
+		summary.meanJitter = jitter.mean;
+		summary.p95Jitter = jitter.p95;
+		summary.p99Jitter = jitter.p99;
+		return summary;
+	}
+
+private:
+	// Two seconds at 60 fps, the median follows the scene without reacting to a single spike
+	static constexpr int32 MedianWindowFrames = 121;
+	static constexpr int32 MinWindowFrames = 30;
+
+	FSettings m_Settings;
+	FHitchSummary m_Summary;
+	TArray<FHitch> m_Hitches;
+	FStreamingHistogram m_JitterHistogram;
+
+	// Frame times in arrival order and the same values sorted
+	double m_Window[MedianWindowFrames];
+	double m_SortedWindow[MedianWindowFrames];
+	int32 m_NumWindowFrames;
+	int32 m_WindowHead;
+
+	double m_PreviousFrameTime;
+	int32 m_LastHitchFrameIndex;
+	int32 m_CurrentClusterSize;
+
+	double GetMedian() const
+	{
+		if (m_NumWindowFrames == 0)
+			return 0.0;
+
+		const int32 middle = m_NumWindowFrames / 2;
+		return m_NumWindowFrames % 2 == 1 ? m_SortedWindow[middle] : 0.5 * (m_SortedWindow[middle - 1] + m_SortedWindow[middle]);
+	}
+
+	void AddToWindow(const double frameTime)
+	{
+		double* const pBegin = m_SortedWindow;
+		double* pEnd = m_SortedWindow + m_NumWindowFrames;
+
+		// The oldest frame leaves the sorted copy before the new one goes in, both shift at most the whole window
+		if (m_NumWindowFrames == MedianWindowFrames)
+		{
+			double* pOldest = std::lower_bound(pBegin, pEnd, m_Window[m_WindowHead]);
+			std::move(pOldest + 1, pEnd, pOldest);
+			--pEnd;
+		}
+		else
+		{
+			++m_NumWindowFrames;
+		}
+
+		double* pInsert = std::upper_bound(pBegin, pEnd, frameTime);
+		std::move_backward(pInsert, pEnd, pEnd + 1);
+		*pInsert = frameTime;
+
+		m_Window[m_WindowHead] = frameTime;
+		m_WindowHead = (m_WindowHead + 1) % MedianWindowFrames;
+	}
+
+	void AddHitch(FHitch hitch)
+	{
+		const bool bIsSameCluster = m_LastHitchFrameIndex != INDEX_NONE && hitch.frameIndex - m_LastHitchFrameIndex <= m_Settings.clusterGapFrames;
+		m_CurrentClusterSize = bIsSameCluster ? m_CurrentClusterSize + 1 : 1;
+		if (!bIsSameCluster)
+		{
+			++m_Summary.numClusters;
+		}
+		m_LastHitchFrameIndex = hitch.frameIndex;
+		hitch.cluster = m_Summary.numClusters - 1;
+
+		++m_Summary.numHitches;
+		++m_Summary.numPerCause[static_cast<int32>(hitch.cause)];
+		m_Summary.largestCluster = FMath::Max(m_Summary.largestCluster, m_CurrentClusterSize);
+		m_Summary.timeLostMs += FMath::Max(0.0, hitch.frameTime - hitch.medianFrameTime);
+
+		if (m_Hitches.Num() < m_Settings.maxRecordedHitches)
+		{
+			m_Hitches.Add(hitch);
+		}
+	}
+
+	static EHitchCause Classify(const double frameTime, const double gameThreadTime, const double renderThreadTime, const double gpuTime)
+	{
+		const double longest = FMath::Max3(gameThreadTime, renderThreadTime, gpuTime);
+		if (longest < 0.5 * frameTime)
+			return EHitchCause::Unknown;
+		if (longest == gpuTime)
+			return EHitchCause::GPU;
+		return longest == renderThreadTime ? EHitchCause::RenderThread : EHitchCause::GameThread;
+	}
+};
@@ -0,0 +1,655 @@
+#include "ImageQuality.h"
+
+#include "Async/ParallelFor.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+
+namespace
+{
+	// Rows handed to one task, enough work to hide the scheduling and few enough bands to balance
+	constexpr int32 BandRows = 32;
+
+	// FLIP constants from the paper, color and feature error exponents and the error redistribution point
+	constexpr float FlipQc = 0.7f;
+	constexpr float FlipQf = 0.5f;
+	constexpr float FlipPc = 0.4f;
+	constexpr float FlipPt = 0.95f;
+	// Width of the feature detection filters in degrees
+	constexpr float FlipFeatureWidth = 0.082f;
+
+	// D65 white of linear sRGB in XYZ
+	const FVector3f ReferenceWhite(0.9505f, 1.f, 1.089f);
+
+	// Centered, 2 * radius + 1 taps
+	using FKernel = TArray<float>;
+
+	// Calls function(firstRow, endRow) for every band, in parallel
+	template <typename FunctionType>
+	void ParallelForBands(const int32 height, FunctionType&& function)
+	{
+		const int32 numBands = FMath::DivideAndRoundUp(height, BandRows);
+		ParallelFor(numBands, [&function, height](const int32 band)
+		{
+			function(band * BandRows, FMath::Min(height, (band + 1) * BandRows));
+		});
+	}
+
+	float HorizontalSum(const VectorRegister4Float& vector)
+	{
+		alignas(16) float values[4];
+		VectorStoreAligned(vector, values);
+		return values[0] + values[1] + values[2] + values[3];
+	}
+
+	// Sums in float per row and in double across rows, so large images do not lose precision.
+	// Images stay far below 2^31 pixels, indices are int32 like the arrays that hold them
+	template <typename FunctionType>
+	double ParallelSum(const int32 width, const int32 height, FunctionType&& rowSum)
+	{
+		TArray<double> bandSums;
+		bandSums.SetNumZeroed(FMath::DivideAndRoundUp(height, BandRows));
+		ParallelForBands(height, [&](const int32 firstRow, const int32 endRow)
+		{
+			double sum = 0.0;
+			for (int32 y = firstRow; y < endRow; ++y)
+			{
+				sum += rowSum(y * width);
+			}
+			bandSums[firstRow / BandRows] = sum;
+		});
+
+		double sum = 0.0;
+		for (const double bandSum : bandSums)
+		{
+			sum += bandSum;
+		}
+		return sum;
+	}
+
+	double Mean(const TArray<float>& values, const int32 width, const int32 height)
+	{
+		const double sum = ParallelSum(width, height, [&values, width](const int32 rowStart)
+		{
+			const float* pRow = values.GetData() + rowStart;
+			VectorRegister4Float sum = VectorZeroFloat();
+			int32 x = 0;
+			for (; x + 4 <= width; x += 4)
+			{
+				sum = VectorAdd(sum, VectorLoad(pRow + x));
+			}
+
+			float rowSum = HorizontalSum(sum);
+			for (; x < width; ++x)
+			{
+				rowSum += pRow[x];
+			}
+			return static_cast<double>(rowSum);
+		});
+		return sum / (static_cast<double>(width) * height);
+	}
+
+	FKernel NormalizeKernel(FKernel kernel)
+	{
+		float sum = 0.f;
+		for (const float weight : kernel)
+		{
+			sum += weight;
+		}
+		for (float& weight : kernel)
+		{
+			weight /= sum;
+		}
+		return kernel;
+	}
+
+	FKernel MakeGaussian(const float sigma, const int32 radius)
+	{
+		FKernel kernel;
+		for (int32 x = -radius; x <= radius; ++x)
+		{
+			kernel.Add(FMath::Exp(-static_cast<float>(x * x) / (2.f * sigma * sigma)));
+		}
+		return kernel;
+	}
+
+	// Scales the positive and the negative lobe to a sum of 1 and -1, like FLIP does for its feature filters
+	FKernel NormalizeLobes(FKernel kernel)
+	{
+		float positiveSum = 0.f;
+		float negativeSum = 0.f;
+		for (const float weight : kernel)
+		{
+			(weight > 0.f ? positiveSum : negativeSum) += weight;
+		}
+		for (float& weight : kernel)
+		{
+			weight /= weight > 0.f ? positiveSum : -negativeSum;
+		}
+		return kernel;
+	}
+
+	void ConvolveRow(const float* pSrc, float* pDst, const int32 width, const FKernel& kernel)
+	{
+		const int32 radius = kernel.Num() / 2;
+
+		// The borders repeat the edge pixel
+		auto convolvePixel = [&](const int32 x)
+		{
+			float sum = 0.f;
+			for (int32 k = 0; k < kernel.Num(); ++k)
+			{
+				sum += kernel[k] * pSrc[FMath::Clamp(x - radius + k, 0, width - 1)];
+			}
+			pDst[x] = sum;
+		};
+
+		int32 x = 0;
+		for (; x < FMath::Min(radius, width); ++x)
+		{
+			convolvePixel(x);
+		}
+		for (; x + 4 <= width - radius; x += 4)
+		{
+			const float* pTaps = pSrc + x - radius;
+			VectorRegister4Float sum = VectorZeroFloat();
+			for (int32 k = 0; k < kernel.Num(); ++k)
+			{
+				sum = VectorMultiplyAdd(VectorLoad(pTaps + k), VectorSetFloat1(kernel[k]), sum);
+			}
+			VectorStore(sum, pDst + x);
+		}
+		for (; x < width; ++x)
+		{
+			convolvePixel(x);
+		}
+	}
+
+	void ConvolveColumns(const float* pSrc, float* pDst, const int32 width, const int32 height, const int32 firstRow, const int32 endRow, const FKernel& kernel)
+	{
+		const int32 radius = kernel.Num() / 2;
+
+		// Whole rows at a time, so every tap reads memory in order
+		for (int32 y = firstRow; y < endRow; ++y)
+		{
+			float* pDstRow = pDst + y * width;
+			int32 x = 0;
+			for (; x + 4 <= width; x += 4)
+			{
+				VectorRegister4Float sum = VectorZeroFloat();
+				for (int32 k = 0; k < kernel.Num(); ++k)
+				{
+					const int32 srcRow = FMath::Clamp(y - radius + k, 0, height - 1);
+					sum = VectorMultiplyAdd(VectorLoad(pSrc + srcRow * width + x), VectorSetFloat1(kernel[k]), sum);
+				}
+				VectorStore(sum, pDstRow + x);
+			}
+			for (; x < width; ++x)
+			{
+				float sum = 0.f;
+				for (int32 k = 0; k < kernel.Num(); ++k)
+				{
+					const int32 srcRow = FMath::Clamp(y - radius + k, 0, height - 1);
+					sum += kernel[k] * pSrc[srcRow * width + x];
+				}
+				pDstRow[x] = sum;
+			}
+		}
+	}
+
+	// Separable 2D filter, the row kernel runs along x and the column kernel along y
+	void Convolve(const TArray<float>& src, TArray<float>& dst, const int32 width, const int32 height, const FKernel& rowKernel, const FKernel& columnKernel)
+	{
+		TArray<float> rows;
+		rows.SetNumUninitialized(src.Num());
+		ParallelForBands(height, [&](const int32 firstRow, const int32 endRow)
+		{
+			for (int32 y = firstRow; y < endRow; ++y)
+			{
+				const int32 rowStart = y * width;
+				ConvolveRow(src.GetData() + rowStart, rows.GetData() + rowStart, width, rowKernel);
+			}
+		});
+
+		dst.SetNumUninitialized(src.Num());
+		ParallelForBands(height, [&](const int32 firstRow, const int32 endRow)
+		{
+			ConvolveColumns(rows.GetData(), dst.GetData(), width, height, firstRow, endRow, columnKernel);
+		});
+	}
+
+	// Per pixel work in parallel bands, function(pixelIndex)
+	template <typename FunctionType>
+	void ParallelForPixels(const int32 width, const int32 height, FunctionType&& function)
+	{
+		ParallelForBands(height, [&](const int32 firstRow, const int32 endRow)
+		{
+			const int32 end = endRow * width;
+			for (int32 i = firstRow * width; i < end; ++i)
+			{
+				function(i);
+			}
+		});
+	}
+
+	float SRGBToLinear(const float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : FMath::Pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	FVector3f LinearRGBToXYZ(const FVector3f& rgb)
+	{
+		return FVector3f(
+			0.4124f * rgb.X + 0.3576f * rgb.Y + 0.1805f * rgb.Z,
+			0.2126f * rgb.X + 0.7152f * rgb.Y + 0.0722f * rgb.Z,
+			0.0193f * rgb.X + 0.1192f * rgb.Y + 0.9505f * rgb.Z);
+	}
+
+	FVector3f XYZToLinearRGB(const FVector3f& xyz)
+	{
+		return FVector3f(
+			3.2406f * xyz.X - 1.5372f * xyz.Y - 0.4986f * xyz.Z,
+			-0.9689f * xyz.X + 1.8758f * xyz.Y + 0.0415f * xyz.Z,
+			0.0557f * xyz.X - 0.2040f * xyz.Y + 1.0570f * xyz.Z);
+	}
+
+	// Linearized CIELAB, the space FLIP filters in
+	FVector3f XYZToYCxCz(const FVector3f& xyz)
+	{
+		const FVector3f relative = xyz / ReferenceWhite;
+		return FVector3f(116.f * relative.Y - 16.f, 500.f * (relative.X - relative.Y), 200.f * (relative.Y - relative.Z));
+	}
+
+	FVector3f YCxCzToXYZ(const FVector3f& ycxcz)
+	{
+		const float y = (ycxcz.X + 16.f) / 116.f;
+		return FVector3f(ycxcz.Y / 500.f + y, y, y - ycxcz.Z / 200.f) * ReferenceWhite;
+	}
+
+	// CIELAB with the chroma scaled by the lightness (Hunt effect)
+	FVector3f XYZToHuntLab(const FVector3f& xyz)
+	{
+		constexpr float Delta = 6.f / 29.f;
+		auto f = [](const float t)
+		{
+			return t > Delta * Delta * Delta ? FMath::Pow(t, 1.f / 3.f) : t / (3.f * Delta * Delta) + 4.f / 29.f;
+		};
+
+		const FVector3f relative = xyz / ReferenceWhite;
+		const float fy = f(relative.Y);
+		const float l = 116.f * fy - 16.f;
+		return FVector3f(l, 0.01f * l * 500.f * (f(relative.X) - fy), 0.01f * l * 200.f * (fy - f(relative.Z)));
+	}
+
+	float HyAB(const FVector3f& a, const FVector3f& b)
+	{
+		return FMath::Abs(a.X - b.X) + FMath::Sqrt(FMath::Square(a.Y - b.Y) + FMath::Square(a.Z - b.Z));
+	}
+
+	// What FLIP compares of one image, the filtered colors and the feature strengths
+	struct FFlipInput
+	{
+		TArray<float> huntLab[3];
+		TArray<float> edges;
+		TArray<float> points;
+	};
+
+	struct FFlipKernels
+	{
+		// Contrast sensitivity per opponent channel, the blue-yellow one is a weighted sum of two Gaussians
+		FKernel achromatic;
+		FKernel redGreen;
+		FKernel blueYellow[2];
+		float blueYellowWeights[2];
+
+		FKernel featureSmoothing;
+		FKernel edge;
+		FKernel point;
+
+		explicit FFlipKernels(const float pixelsPerDegree)
+		{
+			constexpr float A1BlueYellow = 34.1f;
+			constexpr float B1BlueYellow = 0.04f;
+			constexpr float A2BlueYellow = 13.5f;
+			constexpr float B2BlueYellow = 0.025f;
+			constexpr float BAchromatic = 0.0047f;
+			constexpr float BRedGreen = 0.0053f;
+
+			// exp(-pi^2 * (x / ppd)^2 / b) as a Gaussian in pixels
+			auto toSigma = [pixelsPerDegree](const float b)
+			{
+				return pixelsPerDegree * FMath::Sqrt(b / (2.f * UE_PI * UE_PI));
+			};
+
+			const int32 csfRadius = FMath::CeilToInt(3.f * toSigma(B1BlueYellow));
+			achromatic = NormalizeKernel(MakeGaussian(toSigma(BAchromatic), csfRadius));
+			redGreen = NormalizeKernel(MakeGaussian(toSigma(BRedGreen), csfRadius));
+
+			// Each term of the 2D filter weighs a * sqrt(pi / b) times its separable sum
+			const float as[2] = { A1BlueYellow, A2BlueYellow };
+			const float bs[2] = { B1BlueYellow, B2BlueYellow };
+			float totalWeight = 0.f;
+			for (int32 i = 0; i < 2; ++i)
+			{
+				const FKernel gaussian = MakeGaussian(toSigma(bs[i]), csfRadius);
+				float sum = 0.f;
+				for (const float weight : gaussian)
+				{
+					sum += weight;
+				}
+				blueYellow[i] = NormalizeKernel(gaussian);
+				blueYellowWeights[i] = as[i] * FMath::Sqrt(UE_PI / bs[i]) * sum * sum;
+				totalWeight += blueYellowWeights[i];
+			}
+			for (float& weight : blueYellowWeights)
+			{
+				weight /= totalWeight;
+			}
+
+			const float featureSigma = 0.5f * FlipFeatureWidth * pixelsPerDegree;
+			const int32 featureRadius = FMath::CeilToInt(3.f * featureSigma);
+			featureSmoothing = NormalizeKernel(MakeGaussian(featureSigma, featureRadius));
+			for (int32 x = -featureRadius; x <= featureRadius; ++x)
+			{
+				const float gaussian = FMath::Exp(-static_cast<float>(x * x) / (2.f * featureSigma * featureSigma));
+				edge.Add(-x * gaussian);
+				point.Add((x * x / (featureSigma * featureSigma) - 1.f) * gaussian);
+			}
+			edge = NormalizeLobes(MoveTemp(edge));
+			point = NormalizeLobes(MoveTemp(point));
+		}
+	};
+
+	FFlipInput PrepareFlip(const FQualityImage& image, const FFlipKernels& kernels)
+	{
+		const int32 width = image.width;
+		const int32 height = image.height;
+		const int32 numPixels = width * height;
+
+		TArray<float> ycxcz[3];
+		for (TArray<float>& channel : ycxcz)
+		{
+			channel.SetNumUninitialized(numPixels);
+		}
+		ParallelForPixels(width, height, [&](const int32 i)
+		{
+			const FVector3f linearRGB(SRGBToLinear(image.channels[0][i]), SRGBToLinear(image.channels[1][i]), SRGBToLinear(image.channels[2][i]));
+			const FVector3f value = XYZToYCxCz(LinearRGBToXYZ(linearRGB));
+			ycxcz[0][i] = value.X;
+			ycxcz[1][i] = value.Y;
+			ycxcz[2][i] = value.Z;
+		});
+
+		TArray<float> filtered[3];
+		Convolve(ycxcz[0], filtered[0], width, height, kernels.achromatic, kernels.achromatic);
+		Convolve(ycxcz[1], filtered[1], width, height, kernels.redGreen, kernels.redGreen);
+		TArray<float> blueYellow[2];
+		for (int32 i = 0; i < 2; ++i)
+		{
+			Convolve(ycxcz[2], blueYellow[i], width, height, kernels.blueYellow[i], kernels.blueYellow[i]);
+		}
+
+		FFlipInput input;
+		for (TArray<float>& channel : input.huntLab)
+		{
+			channel.SetNumUninitialized(numPixels);
+		}
+		ParallelForPixels(width, height, [&](const int32 i)
+		{
+			const float filteredBlueYellow = kernels.blueYellowWeights[0] * blueYellow[0][i] + kernels.blueYellowWeights[1] * blueYellow[1][i];
+			FVector3f linearRGB = XYZToLinearRGB(YCxCzToXYZ(FVector3f(filtered[0][i], filtered[1][i], filteredBlueYellow)));
+			linearRGB = FVector3f(FMath::Clamp(linearRGB.X, 0.f, 1.f), FMath::Clamp(linearRGB.Y, 0.f, 1.f), FMath::Clamp(linearRGB.Z, 0.f, 1.f));
+
+			const FVector3f huntLab = XYZToHuntLab(LinearRGBToXYZ(linearRGB));
+			input.huntLab[0][i] = huntLab.X;
+			input.huntLab[1][i] = huntLab.Y;
+			input.huntLab[2][i] = huntLab.Z;
+		});
+
+		// Features are detected in the unfiltered relative luminance, reuse the buffer
+		TArray<float>& luminance = ycxcz[0];
+		ParallelForPixels(width, height, [&luminance](const int32 i)
+		{
+			luminance[i] = (luminance[i] + 16.f) / 116.f;
+		});
+
+		auto featureStrength = [&](const FKernel& kernel, TArray<float>& outStrength)
+		{
+			TArray<float> alongX;
+			TArray<float> alongY;
+			Convolve(luminance, alongX, width, height, kernel, kernels.featureSmoothing);
+			Convolve(luminance, alongY, width, height, kernels.featureSmoothing, kernel);
+
+			outStrength.SetNumUninitialized(numPixels);
+			ParallelForPixels(width, height, [&](const int32 i)
+			{
+				outStrength[i] = FMath::Sqrt(alongX[i] * alongX[i] + alongY[i] * alongY[i]);
+			});
+		};
+		featureStrength(kernels.edge, input.edges);
+		featureStrength(kernels.point, input.points);
+
+		return input;
+	}
+
+	double ComputeFlip(const FQualityImage& reference, const FQualityImage& test, const float pixelsPerDegree, TArray<float>& outFlipMap)
+	{
+		const FFlipKernels kernels(pixelsPerDegree);
+		const FFlipInput referenceInput = PrepareFlip(reference, kernels);
+		const FFlipInput testInput = PrepareFlip(test, kernels);
+
+		// The largest color difference, between pure green and pure blue
+		const float maxColorError = FMath::Pow(HyAB(XYZToHuntLab(LinearRGBToXYZ(FVector3f(0.f, 1.f, 0.f))), XYZToHuntLab(LinearRGBToXYZ(FVector3f(0.f, 0.f, 1.f)))), FlipQc);
+		const float redistributionPoint = FlipPc * maxColorError;
+
+		const int32 width = reference.width;
+		const int32 height = reference.height;
+		outFlipMap.SetNumUninitialized(width * height);
+		ParallelForPixels(width, height, [&](const int32 i)
+		{
+			const FVector3f referenceLab(referenceInput.huntLab[0][i], referenceInput.huntLab[1][i], referenceInput.huntLab[2][i]);
+			const FVector3f testLab(testInput.huntLab[0][i], testInput.huntLab[1][i], testInput.huntLab[2][i]);
+			const float colorError = FMath::Pow(HyAB(referenceLab, testLab), FlipQc);
+
+			// Small differences are compressed into [0, pt], large ones spread over the rest
+			const float redistributed = colorError < redistributionPoint
+				? FlipPt / redistributionPoint * colorError
+				: FlipPt + (colorError - redistributionPoint) / (maxColorError - redistributionPoint) * (1.f - FlipPt);
+
+			const float edgeDifference = FMath::Abs(referenceInput.edges[i] - testInput.edges[i]);
+			const float pointDifference = FMath::Abs(referenceInput.points[i] - testInput.points[i]);
+			const float featureError = FMath::Pow(FMath::Max(edgeDifference, pointDifference) / UE_SQRT_2, FlipQf);
+
+			outFlipMap[i] = FMath::Clamp(FMath::Pow(FMath::Min(redistributed, 1.f), 1.f - featureError), 0.f, 1.f);
+		});
+
+		return Mean(outFlipMap, width, height);
+	}
+
+	double ComputeSSIM(const FQualityImage& reference, const FQualityImage& test, TArray<float>& outErrorMap)
+	{
+		constexpr float C1 = 0.01f * 0.01f;
+		constexpr float C2 = 0.03f * 0.03f;
+		const FKernel window = NormalizeKernel(MakeGaussian(1.5f, 5));
+
+		const int32 width = reference.width;
+		const int32 height = reference.height;
+		const int32 numPixels = width * height;
+
+		// x, y, x^2, y^2 and xy, each filtered by the window afterwards
+		TArray<float> moments[5];
+		for (TArray<float>& moment : moments)
+		{
+			moment.SetNumUninitialized(numPixels);
+		}
+		ParallelForPixels(width, height, [&](const int32 i)
+		{
+			const float x = 0.299f * reference.channels[0][i] + 0.587f * reference.channels[1][i] + 0.114f * reference.channels[2][i];
+			const float y = 0.299f * test.channels[0][i] + 0.587f * test.channels[1][i] + 0.114f * test.channels[2][i];
+			moments[0][i] = x;
+			moments[1][i] = y;
+			moments[2][i] = x * x;
+			moments[3][i] = y * y;
+			moments[4][i] = x * y;
+		});
+		for (TArray<float>& moment : moments)
+		{
+			Convolve(moment, moment, width, height, window, window);
+		}
+
+		outErrorMap.SetNumUninitialized(numPixels);
+		ParallelForBands(height, [&](const int32 firstRow, const int32 endRow)
+		{
+			const VectorRegister4Float c1 = VectorSetFloat1(C1);
+			const VectorRegister4Float c2 = VectorSetFloat1(C2);
+			const VectorRegister4Float two = VectorSetFloat1(2.f);
+			const VectorRegister4Float one = VectorOneFloat();
+
+			const int32 begin = firstRow * width;
+			const int32 end = endRow * width;
+			int32 i = begin;
+			for (; i + 4 <= end; i += 4)
+			{
+				const VectorRegister4Float muX = VectorLoad(moments[0].GetData() + i);
+				const VectorRegister4Float muY = VectorLoad(moments[1].GetData() + i);
+				const VectorRegister4Float muXX = VectorMultiply(muX, muX);
+				const VectorRegister4Float muYY = VectorMultiply(muY, muY);
+				const VectorRegister4Float muXY = VectorMultiply(muX, muY);
+				const VectorRegister4Float sigmaXX = VectorSubtract(VectorLoad(moments[2].GetData() + i), muXX);
+				const VectorRegister4Float sigmaYY = VectorSubtract(VectorLoad(moments[3].GetData() + i), muYY);
+				const VectorRegister4Float sigmaXY = VectorSubtract(VectorLoad(moments[4].GetData() + i), muXY);
+
+				const VectorRegister4Float numerator = VectorMultiply(VectorMultiplyAdd(two, muXY, c1), VectorMultiplyAdd(two, sigmaXY, c2));
+				const VectorRegister4Float denominator = VectorMultiply(VectorAdd(VectorAdd(muXX, muYY), c1), VectorAdd(VectorAdd(sigmaXX, sigmaYY), c2));
+				const VectorRegister4Float ssim = VectorDivide(numerator, denominator);
+
+				// 1 - SSIM, clamped so the map is in [0, 1]
+				VectorStore(VectorMin(VectorMax(VectorSubtract(one, ssim), VectorZeroFloat()), one), outErrorMap.GetData() + i);
+			}
+			for (; i < end; ++i)
+			{
+				const float muX = moments[0][i];
+				const float muY = moments[1][i];
+				const float sigmaXX = moments[2][i] - muX * muX;
+				const float sigmaYY = moments[3][i] - muY * muY;
+				const float sigmaXY = moments[4][i] - muX * muY;
+				const float ssim = (2.f * muX * muY + C1) * (2.f * sigmaXY + C2) / ((muX * muX + muY * muY + C1) * (sigmaXX + sigmaYY + C2));
+				outErrorMap[i] = FMath::Clamp(1.f - ssim, 0.f, 1.f);
+			}
+		});
+
+		return 1.0 - Mean(outErrorMap, width, height);
+	}
+
+	double ComputePSNR(const FQualityImage& reference, const FQualityImage& test)
+	{
+		const int32 width = reference.width;
+		double squaredError = 0.0;
+		for (int32 c = 0; c < 3; ++c)
+		{
+			const float* pReference = reference.channels[c].GetData();
+			const float* pTest = test.channels[c].GetData();
+			squaredError += ParallelSum(width, reference.height, [=](const int32 rowStart)
+			{
+				VectorRegister4Float sum = VectorZeroFloat();
+				int32 x = 0;
+				for (; x + 4 <= width; x += 4)
+				{
+					const VectorRegister4Float difference = VectorSubtract(VectorLoad(pReference + rowStart + x), VectorLoad(pTest + rowStart + x));
+					sum = VectorMultiplyAdd(difference, difference, sum);
+				}
+
+				float rowSum = HorizontalSum(sum);
+				for (; x < width; ++x)
+				{
+					rowSum += FMath::Square(pReference[rowStart + x] - pTest[rowStart + x]);
+				}
+				return static_cast<double>(rowSum);
+			});
+		}
+
+		const double meanSquaredError = squaredError / (3.0 * width * reference.height);
+		return meanSquaredError > 0.0 ? FMath::Min(ImageQuality::MaxPSNR, -10.0 * FMath::LogX(10.0, meanSquaredError)) : ImageQuality::MaxPSNR;
+	}
+}
+
+bool ImageQuality::LoadImage(const FString& filePath, FQualityImage& outImage)
+{
+	TArray64<uint8> compressed;
+	if (!FFileHelper::LoadFileToArray(compressed, *filePath, FILEREAD_Silent))
+		return false;
+
+	IImageWrapperModule& imageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	const TSharedPtr<IImageWrapper> pImageWrapper = imageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	TArray64<uint8> raw;
+	if (!pImageWrapper || !pImageWrapper->SetCompressed(compressed.GetData(), compressed.Num()) || !pImageWrapper->GetRaw(ERGBFormat::BGRA, 8, raw))
+		return false;
+
+	outImage.width = static_cast<int32>(pImageWrapper->GetWidth());
+	outImage.height = static_cast<int32>(pImageWrapper->GetHeight());
+	for (TArray<float>& channel : outImage.channels)
+	{
+		channel.SetNumUninitialized(outImage.width * outImage.height);
+	}
+
+	ParallelForPixels(outImage.width, outImage.height, [&](const int32 i)
+	{
+		const uint8* pPixel = raw.GetData() + i * 4;
+		outImage.channels[0][i] = pPixel[2] / 255.f;
+		outImage.channels[1][i] = pPixel[1] / 255.f;
+		outImage.channels[2][i] = pPixel[0] / 255.f;
+	});
+	return true;
+}
+
+bool ImageQuality::Compare(const FQualityImage& reference, const FQualityImage& test, FImageQualityResult& outResult,
+	TArray<float>* pOutFlipMap, TArray<float>* pOutSsimErrorMap, const float pixelsPerDegree)
+{
+	outResult = FImageQualityResult();
+	if (reference.width != test.width || reference.height != test.height || reference.width == 0 || reference.height == 0)
+		return false;
+
+	TArray<float> flipMap;
+	TArray<float> ssimErrorMap;
+	outResult.psnr = ComputePSNR(reference, test);
+	outResult.ssim = ComputeSSIM(reference, test, ssimErrorMap);
+	outResult.flip = ComputeFlip(reference, test, pixelsPerDegree, flipMap);
+	outResult.bIsValid = true;
+
+	if (pOutFlipMap)
+		*pOutFlipMap = MoveTemp(flipMap);
+	if (pOutSsimErrorMap)
+		*pOutSsimErrorMap = MoveTemp(ssimErrorMap);
+	return true;
+}
+
+bool ImageQuality::WriteHeatmap(const FString& filePath, const TArray<float>& errorMap, const int32 width, const int32 height)
+{
+	// Magma, dark for no error and bright for the largest
+	static const FColor Stops[] =
+	{
+		FColor(0, 0, 4), FColor(28, 16, 68), FColor(79, 18, 123), FColor(129, 37, 129), FColor(181, 54, 122),
+		FColor(229, 80, 100), FColor(251, 135, 97), FColor(254, 194, 135), FColor(252, 253, 191),
+	};
+	constexpr int32 NumStops = UE_ARRAY_COUNT(Stops);
+
+	TArray<FColor> colors;
+	colors.SetNumUninitialized(width * height);
+	ParallelForPixels(width, height, [&](const int32 i)
+	{
+		const float position = FMath::Clamp(errorMap[i], 0.f, 1.f) * (NumStops - 1);
+		const int32 stop = FMath::Min(static_cast<int32>(position), NumStops - 2);
+		const float alpha = position - stop;
+		const FLinearColor from(Stops[stop].R, Stops[stop].G, Stops[stop].B);
+		const FLinearColor to(Stops[stop + 1].R, Stops[stop + 1].G, Stops[stop + 1].B);
+		const FLinearColor color = FMath::Lerp(from, to, alpha);
+		colors[i] = FColor(static_cast<uint8>(color.R), static_cast<uint8>(color.G), static_cast<uint8>(color.B));
+	});
+
+	IImageWrapperModule& imageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	const TSharedPtr<IImageWrapper> pImageWrapper = imageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	if (!pImageWrapper || !pImageWrapper->SetRaw(colors.GetData(), colors.Num() * sizeof(FColor), width, height, ERGBFormat::BGRA, 8))
+		return false;
+
+	return FFileHelper::SaveArrayToFile(pImageWrapper->GetCompressed(), *filePath);
+}
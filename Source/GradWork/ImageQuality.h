@@ -0,0 +1,47 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// How close the capture of a run is to the capture of the same view in the reference mode
+struct FImageQualityResult
+{
+	bool bIsValid{ false };
+	// The run is the reference itself, the metrics are those of identical images
+	bool bIsReference{ false };
+	// Over RGB in dB, capped for identical images
+	double psnr{ 0 };
+	// Mean structural similarity of the luma, 1 is identical
+	double ssim{ 0 };
+	// Mean FLIP error, 0 is identical and 1 the largest perceivable difference
+	double flip{ 0 };
+};
+
+// Planar sRGB capture with values in [0, 1]
+struct FQualityImage
+{
+	int32 width{ 0 };
+	int32 height{ 0 };
+	TArray<float> channels[3];
+};
+
+/**
+ * PSNR, SSIM and LDR-FLIP between a capture and a reference capture.
+ * The filters are separable convolutions over 4-wide SIMD registers, every pass splits the image into bands of rows
+ * that run in parallel. Meant for the end of a session, not for frames that are being tracked.
+ */
+namespace ImageQuality
+{
+	constexpr double MaxPSNR = 100.0;
+	// A 0.7 m wide 4K monitor viewed from 0.7 m, the default of FLIP
+	constexpr float DefaultPixelsPerDegree = 67.f;
+
+	// Reads a PNG capture, fails when the file is missing or not an image
+	bool LoadImage(const FString& filePath, FQualityImage& outImage);
+
+	// Images of different sizes are not compared. The error maps get one value in [0, 1] per pixel when requested
+	bool Compare(const FQualityImage& reference, const FQualityImage& test, FImageQualityResult& outResult,
+		TArray<float>* pOutFlipMap = nullptr, TArray<float>* pOutSsimErrorMap = nullptr, float pixelsPerDegree = DefaultPixelsPerDegree);
+
+	// Error in [0, 1] as a magma colored PNG
+	bool WriteHeatmap(const FString& filePath, const TArray<float>& errorMap, int32 width, int32 height);
+}
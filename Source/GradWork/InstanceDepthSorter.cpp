@@ -0,0 +1,118 @@
+#include "InstanceDepthSorter.h"
+
+#include "Async/ParallelFor.h"
+
+void FInstanceDepthSorter::SetLocations(TArray<FVector3f> locations)
+{
+	m_Locations = MoveTemp(locations);
+
+	const int32 num = m_Locations.Num();
+	m_Depths.SetNumUninitialized(num);
+	m_Keys.SetNumUninitialized(num);
+	m_ScratchKeys.SetNumUninitialized(num);
+	m_ScratchOrder.SetNumUninitialized(num);
+	m_DepthRanges.SetNumUninitialized(GetNumChunks());
+	m_Histograms.SetNumUninitialized(GetNumChunks() * NumBuckets);
+
+	m_Order.SetNumUninitialized(num);
+	for (int32 i = 0; i < num; ++i)
+	{
+		m_Order[i] = i;
+	}
+}
+
+const TArray<int32>& FInstanceDepthSorter::Sort(const FVector& viewOrigin, const FVector& viewDirection)
+{
+	const int32 num = m_Locations.Num();
+	const int32 numChunks = GetNumChunks();
+	if (num == 0)
+		return m_Order;
+
+	const FVector3f origin(viewOrigin);
+	const FVector3f direction(viewDirection.GetSafeNormal());
+
+	// Depth range per chunk, merged in chunk order
+	ParallelFor(numChunks, [&](const int32 chunk)
+	{
+		FVector2f range(UE_MAX_FLT, -UE_MAX_FLT);
+		const int32 end = FMath::Min(num, (chunk + 1) * ChunkSize);
+		for (int32 i = chunk * ChunkSize; i < end; ++i)
+		{
+			m_Depths[i] = FVector3f::DotProduct(m_Locations[i] - origin, direction);
+			range.X = FMath::Min(range.X, m_Depths[i]);
+			range.Y = FMath::Max(range.Y, m_Depths[i]);
+		}
+		m_DepthRanges[chunk] = range;
+	});
+
+	float minDepth = UE_MAX_FLT;
+	float maxDepth = -UE_MAX_FLT;
+	for (const FVector2f& range : m_DepthRanges)
+	{
+		minDepth = FMath::Min(minDepth, range.X);
+		maxDepth = FMath::Max(maxDepth, range.Y);
+	}
+
+	// The farthest instance gets key 0, so ascending keys are back to front. The order of the previous sort is the
+	// starting point, so instances that quantize to the same key do not swap places from one frame to the next
+	const float scale = maxDepth > minDepth ? static_cast<float>(MAX_uint16) / (maxDepth - minDepth) : 0.f;
+	ParallelFor(numChunks, [&](const int32 chunk)
+	{
+		const int32 end = FMath::Min(num, (chunk + 1) * ChunkSize);
+		for (int32 i = chunk * ChunkSize; i < end; ++i)
+		{
+			m_Keys[i] = static_cast<uint16>(FMath::Clamp((maxDepth - m_Depths[m_Order[i]]) * scale, 0.f, static_cast<float>(MAX_uint16)));
+		}
+	});
+
+	for (int32 shift = 0; shift < 16; shift += RadixBits)
+	{
+		SortPass(shift);
+	}
+	return m_Order;
+}
+
+void FInstanceDepthSorter::SortPass(const int32 shift)
+{
+	const int32 num = m_Locations.Num();
+	const int32 numChunks = GetNumChunks();
+
+	ParallelFor(numChunks, [&](const int32 chunk)
+	{
+		int32* pHistogram = m_Histograms.GetData() + chunk * NumBuckets;
+		FMemory::Memzero(pHistogram, NumBuckets * sizeof(int32));
+
+		const int32 end = FMath::Min(num, (chunk + 1) * ChunkSize);
+		for (int32 i = chunk * ChunkSize; i < end; ++i)
+		{
+			++pHistogram[(m_Keys[i] >> shift) & (NumBuckets - 1)];
+		}
+	});
+
+	// Digit major, chunk minor, so earlier chunks write first within a digit and the pass stays stable
+	int32 offset = 0;
+	for (int32 digit = 0; digit < NumBuckets; ++digit)
+	{
+		for (int32 chunk = 0; chunk < numChunks; ++chunk)
+		{
+			const int32 count = m_Histograms[chunk * NumBuckets + digit];
+			m_Histograms[chunk * NumBuckets + digit] = offset;
+			offset += count;
+		}
+	}
+
+	ParallelFor(numChunks, [&](const int32 chunk)
+	{
+		int32* pOffsets = m_Histograms.GetData() + chunk * NumBuckets;
+		const int32 end = FMath::Min(num, (chunk + 1) * ChunkSize);
+		for (int32 i = chunk * ChunkSize; i < end; ++i)
+		{
+			const int32 destination = pOffsets[(m_Keys[i] >> shift) & (NumBuckets - 1)]++;
+			m_ScratchKeys[destination] = m_Keys[i];
+			m_ScratchOrder[destination] = m_Order[i];
+		}
+	});
+
+	Swap(m_Keys, m_ScratchKeys);
+	Swap(m_Order, m_ScratchOrder);
+}
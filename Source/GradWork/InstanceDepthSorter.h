@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Back-to-front order of a set of instances for a view. The engine sorts translucency per primitive, so the instances
+ * of one instanced component are drawn in buffer order unless that order is rebuilt for every view.
+ * Keys are the view depth of the instance centers quantized to 16 bits over their depth range, sorted with a two pass
+ * LSD radix sort. Every pass histograms chunks of the instances in parallel, a prefix sum over digit and chunk gives
+ * every chunk its own output ranges and the chunks scatter in parallel. The sort is stable, equal keys keep the order of
+ * the previous sort, so the result never depends on scheduling. Buffers are kept between sorts, sorting does not allocate.
+ */
+class FInstanceDepthSorter
+{
+public:
+	void SetLocations(TArray<FVector3f> locations);
+
+	// Instance indices, the farthest from the view first
+	const TArray<int32>& Sort(const FVector& viewOrigin, const FVector& viewDirection);
+	const TArray<int32>& GetOrder() const { return m_Order; }
+
+private:
+	static constexpr int32 ChunkSize = 4096;
+	static constexpr int32 RadixBits = 8;
+	static constexpr int32 NumBuckets = 1 << RadixBits;
+
+	TArray<FVector3f> m_Locations;
+	TArray<float> m_Depths;
+	// Min and max depth per chunk
+	TArray<FVector2f> m_DepthRanges;
+	TArray<uint16> m_Keys;
+	TArray<uint16> m_ScratchKeys;
+	TArray<int32> m_Order;
+	TArray<int32> m_ScratchOrder;
+	// NumBuckets counts per chunk, turned into output offsets in place
+	TArray<int32> m_Histograms;
+
+	int32 GetNumChunks() const { return FMath::DivideAndRoundUp(m_Locations.Num(), ChunkSize); }
+	void SortPass(int32 shift);
+};
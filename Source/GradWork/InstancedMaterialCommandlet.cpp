@@ -0,0 +1,149 @@
+#include "InstancedMaterialCommandlet.h"
+
+#if WITH_EDITOR
+#include "Materials/Material.h"
+#include "Materials/MaterialExpressionPerInstanceCustomData.h"
+#include "Materials/MaterialExpressionVectorParameter.h"
+#include "Misc/PackageName.h"
+#include "UObject/SavePackage.h"
+
+namespace
+{
+	const TCHAR* BaseMaterialPath = TEXT("/Game/Materials/M_Translucent_Emissive.M_Translucent_Emissive");
+	const TCHAR* InstancedPackageName = TEXT("/Game/Materials/M_Translucent_Emissive_Instanced");
+	const TCHAR* InstancedAssetName = TEXT("M_Translucent_Emissive_Instanced");
+	const FName ColorParameterName(TEXT("Color"));
+
+	// Output 0 of a vector parameter is RGB, 1-3 are the single channels, 4 is alpha
+	constexpr int32 AlphaOutputIndex = 4;
+
+	// Rewires every input that reads the parameter to the per-instance data, false when one reads its alpha
+	bool ReplaceColorParameter(UMaterial* pMaterial, UMaterialExpressionVectorParameter* pParameter)
+	{
+		UMaterialExpressionPerInstanceCustomData3Vector* pColor = NewObject<UMaterialExpressionPerInstanceCustomData3Vector>(pMaterial);
+		pColor->DataIndex = 0;
+		UMaterialExpressionPerInstanceCustomData* pChannels[3] = {};
+
+		const auto rewire = [&](FExpressionInput& input)
+		{
+			if (input.Expression != pParameter)
+				return true;
+			if (input.OutputIndex == AlphaOutputIndex)
+				return false;
+
+			if (input.OutputIndex == 0)
+			{
+				input.Expression = pColor;
+				return true;
+			}
+
+			// A single channel reads its own float of the per-instance data
+			UMaterialExpressionPerInstanceCustomData*& pChannel = pChannels[input.OutputIndex - 1];
+			if (!pChannel)
+			{
+				pChannel = NewObject<UMaterialExpressionPerInstanceCustomData>(pMaterial);
+				pChannel->DataIndex = input.OutputIndex - 1;
+			}
+			input.Expression = pChannel;
+			input.OutputIndex = 0;
+			return true;
+		};
+
+		for (UMaterialExpression* pExpression : pMaterial->GetExpressions())
+		{
+			for (FExpressionInputIterator it{ pExpression }; it; ++it)
+			{
+				if (!rewire(*it.Input))
+					return false;
+			}
+		}
+		for (int32 property = 0; property < MP_MAX; ++property)
+		{
+			if (FExpressionInput* pInput = pMaterial->GetExpressionInputForProperty(static_cast<EMaterialProperty>(property)); pInput && !rewire(*pInput))
+				return false;
+		}
+
+		pMaterial->GetExpressionCollection().AddExpression(pColor);
+		for (UMaterialExpression* pChannel : pChannels)
+		{
+			if (pChannel)
+			{
+				pMaterial->GetExpressionCollection().AddExpression(pChannel);
+			}
+		}
+		pMaterial->GetExpressionCollection().RemoveExpression(pParameter);
+		return true;
+	}
+}
+#endif
+
+UInstancedMaterialCommandlet::UInstancedMaterialCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UInstancedMaterialCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	const FString fileName = FPackageName::LongPackageNameToFilename(InstancedPackageName, FPackageName::GetAssetPackageExtension());
+	if (FPaths::FileExists(fileName) && !FParse::Param(*Params, TEXT("overwrite")))
+	{
+		UE_LOG(LogTemp, Display, TEXT("%s already exists, pass -overwrite to create it again."), *fileName);
+		return 0;
+	}
+
+	const UMaterial* pBaseMaterial = LoadObject<UMaterial>(nullptr, BaseMaterialPath);
+	if (!pBaseMaterial)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not load %s."), BaseMaterialPath);
+		return 1;
+	}
+
+	UPackage* pPackage = CreatePackage(InstancedPackageName);
+	UMaterial* pMaterial = DuplicateObject<UMaterial>(pBaseMaterial, pPackage, InstancedAssetName);
+	pMaterial->SetFlags(RF_Public | RF_Standalone);
+
+	UMaterialExpressionVectorParameter* pParameter = nullptr;
+	for (UMaterialExpression* pExpression : pMaterial->GetExpressions())
+	{
+		UMaterialExpressionVectorParameter* pVector = Cast<UMaterialExpressionVectorParameter>(pExpression);
+		if (pVector && pVector->ParameterName == ColorParameterName)
+		{
+			pParameter = pVector;
+			break;
+		}
+	}
+	if (!pParameter)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s has no vector parameter %s."), BaseMaterialPath, *ColorParameterName.ToString());
+		return 1;
+	}
+
+	pMaterial->PreEditChange(nullptr);
+	if (!ReplaceColorParameter(pMaterial, pParameter))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s reads the alpha of %s, the cubes only pass RGB per instance."), BaseMaterialPath, *ColorParameterName.ToString());
+		return 1;
+	}
+	pMaterial->bUsedWithInstancedStaticMeshes = true;
+	pMaterial->PostEditChange();
+	pPackage->MarkPackageDirty();
+
+	FSavePackageArgs saveArgs;
+	saveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	if (!UPackage::SavePackage(pPackage, pMaterial, *fileName, saveArgs))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not save %s."), *fileName);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Created %s."), *fileName);
+	return 0;
+#else
+	UE_LOG(LogTemp, Error, TEXT("The instanced material can only be created with the editor."));
+	return 1;
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "InstancedMaterialCommandlet.generated.h"
+
+/**
+ * Creates the material the instanced cubes of the transparency heavy level render with: a copy of
+ * M_Translucent_Emissive that reads its Color parameter from PerInstanceCustomData 0-2 instead.
+ * Usage: -run=InstancedMaterial [-overwrite]. Needs the editor, the saved asset is used by cooked builds as well.
+ */
+UCLASS()
+class GRADWORK_API UInstancedMaterialCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UInstancedMaterialCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,208 @@
+#include "LiveTelemetry.h"
+
+namespace
+{
+	template <int32 Size>
+	void CopyName(char (&destination)[Size], const FString& source)
+	{
+		FCStringAnsi::Strncpy(destination, TCHAR_TO_ANSI(*source), Size);
+	}
+}
+
+bool FLiveTelemetryWriter::Open(const FString& name)
+{
+	using namespace LiveTelemetry;
+
+	Close();
+
+	m_pRegion = FPlatformMemory::MapNamedSharedMemoryRegion(name, true,
+		FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write, sizeof(FSegment));
+	if (!m_pRegion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Could not create live telemetry segment %s."), *name);
+		return false;
+	}
+
+	// A segment left behind by an earlier session is reused, it is invalid until the magic is written again
+	m_pSegment = static_cast<FSegment*>(m_pRegion->GetAddress());
+	FHeader& header = m_pSegment->header;
+	header.magic.store(0, std::memory_order_relaxed);
+	header.version = Version;
+	header.capacity = Capacity;
+	header.numMetrics = FFrameMetricSchema::NumMetrics;
+	FMemory::Memzero(header.metricNames);
+	for (int32 i = 0; i < FFrameMetricSchema::NumMetrics; ++i)
+	{
+		CopyName(header.metricNames[i], FFrameMetricSchema::Descs[i].name);
+	}
+	header.runSequence.store(0, std::memory_order_relaxed);
+	header.numPublished.store(0, std::memory_order_relaxed);
+	header.bIsClosed.store(0, std::memory_order_relaxed);
+	for (FSlot& slot : m_pSegment->slots)
+	{
+		slot.index.store(InvalidIndex, std::memory_order_relaxed);
+	}
+	m_NumPublished = 0;
+	m_NumRuns = 0;
+	WriteRun(FString(), FString(), 0.f, 0, false);
+
+	header.magic.store(Magic, std::memory_order_release);
+	UE_LOG(LogTemp, Log, TEXT("Publishing live telemetry to %s (%.1f MB)."), *name, sizeof(FSegment) / FrameMetrics::BytesPerMB);
+	return true;
+}
+
+void FLiveTelemetryWriter::Close()
+{
+	if (!m_pRegion)
+		return;
+
+	m_pSegment->header.bIsClosed.store(1, std::memory_order_release);
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(m_pRegion);
+	m_pRegion = nullptr;
+	m_pSegment = nullptr;
+}
+
+void FLiveTelemetryWriter::BeginRun(const FString& runName, const FString& mode, const float durationSeconds)
+{
+	if (!m_pSegment)
+		return;
+
+	++m_NumRuns;
+	WriteRun(runName, mode, durationSeconds, m_NumPublished, true);
+}
+
+void FLiveTelemetryWriter::EndRun()
+{
+	if (!m_pSegment)
+		return;
+
+	// Keeps the names, a viewer still shows which window finished last
+	LiveTelemetry::FHeader& header = m_pSegment->header;
+	WriteRun(FString(ANSI_TO_TCHAR(header.runName)), FString(ANSI_TO_TCHAR(header.runMode)), header.runDurationSeconds, header.runFirstIndex, false);
+}
+
+void FLiveTelemetryWriter::WriteRun(const FString& runName, const FString& mode, const float durationSeconds, const uint64 firstIndex, const bool bIsTracking)
+{
+	LiveTelemetry::FHeader& header = m_pSegment->header;
+
+	const uint32 sequence = header.runSequence.load(std::memory_order_relaxed);
+	header.runSequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	header.runId = m_NumRuns;
+	header.runFirstIndex = firstIndex;
+	header.runDurationSeconds = durationSeconds;
+	header.bIsRunTracking = bIsTracking;
+	CopyName(header.runName, runName);
+	CopyName(header.runMode, mode);
+
+	header.runSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void FLiveTelemetryWriter::Publish(const FFrameSample& sample)
+{
+	if (!m_pSegment)
+		return;
+
+	const uint64 index = m_NumPublished++;
+	LiveTelemetry::FSlot& slot = m_pSegment->slots[index & (LiveTelemetry::Capacity - 1)];
+
+	slot.index.store(LiveTelemetry::InvalidIndex, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FFrameMetricSchema::ForEachMetric([&slot, &sample](auto metricSlot)
+	{
+		constexpr int32 metric = decltype(metricSlot)::Index;
+		slot.values[metric].store(static_cast<double>(sample.template Get<metric>()), std::memory_order_relaxed);
+	});
+
+	slot.index.store(index, std::memory_order_release);
+	m_pSegment->header.numPublished.store(m_NumPublished, std::memory_order_release);
+}
+
+bool FLiveTelemetryReader::Open(const FString& name)
+{
+	using namespace LiveTelemetry;
+
+	Close();
+
+	m_pRegion = FPlatformMemory::MapNamedSharedMemoryRegion(name, false, FPlatformMemory::ESharedMemoryAccess::Read, sizeof(FSegment));
+	if (!m_pRegion)
+		return false;
+
+	m_pSegment = static_cast<const FSegment*>(m_pRegion->GetAddress());
+	const FHeader& header = m_pSegment->header;
+	if (header.magic.load(std::memory_order_acquire) != Magic || header.version != Version || header.capacity != Capacity
+		|| header.numMetrics <= 0 || header.numMetrics > MaxMetrics)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FLiveTelemetryReader::Close()
+{
+	if (!m_pRegion)
+		return;
+
+	FPlatformMemory::UnmapNamedSharedMemoryRegion(m_pRegion);
+	m_pRegion = nullptr;
+	m_pSegment = nullptr;
+}
+
+int32 FLiveTelemetryReader::FindMetric(const TCHAR* name) const
+{
+	for (int32 i = 0; i < GetNumMetrics(); ++i)
+	{
+		if (FCString::Strcmp(*GetMetricName(i), name) == 0)
+			return i;
+	}
+	return INDEX_NONE;
+}
+
+bool FLiveTelemetryReader::TryReadRun(LiveTelemetry::FRunInfo& outRun) const
+{
+	const LiveTelemetry::FHeader& header = m_pSegment->header;
+
+	const uint32 sequence = header.runSequence.load(std::memory_order_acquire);
+	if (sequence & 1)
+		return false;
+
+	char runName[LiveTelemetry::MaxRunNameLength];
+	char runMode[LiveTelemetry::MaxRunNameLength];
+	outRun.id = header.runId;
+	outRun.firstIndex = header.runFirstIndex;
+	outRun.durationSeconds = header.runDurationSeconds;
+	outRun.bIsTracking = header.bIsRunTracking;
+	FMemory::Memcpy(runName, header.runName, sizeof(runName));
+	FMemory::Memcpy(runMode, header.runMode, sizeof(runMode));
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (header.runSequence.load(std::memory_order_relaxed) != sequence)
+		return false;
+
+	// Only converted once the copy is known to be whole
+	runName[LiveTelemetry::MaxRunNameLength - 1] = '\0';
+	runMode[LiveTelemetry::MaxRunNameLength - 1] = '\0';
+	outRun.name = ANSI_TO_TCHAR(runName);
+	outRun.mode = ANSI_TO_TCHAR(runMode);
+	return true;
+}
+
+bool FLiveTelemetryReader::TryRead(const uint64 index, TArrayView<double> outValues) const
+{
+	const LiveTelemetry::FSlot& slot = m_pSegment->slots[index & (LiveTelemetry::Capacity - 1)];
+
+	if (slot.index.load(std::memory_order_acquire) != index)
+		return false;
+
+	const int32 numValues = FMath::Min(outValues.Num(), GetNumMetrics());
+	for (int32 i = 0; i < numValues; ++i)
+	{
+		outValues[i] = slot.values[i].load(std::memory_order_relaxed);
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	return slot.index.load(std::memory_order_relaxed) == index;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "FrameMetrics.h"
+#include <atomic>
+
+/**
+ * Layout of the shared memory segment the logger publishes its frames into, read by ULiveTelemetryCommandlet.
+ * The logger is the only writer and never waits: every frame overwrites the oldest slot, a reader that falls a whole
+ * ring behind skips ahead. Every slot is guarded by the index of its frame (seqlock), so a reader maps the segment
+ * read-only and reads the values straight from it, a slot that gets overwritten while being read is simply rejected.
+ * A frame holds every column of the frame schema as a double, the column names are in the header.
+ */
+namespace LiveTelemetry
+{
+	inline const TCHAR* DefaultName = TEXT("GradWorkTelemetry");
+
+	constexpr uint32 Magic = 0x544C5747;
+	constexpr uint32 Version = 1;
+	// A few seconds of frames even at high frame rates, a viewer polls far more often than that
+	constexpr uint32 Capacity = 8192;
+	constexpr int32 MaxMetrics = 48;
+	constexpr int32 MaxNameLength = 48;
+	constexpr int32 MaxRunNameLength = 128;
+	constexpr uint64 InvalidIndex = ~0ull;
+
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+	static_assert(FFrameMetricSchema::NumMetrics <= MaxMetrics, "The frame schema does not fit in a telemetry slot");
+	// Another process maps the same memory, so the atomics cannot fall back to a lock
+	static_assert(std::atomic<uint64>::is_always_lock_free && std::atomic<double>::is_always_lock_free, "Telemetry needs lock-free atomics");
+
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FSlot
+	{
+		std::atomic<uint64> index;
+		std::atomic<double> values[MaxMetrics];
+	};
+
+	struct FHeader
+	{
+		// Written last when the segment is created, a reader ignores a segment without it
+		std::atomic<uint32> magic;
+		uint32 version;
+		uint32 capacity;
+		int32 numMetrics;
+		char metricNames[MaxMetrics][MaxNameLength];
+
+		// The tracked window, odd while the writer changes the fields below it
+		std::atomic<uint32> runSequence;
+		uint32 runId;
+		// Index of the window's first frame
+		uint64 runFirstIndex;
+		float runDurationSeconds;
+		bool bIsRunTracking;
+		char runName[MaxRunNameLength];
+		char runMode[MaxRunNameLength];
+
+		// Frames published so far, frame i is in slot i % capacity
+		alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<uint64> numPublished;
+		// Set when the logger shuts down, nothing is published after it
+		std::atomic<uint32> bIsClosed;
+	};
+
+	struct FSegment
+	{
+		FHeader header;
+		FSlot slots[Capacity];
+	};
+
+	struct FRunInfo
+	{
+		uint32 id{ 0 };
+		uint64 firstIndex{ 0 };
+		float durationSeconds{ 0 };
+		bool bIsTracking{ false };
+		FString name;
+		FString mode;
+	};
+}
+
+// Producer side, owned by the logger and only used from the game thread
+class FLiveTelemetryWriter
+{
+public:
+	FLiveTelemetryWriter() = default;
+	FLiveTelemetryWriter(const FLiveTelemetryWriter&) = delete;
+	FLiveTelemetryWriter& operator=(const FLiveTelemetryWriter&) = delete;
+	~FLiveTelemetryWriter() { Close(); }
+
+	// Creates the named segment, every frame published after this is visible to readers
+	bool Open(const FString& name);
+	void Close();
+	bool IsOpen() const { return m_pSegment != nullptr; }
+
+	void BeginRun(const FString& runName, const FString& mode, float durationSeconds);
+	void EndRun();
+	// A handful of relaxed stores, no allocation, no system call
+	void Publish(const FFrameSample& sample);
+
+private:
+	FPlatformMemory::FSharedMemoryRegion* m_pRegion{ nullptr };
+	LiveTelemetry::FSegment* m_pSegment{ nullptr };
+	uint64 m_NumPublished{ 0 };
+	uint32 m_NumRuns{ 0 };
+
+	void WriteRun(const FString& runName, const FString& mode, float durationSeconds, uint64 firstIndex, bool bIsTracking);
+};
+
+// Consumer side, maps the segment of a running logger read-only
+class FLiveTelemetryReader
+{
+public:
+	FLiveTelemetryReader() = default;
+	FLiveTelemetryReader(const FLiveTelemetryReader&) = delete;
+	FLiveTelemetryReader& operator=(const FLiveTelemetryReader&) = delete;
+	~FLiveTelemetryReader() { Close(); }
+
+	// False while no logger has created the segment, or when it was created by an incompatible build
+	bool Open(const FString& name);
+	void Close();
+
+	int32 GetNumMetrics() const { return m_pSegment->header.numMetrics; }
+	FString GetMetricName(int32 metric) const { return FString(ANSI_TO_TCHAR(m_pSegment->header.metricNames[metric])); }
+	// INDEX_NONE when the logger does not publish the column
+	int32 FindMetric(const TCHAR* name) const;
+
+	uint64 GetNumPublished() const { return m_pSegment->header.numPublished.load(std::memory_order_acquire); }
+	bool IsClosed() const { return m_pSegment->header.bIsClosed.load(std::memory_order_acquire) != 0; }
+
+	// Returns false when the writer changed the run while it was being read, try again on the next poll
+	bool TryReadRun(LiveTelemetry::FRunInfo& outRun) const;
+	// Returns false when the frame is not published yet or was overwritten, outValues needs GetNumMetrics() entries
+	bool TryRead(uint64 index, TArrayView<double> outValues) const;
+
+private:
+	FPlatformMemory::FSharedMemoryRegion* m_pRegion{ nullptr };
+	const LiveTelemetry::FSegment* m_pSegment{ nullptr };
+};
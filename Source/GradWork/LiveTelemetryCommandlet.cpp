@@ -0,0 +1,233 @@
+#include "LiveTelemetryCommandlet.h"
+
+#include "HitchAnalyzer.h"
+#include "LiveTelemetry.h"
+#include "StreamingHistogram.h"
+
+namespace
+{
+	// Trace columns the viewer shows, INDEX_NONE when the game does not publish them
+	struct FColumns
+	{
+		int32 frameNumber;
+		int32 frameTime;
+		int32 gameThreadTime;
+		int32 renderThreadTime;
+		int32 gpuTime;
+		int32 physicalMemory;
+		int32 resourceMemory;
+	};
+
+	struct FLiveRun
+	{
+		LiveTelemetry::FRunInfo info;
+		FStreamingHistogram frameTimes{ 1000.0 };
+		FStreamingHistogram gpuTimes{ 1000.0 };
+		FHitchAnalyzer hitches;
+		double trackedSeconds{ 0 };
+		// Sampled every few frames, -1 in between, the last measured value is shown
+		double physicalMemoryMB{ -1 };
+		double resourceMemoryMB{ -1 };
+		// Overwritten before the viewer got to them
+		uint64 numLostFrames{ 0 };
+	};
+
+	double GetValue(const TArray<double>& values, const int32 metric)
+	{
+		return metric == INDEX_NONE ? -1.0 : values[metric];
+	}
+
+	void AddFrame(FLiveRun& run, const TArray<double>& values, const FColumns& columns)
+	{
+		const double frameTime = GetValue(values, columns.frameTime);
+		const double gpuTime = GetValue(values, columns.gpuTime);
+		run.trackedSeconds += frameTime / 1000.0;
+		run.frameTimes.Record(frameTime);
+		if (gpuTime >= 0.0)
+		{
+			run.gpuTimes.Record(gpuTime);
+		}
+		run.hitches.AddFrame(static_cast<uint64>(FMath::Max(0.0, GetValue(values, columns.frameNumber))), run.trackedSeconds, frameTime,
+			GetValue(values, columns.gameThreadTime), GetValue(values, columns.renderThreadTime), FMath::Max(0.0, gpuTime));
+
+		if (const double memory = GetValue(values, columns.physicalMemory); memory >= 0.0)
+		{
+			run.physicalMemoryMB = memory;
+		}
+		if (const double memory = GetValue(values, columns.resourceMemory); memory >= 0.0)
+		{
+			run.resourceMemoryMB = memory;
+		}
+	}
+
+	FString FormatRun(const FLiveRun& run)
+	{
+		FString text = FString::Printf(TEXT("%s | %s | %.1f / %.0f s | %llu frames"),
+			*run.info.name, *run.info.mode, run.trackedSeconds, run.info.durationSeconds, run.frameTimes.Num());
+		if (run.frameTimes.Num() == 0)
+			return text;
+
+		const FHistogramSummary frameTimes = run.frameTimes.Summarize(0.0);
+		text += FString::Printf(TEXT(" | Frame p50 %.2f p95 %.2f p99 %.2f max %.2f ms"), frameTimes.p50, frameTimes.p95, frameTimes.p99, frameTimes.max);
+		if (run.gpuTimes.Num() > 0)
+		{
+			const FHistogramSummary gpuTimes = run.gpuTimes.Summarize(0.0);
+			text += FString::Printf(TEXT(" | GPU p50 %.2f p95 %.2f ms"), gpuTimes.p50, gpuTimes.p95);
+		}
+
+		const FHitchSummary hitches = run.hitches.Summarize(run.trackedSeconds);
+		text += FString::Printf(TEXT(" | %d hitches in %d clusters (%.1f/min)"), hitches.numHitches, hitches.numClusters, hitches.GetHitchesPerMinute());
+		if (run.physicalMemoryMB >= 0.0)
+		{
+			text += FString::Printf(TEXT(" | Physical %.0f MB"), run.physicalMemoryMB);
+		}
+		if (run.resourceMemoryMB >= 0.0)
+		{
+			text += FString::Printf(TEXT(" | RHI %.0f MB"), run.resourceMemoryMB);
+		}
+		if (run.numLostFrames > 0)
+		{
+			text += FString::Printf(TEXT(" | %llu frames missed"), run.numLostFrames);
+		}
+		return text;
+	}
+}
+
+ULiveTelemetryCommandlet::ULiveTelemetryCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 ULiveTelemetryCommandlet::Main(const FString& Params)
+{
+	FString name = LiveTelemetry::DefaultName;
+	float interval = 1.f;
+	float waitSeconds = 60.f;
+	double hitchBudgetMs = 0.0;
+	double hitchMedianMultiplier = 2.0;
+	FParse::Value(*Params, TEXT("name="), name);
+	FParse::Value(*Params, TEXT("interval="), interval);
+	FParse::Value(*Params, TEXT("wait="), waitSeconds);
+	FParse::Value(*Params, TEXT("hitchbudget="), hitchBudgetMs);
+	FParse::Value(*Params, TEXT("hitchfactor="), hitchMedianMultiplier);
+	interval = FMath::Max(0.1f, interval);
+	hitchMedianMultiplier = FMath::Max(1.0, hitchMedianMultiplier);
+
+	FLiveTelemetryReader reader;
+	const double waitStartTime = FPlatformTime::Seconds();
+	while (!reader.Open(name))
+	{
+		if (IsEngineExitRequested() || (waitSeconds > 0.f && FPlatformTime::Seconds() - waitStartTime > waitSeconds))
+		{
+			UE_LOG(LogTemp, Error, TEXT("No live telemetry segment %s, start the game with -LiveTelemetry."), *name);
+			return 1;
+		}
+		FPlatformProcess::Sleep(0.5f);
+	}
+
+	const FColumns columns{ reader.FindMetric(TEXT("FrameNumber")), reader.FindMetric(TEXT("FrameTime")), reader.FindMetric(TEXT("GameThreadTime")),
+		reader.FindMetric(TEXT("RenderThreadTime")), reader.FindMetric(TEXT("GPUTime")), reader.FindMetric(TEXT("PhysicalMemoryMB")),
+		reader.FindMetric(TEXT("ResourceMemoryMB")) };
+	if (columns.frameTime == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Live telemetry segment %s has no frame times."), *name);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Following live telemetry %s, %d columns."), *name, reader.GetNumMetrics());
+
+	TArray<double> values;
+	values.SetNumZeroed(reader.GetNumMetrics());
+
+	const auto startRun = [hitchBudgetMs, hitchMedianMultiplier](FLiveRun& run, const LiveTelemetry::FRunInfo& info)
+	{
+		run = FLiveRun();
+		run.info = info;
+		run.hitches.SetThresholds(hitchBudgetMs, hitchMedianMultiplier);
+	};
+
+	// Frames of the current window that are still in the ring are picked up, older windows are not
+	FLiveRun run;
+	LiveTelemetry::FRunInfo latestRun;
+	while (!reader.TryReadRun(latestRun))
+	{
+		FPlatformProcess::Sleep(0.01f);
+	}
+	startRun(run, latestRun);
+	const uint64 numPublishedAtStart = reader.GetNumPublished();
+	uint64 nextIndex = FMath::Max(latestRun.firstIndex, numPublishedAtStart > LiveTelemetry::Capacity ? numPublishedAtStart - LiveTelemetry::Capacity : 0);
+	bool bHasReportedRun = !latestRun.bIsTracking;
+	double nextPrintTime = FPlatformTime::Seconds() + interval;
+
+	while (!IsEngineExitRequested())
+	{
+		// Checked before the frames, so a window that closes in between still gets all of its frames
+		const bool bIsClosed = reader.IsClosed();
+		const bool bHasRun = reader.TryReadRun(latestRun);
+		const uint64 numPublished = reader.GetNumPublished();
+
+		if (numPublished - nextIndex > LiveTelemetry::Capacity)
+		{
+			run.numLostFrames += numPublished - LiveTelemetry::Capacity - nextIndex;
+			nextIndex = numPublished - LiveTelemetry::Capacity;
+		}
+
+		// Windows last seconds, so at most one new window starts between two polls
+		const auto updateRun = [&]()
+		{
+			if (!bHasRun || nextIndex < latestRun.firstIndex)
+				return;
+
+			if (latestRun.id != run.info.id)
+			{
+				if (!bHasReportedRun && run.frameTimes.Num() > 0)
+				{
+					UE_LOG(LogTemp, Display, TEXT("Finished: %s"), *FormatRun(run));
+				}
+				startRun(run, latestRun);
+				bHasReportedRun = false;
+			}
+			else
+			{
+				run.info = latestRun;
+			}
+		};
+
+		for (; nextIndex < numPublished; ++nextIndex)
+		{
+			updateRun();
+			if (reader.TryRead(nextIndex, values))
+			{
+				AddFrame(run, values, columns);
+			}
+			else
+			{
+				++run.numLostFrames;
+			}
+		}
+		updateRun();
+
+		if (!run.info.bIsTracking && !bHasReportedRun)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Finished: %s"), *FormatRun(run));
+			bHasReportedRun = true;
+		}
+		else if (run.info.bIsTracking && FPlatformTime::Seconds() >= nextPrintTime)
+		{
+			UE_LOG(LogTemp, Display, TEXT("%s"), *FormatRun(run));
+			nextPrintTime = FPlatformTime::Seconds() + interval;
+		}
+
+		if (bIsClosed)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Live telemetry %s was closed."), *name);
+			return 0;
+		}
+
+		// Far below the time the ring holds, polling costs the game nothing
+		FPlatformProcess::Sleep(FMath::Min(0.1f, interval));
+	}
+	return 0;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LiveTelemetryCommandlet.generated.h"
+
+/**
+ * Follows the frames a running game publishes with -LiveTelemetry, from another process on the same machine.
+ * Usage: -run=LiveTelemetry [-name=GradWorkTelemetry] [-interval=1] [-wait=60] [-hitchbudget=0] [-hitchfactor=2]
+ * Prints the percentiles, hitches and memory of the tracked window every interval seconds and a summary when the
+ * window ends, hitches use the same rules as the session report. Waits up to wait seconds (0 waits forever) for the
+ * game to create the segment and returns once the game closes it.
+ */
+UCLASS()
+class GRADWORK_API ULiveTelemetryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	ULiveTelemetryCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
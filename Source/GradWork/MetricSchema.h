@@ -0,0 +1,178 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// When the logger samples a metric, all samplers of one rate run together
+enum class EMetricRate : uint8
+{
+	// Every tracked frame, also with minimal instrumentation
+	Always,
+	// Every tracked frame with full instrumentation
+	EveryFrame,
+	// Every few tracked frames with full instrumentation, -1 in between
+	Periodic,
+	// Published by the render thread and filled in once the frame is resolved from the stats ring
+	RenderThread,
+	// The logger's own bookkeeping at the end of the frame
+	Logger,
+};
+
+struct FMetricDesc
+{
+	// Trace column
+	const TCHAR* name;
+	// Row in the stats tables, nullptr keeps the metric out of the aggregated stats
+	const TCHAR* label;
+	const TCHAR* unit;
+	// Histogram resolution, 1000 keeps a metric in ms to the microsecond
+	double unitsPerValue;
+	bool bUsesFrameBudget;
+	EMetricRate rate;
+};
+
+// Type and position of one metric, what TMetricSchema::ForEachMetric hands to its functor
+template <typename MetricType, int32 InIndex>
+struct TMetricSlot
+{
+	using FMetric = MetricType;
+	static constexpr int32 Index = InIndex;
+};
+
+/**
+ * Everything the logger stores per frame, generated from a list of metric types. A metric is a struct with
+ * a value type (FValue), a constexpr FMetricDesc (Desc) and a static Sample function for its rate, so adding one is a
+ * single declaration. Sample layout, column storage and the per-frame loops are unrolled at compile time,
+ * nothing goes through a virtual call or a std::function.
+ */
+template <typename... MetricTypes>
+class TMetricSchema
+{
+public:
+	static constexpr int32 NumMetrics = sizeof...(MetricTypes);
+	static constexpr FMetricDesc Descs[] = { MetricTypes::Desc... };
+
+	// One frame, a value per metric in declaration order
+	using FSample = TTuple<typename MetricTypes::FValue...>;
+
+	template <typename MetricType>
+	static constexpr int32 IndexOf()
+	{
+		constexpr bool bMatches[] = { std::is_same_v<MetricType, MetricTypes>... };
+		for (int32 i = 0; i < NumMetrics; ++i)
+		{
+			if (bMatches[i])
+				return i;
+		}
+		return INDEX_NONE;
+	}
+
+	template <typename MetricType>
+	static auto& Get(FSample& sample)
+	{
+		static_assert(IndexOf<MetricType>() != INDEX_NONE, "Metric is not part of this schema");
+		return sample.template Get<IndexOf<MetricType>()>();
+	}
+
+	template <typename MetricType>
+	static const auto& Get(const FSample& sample)
+	{
+		static_assert(IndexOf<MetricType>() != INDEX_NONE, "Metric is not part of this schema");
+		return sample.template Get<IndexOf<MetricType>()>();
+	}
+
+	// Calls functor(TMetricSlot<Metric, Index>()) for every metric in declaration order
+	template <typename FunctorType>
+	static void ForEachMetric(FunctorType&& functor)
+	{
+		ForEachMetric(functor, std::make_integer_sequence<int32, NumMetrics>());
+	}
+
+	// Metrics that are not sampled yet, -1 (0 for unsigned values) like everything that was not measured
+	static FSample MakeUnmeasured()
+	{
+		return FSample(MakeUnmeasuredValue<typename MetricTypes::FValue>()...);
+	}
+
+	template <typename ValueType>
+	static bool IsMeasured(const ValueType value)
+	{
+		if constexpr (std::is_unsigned_v<ValueType>)
+			return true;
+		else
+			return value >= 0;
+	}
+
+	/**
+	 * Struct-of-arrays storage for a run of frames.
+	 * Every metric lives in its own contiguous column, all columns are reserved up front
+	 * so adding a frame never touches the heap. When the store is full, Add refuses the sample instead of growing.
+	 */
+	class FStore
+	{
+	public:
+		void Reserve(const size_t capacity)
+		{
+			ForEachColumn([capacity](const TCHAR*, auto& column) { column.reserve(capacity); });
+		}
+
+		// Drops all samples but keeps the reserved memory
+		void Clear()
+		{
+			ForEachColumn([](const TCHAR*, auto& column) { column.clear(); });
+		}
+
+		size_t Num() const { return m_Columns.template Get<0>().size(); }
+		size_t Capacity() const { return m_Columns.template Get<0>().capacity(); }
+		bool IsFull() const { return Num() >= Capacity(); }
+
+		// Returns the index of the new frame or INDEX_NONE when the store is full
+		int32 Add(const FSample& sample)
+		{
+			if (IsFull())
+				return INDEX_NONE;
+
+			TMetricSchema::ForEachMetric([this, &sample](auto slot)
+			{
+				constexpr int32 index = decltype(slot)::Index;
+				m_Columns.template Get<index>().push_back(sample.template Get<index>());
+			});
+			return static_cast<int32>(Num() - 1);
+		}
+
+		// Calls functor(name, column) for every column, in the order they are written to a trace
+		template <typename FunctorType>
+		void ForEachColumn(FunctorType&& functor)
+		{
+			TMetricSchema::ForEachMetric([this, &functor](auto slot)
+			{
+				using FSlot = decltype(slot);
+				functor(FSlot::FMetric::Desc.name, m_Columns.template Get<FSlot::Index>());
+			});
+		}
+
+		template <typename FunctorType>
+		void ForEachColumn(FunctorType&& functor) const
+		{
+			const_cast<FStore*>(this)->ForEachColumn([&functor](const TCHAR* name, const auto& column) { functor(name, column); });
+		}
+
+	private:
+		TTuple<std::vector<typename MetricTypes::FValue>...> m_Columns;
+	};
+
+private:
+	template <typename FunctorType, int32... Indices>
+	static void ForEachMetric(FunctorType& functor, std::integer_sequence<int32, Indices...>)
+	{
+		(functor(TMetricSlot<MetricTypes, Indices>()), ...);
+	}
+
+	template <typename ValueType>
+	static constexpr ValueType MakeUnmeasuredValue()
+	{
+		return std::is_unsigned_v<ValueType> ? ValueType(0) : ValueType(-1);
+	}
+};
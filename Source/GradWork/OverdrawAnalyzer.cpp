@@ -0,0 +1,277 @@
+#include "OverdrawAnalyzer.h"
+
+#include "EngineUtils.h"
+#include "Async/ParallelFor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Materials/MaterialInterface.h"
+#include <algorithm>
+
+namespace
+{
+	constexpr int32 MaxTraversalDepth = 64;
+
+	// A direction component of exactly 0 would make the slab test multiply 0 by infinity
+	float GetInverseComponent(const float component)
+	{
+		return 1.f / (FMath::Abs(component) > UE_SMALL_NUMBER ? component : UE_SMALL_NUMBER);
+	}
+
+	bool IsTranslucent(const UPrimitiveComponent* pComponent)
+	{
+		for (int32 i = 0; i < pComponent->GetNumMaterials(); ++i)
+		{
+			const UMaterialInterface* pMaterial = pComponent->GetMaterial(i);
+			if (pMaterial && pMaterial->GetBlendMode() != BLEND_Opaque && pMaterial->GetBlendMode() != BLEND_Masked)
+				return true;
+		}
+		return false;
+	}
+
+	// Four rays from one origin, one direction component per lane
+	struct FRayPacket
+	{
+		VectorRegister4Float origin[3];
+		VectorRegister4Float inverseDirection[3];
+
+		// Bit i is set when ray i passes through the box in front of the origin
+		uint32 Intersect(const FVector3f& min, const FVector3f& max) const
+		{
+			VectorRegister4Float entry = VectorZeroFloat();
+			VectorRegister4Float exit = VectorSetFloat1(UE_BIG_NUMBER);
+			for (int32 axis = 0; axis < 3; ++axis)
+			{
+				const VectorRegister4Float t0 = VectorMultiply(VectorSubtract(VectorSetFloat1(min[axis]), origin[axis]), inverseDirection[axis]);
+				const VectorRegister4Float t1 = VectorMultiply(VectorSubtract(VectorSetFloat1(max[axis]), origin[axis]), inverseDirection[axis]);
+				entry = VectorMax(entry, VectorMin(t0, t1));
+				exit = VectorMin(exit, VectorMax(t0, t1));
+			}
+			return static_cast<uint32>(VectorMaskBits(VectorCompareGE(exit, entry)));
+		}
+	};
+}
+
+void FBoxBVH::Build(TArray<FBox3f> boxes)
+{
+	m_Boxes = MoveTemp(boxes);
+	m_Nodes.Reset();
+	if (m_Boxes.IsEmpty())
+		return;
+
+	TArray<FVector3f> centers;
+	centers.SetNumUninitialized(m_Boxes.Num());
+	for (int32 i = 0; i < m_Boxes.Num(); ++i)
+	{
+		centers[i] = m_Boxes[i].GetCenter();
+	}
+
+	// A binary tree with leaves of up to MaxLeafBoxes boxes has fewer than 2 * boxes nodes
+	m_Nodes.Reserve(2 * m_Boxes.Num());
+	m_Nodes.AddUninitialized();
+	BuildNode(0, 0, m_Boxes.Num(), centers);
+}
+
+void FBoxBVH::BuildNode(const int32 nodeIndex, const int32 first, const int32 num, TArray<FVector3f>& centers)
+{
+	FBox3f bounds(ForceInit);
+	FBox3f centerBounds(ForceInit);
+	for (int32 i = first; i < first + num; ++i)
+	{
+		bounds += m_Boxes[i];
+		centerBounds += centers[i];
+	}
+
+	m_Nodes[nodeIndex].min = bounds.Min;
+	m_Nodes[nodeIndex].max = bounds.Max;
+
+	const FVector3f extent = centerBounds.GetExtent();
+	const int32 axis = extent.X >= extent.Y && extent.X >= extent.Z ? 0 : (extent.Y >= extent.Z ? 1 : 2);
+	if (num <= MaxLeafBoxes || extent[axis] <= 0.f)
+	{
+		m_Nodes[nodeIndex].first = first;
+		m_Nodes[nodeIndex].numBoxes = num;
+		return;
+	}
+
+	// Boxes and their centers are partitioned together, by index
+	TArray<int32> order;
+	order.SetNumUninitialized(num);
+	for (int32 i = 0; i < num; ++i)
+	{
+		order[i] = first + i;
+	}
+	const int32 half = num / 2;
+	std::nth_element(order.GetData(), order.GetData() + half, order.GetData() + num,
+		[&centers, axis](const int32 a, const int32 b) { return centers[a][axis] < centers[b][axis] || (centers[a][axis] == centers[b][axis] && a < b); });
+
+	TArray<FBox3f> sortedBoxes;
+	TArray<FVector3f> sortedCenters;
+	sortedBoxes.Reserve(num);
+	sortedCenters.Reserve(num);
+	for (const int32 index : order)
+	{
+		sortedBoxes.Add(m_Boxes[index]);
+		sortedCenters.Add(centers[index]);
+	}
+	FMemory::Memcpy(m_Boxes.GetData() + first, sortedBoxes.GetData(), num * sizeof(FBox3f));
+	FMemory::Memcpy(centers.GetData() + first, sortedCenters.GetData(), num * sizeof(FVector3f));
+
+	const int32 leftChild = m_Nodes.Num();
+	m_Nodes.AddUninitialized(2);
+	m_Nodes[nodeIndex].first = leftChild;
+	m_Nodes[nodeIndex].numBoxes = 0;
+	BuildNode(leftChild, first, half, centers);
+	BuildNode(leftChild + 1, first + half, num - half, centers);
+}
+
+void FBoxBVH::CountHits4(const FVector3f& origin, const FVector3f (&directions)[4], int32 (&outCounts)[4]) const
+{
+	for (int32& count : outCounts)
+	{
+		count = 0;
+	}
+	if (m_Nodes.IsEmpty())
+		return;
+
+	FRayPacket packet;
+	for (int32 axis = 0; axis < 3; ++axis)
+	{
+		packet.origin[axis] = VectorSetFloat1(origin[axis]);
+		packet.inverseDirection[axis] = MakeVectorRegisterFloat(GetInverseComponent(directions[0][axis]), GetInverseComponent(directions[1][axis]),
+			GetInverseComponent(directions[2][axis]), GetInverseComponent(directions[3][axis]));
+	}
+
+	int32 stack[MaxTraversalDepth];
+	int32 stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		const FNode& node = m_Nodes[stack[--stackSize]];
+		if (packet.Intersect(node.min, node.max) == 0)
+			continue;
+
+		if (node.numBoxes == 0)
+		{
+			// The median split keeps the tree balanced, so the depth stays far below the stack size
+			check(stackSize + 2 <= MaxTraversalDepth);
+			stack[stackSize++] = node.first + 1;
+			stack[stackSize++] = node.first;
+			continue;
+		}
+
+		for (int32 i = node.first; i < node.first + node.numBoxes; ++i)
+		{
+			const uint32 hits = packet.Intersect(m_Boxes[i].Min, m_Boxes[i].Max);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				outCounts[lane] += (hits >> lane) & 1u;
+			}
+		}
+	}
+}
+
+TArray<FBox3f> OverdrawAnalysis::GatherTranslucentBounds(const UWorld* pWorld)
+{
+	TArray<FBox3f> boxes;
+	if (!pWorld)
+		return boxes;
+
+	TArray<UPrimitiveComponent*> components;
+	for (TActorIterator<AActor> it(pWorld); it; ++it)
+	{
+		it->GetComponents<UPrimitiveComponent>(components);
+		for (const UPrimitiveComponent* pComponent : components)
+		{
+			if (!pComponent->IsRegistered() || !pComponent->IsVisible() || !IsTranslucent(pComponent))
+				continue;
+
+			const UInstancedStaticMeshComponent* pInstances = Cast<UInstancedStaticMeshComponent>(pComponent);
+			if (pInstances && pInstances->GetStaticMesh())
+			{
+				const FBox meshBounds = pInstances->GetStaticMesh()->GetBounds().GetBox();
+				for (int32 i = 0; i < pInstances->GetInstanceCount(); ++i)
+				{
+					FTransform instanceTransform;
+					if (pInstances->GetInstanceTransform(i, instanceTransform, true))
+						boxes.Add(FBox3f(meshBounds.TransformBy(instanceTransform)));
+				}
+			}
+			else
+			{
+				boxes.Add(FBox3f(pComponent->Bounds.GetBox()));
+			}
+		}
+	}
+	return boxes;
+}
+
+FOverdrawSummary OverdrawAnalysis::Analyze(const FBoxBVH& bvh, const FVector& viewOrigin, const FRotator& viewRotation, const float horizontalFov,
+	const int32 gridWidth, const int32 gridHeight, TArray<float>* pOutLayerMap)
+{
+	const double startTime = FPlatformTime::Seconds();
+
+	FOverdrawSummary summary;
+	summary.gridWidth = FMath::Max(1, gridWidth);
+	summary.gridHeight = FMath::Max(1, gridHeight);
+	summary.numPrimitives = bvh.GetNumBoxes();
+	summary.histogram.SetNumZeroed(MaxHistogramLayers + 1);
+
+	const float tanHalfWidth = FMath::Tan(FMath::DegreesToRadians(horizontalFov * 0.5f));
+	const float tanHalfHeight = tanHalfWidth * summary.gridHeight / summary.gridWidth;
+	const FQuat4f rotation(viewRotation.Quaternion());
+	const FVector3f origin(viewOrigin);
+
+	TArray<int32> layers;
+	layers.SetNumZeroed(summary.gridWidth * summary.gridHeight);
+
+	// A packet covers two rows and two columns, rays that fall off the grid repeat the last row or column
+	const int32 numPacketRows = FMath::DivideAndRoundUp(summary.gridHeight, 2);
+	ParallelFor(numPacketRows, [&](const int32 packetRow)
+	{
+		for (int32 x = 0; x < summary.gridWidth; x += 2)
+		{
+			FIntPoint cells[4];
+			FVector3f directions[4];
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				cells[lane] = FIntPoint(FMath::Min(x + (lane & 1), summary.gridWidth - 1), FMath::Min(packetRow * 2 + (lane >> 1), summary.gridHeight - 1));
+				const float slopeX = ((cells[lane].X + 0.5f) / summary.gridWidth * 2.f - 1.f) * tanHalfWidth;
+				const float slopeY = (1.f - (cells[lane].Y + 0.5f) / summary.gridHeight * 2.f) * tanHalfHeight;
+				directions[lane] = rotation.RotateVector(FVector3f(1.f, slopeX, slopeY));
+			}
+
+			int32 counts[4];
+			bvh.CountHits4(origin, directions, counts);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				layers[cells[lane].Y * summary.gridWidth + cells[lane].X] = counts[lane];
+			}
+		}
+	});
+
+	// Serial, one pass over the cells is cheap next to casting the rays
+	int64 totalLayers = 0;
+	int32 numCovered = 0;
+	for (const int32 count : layers)
+	{
+		totalLayers += count;
+		numCovered += count > 0 ? 1 : 0;
+		summary.maxLayers = FMath::Max(summary.maxLayers, count);
+		++summary.histogram[FMath::Min(count, MaxHistogramLayers)];
+	}
+	summary.meanLayers = static_cast<double>(totalLayers) / layers.Num();
+	summary.meanCoveredLayers = numCovered > 0 ? static_cast<double>(totalLayers) / numCovered : 0.0;
+	summary.coverage = static_cast<double>(numCovered) / layers.Num();
+
+	if (pOutLayerMap)
+	{
+		pOutLayerMap->SetNumUninitialized(layers.Num());
+		for (int32 i = 0; i < layers.Num(); ++i)
+		{
+			(*pOutLayerMap)[i] = static_cast<float>(layers[i]);
+		}
+	}
+
+	summary.analyzeMs = (FPlatformTime::Seconds() - startTime) * 1000.0;
+	return summary;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Translucent layers along a grid of rays through the view, what the pixels of a frame blend
+struct FOverdrawSummary
+{
+	int32 gridWidth{ 0 };
+	int32 gridHeight{ 0 };
+	int32 numPrimitives{ 0 };
+	// Over every ray, and over the rays that pass through at least one primitive
+	double meanLayers{ 0 };
+	double meanCoveredLayers{ 0 };
+	int32 maxLayers{ 0 };
+	double coverage{ 0 };
+	// Rays per layer count, the last bin holds every count from OverdrawAnalysis::MaxHistogramLayers up
+	TArray<int32> histogram;
+	double analyzeMs{ 0 };
+	FString heatmapPath;
+
+	bool IsValid() const { return gridWidth > 0 && gridHeight > 0; }
+};
+
+/**
+ * Bounding volume hierarchy over axis aligned boxes, split at the median centroid of the longest axis.
+ * Rays are traced four at a time from a shared origin, every node and box is tested against the whole packet
+ * in SIMD registers and a packet only descends where at least one of its rays enters.
+ */
+class FBoxBVH
+{
+public:
+	void Build(TArray<FBox3f> boxes);
+	int32 GetNumBoxes() const { return m_Boxes.Num(); }
+
+	// Boxes each of the rays passes through, including a box the origin is in. Directions do not need to be normalized
+	void CountHits4(const FVector3f& origin, const FVector3f (&directions)[4], int32 (&outCounts)[4]) const;
+
+private:
+	static constexpr int32 MaxLeafBoxes = 4;
+
+	struct FNode
+	{
+		FVector3f min;
+		// Inner nodes: the first of the two children, which are stored next to each other. Leaves: the first box
+		int32 first;
+		FVector3f max;
+		// 0 for inner nodes
+		int32 numBoxes;
+	};
+
+	TArray<FNode> m_Nodes;
+	TArray<FBox3f> m_Boxes;
+
+	void BuildNode(int32 nodeIndex, int32 first, int32 num, TArray<FVector3f>& centers);
+};
+
+namespace OverdrawAnalysis
+{
+	constexpr int32 MaxHistogramLayers = 32;
+
+	// Bounds of every visible primitive with a translucent material, one box per instance of an instanced component.
+	// Other meshes are approximated by the bounds of their component
+	TArray<FBox3f> GatherTranslucentBounds(const UWorld* pWorld);
+
+	// Casts a gridWidth x gridHeight grid of rays through the view in 2x2 packets, rows of packets run in parallel.
+	// The layer count of every ray goes to pOutLayerMap, row-major, when requested
+	FOverdrawSummary Analyze(const FBoxBVH& bvh, const FVector& viewOrigin, const FRotator& viewRotation, float horizontalFov,
+		int32 gridWidth, int32 gridHeight, TArray<float>* pOutLayerMap = nullptr);
+}
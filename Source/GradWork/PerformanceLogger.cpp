@@ -3,57 +3,280 @@
 
 #include "PerformanceLogger.h"
 
-FPerformanceLogger::FPerformanceLogger(float inDurationSeconds, float outlierPercentage, const FString& fileName, const FString& folderName)
+#include "Debug/DebugDrawService.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "Misc/CoreDelegates.h"
+
+FPerformanceLogger::FPerformanceLogger(float inDurationSeconds, float outlierPercentage, const FString& fileName, const FString& folderName, float maxExpectedFrameRate, float frameBudgetMs)
 	: m_FileName(fileName)
 	, m_FolderName(folderName)
 	, m_DurationSeconds(inDurationSeconds)
 	, m_OutlierPercentage(outlierPercentage)
 	, m_ElapsedTime(0.0f)
 	, m_bIsTracking(false)
+	, m_MinDurationSeconds(0.0f)
+	, m_TargetRelativeHalfWidth(0.0)
+	, m_StopReason(TEXT("Manual"))
+	, m_FramesPerTraceChunk(static_cast<size_t>(FMath::CeilToInt(maxExpectedFrameRate)))
+	, m_TrackingStartTime(0.0)
+	, m_bIsMinimalInstrumentation(false)
+	, m_MemorySampleInterval(30)
+	, m_ResourceSampleInterval(0)
+	, m_OnScreenInterval(0.5f)
+	, m_NextOnScreenTime(0.0f)
+	, m_NumTrackedFrames(0)
+	, m_PathProgress(-1.0f)
+	, m_InstanceSortTime(-1.0)
+	, m_InstanceUploadKB(-1.0)
+	, m_LastUpdateTime(0.0)
+	, m_pRenderStatsRing(MakeShared<FRenderStatsRing, ESPMode::ThreadSafe>())
+	, m_NextFrameToResolve(0)
+	, m_pRenderStatsRequest(MakeShared<FRenderStatsRequest, ESPMode::ThreadSafe>())
+	, m_LastTrackedFrame(0)
 {
+	m_Histograms.reserve(FFrameMetricSchema::NumMetrics);
+	for (const FMetricDesc& desc : FFrameMetricSchema::Descs)
+	{
+		m_Histograms.emplace_back(desc.unitsPerValue, desc.bUsesFrameBudget ? frameBudgetMs : 0.0);
+	}
+
+	for (FFrameSample& pendingFrame : m_PendingFrames)
+	{
+		pendingFrame = FFrameMetricSchema::MakeUnmeasured();
+	}
+
+	m_PathSegmentHistograms.reserve(NumPathSegments);
+	for (int32 i = 0; i < NumPathSegments; ++i)
+	{
+		m_PathSegmentHistograms.emplace_back(1000.0, frameBudgetMs);
+	}
+
+	m_DebugDrawHandle = UDebugDrawService::Register(TEXT("Game"), FDebugDrawDelegate::CreateRaw(this, &FPerformanceLogger::DrawOnScreenProgress));
+
+	// Hooked into the end of every render thread frame once, so tracking never has to queue a render command
+	ENQUEUE_RENDER_COMMAND(RegisterRenderStatsCommand)(
+		[pRing = m_pRenderStatsRing, pRequest = m_pRenderStatsRequest](FRHICommandListImmediate&)
+		{
+			pRequest->endFrameHandle = FCoreDelegates::OnEndFrameRT.AddLambda([pRing, pRequest]()
+			{
+				PublishRenderStats(pRing, *pRequest);
+			});
+		});
+}
+
+FPerformanceLogger::~FPerformanceLogger()
+{
+	UDebugDrawService::Unregister(m_DebugDrawHandle);
+
+	m_pRenderStatsRequest->bIsEnabled = false;
+	ENQUEUE_RENDER_COMMAND(UnregisterRenderStatsCommand)(
+		[pRequest = m_pRenderStatsRequest](FRHICommandListImmediate&)
+		{
+			FCoreDelegates::OnEndFrameRT.Remove(pRequest->endFrameHandle);
+		});
 }
 
 void FPerformanceLogger::Update(const float deltaTime)
 {
 	if (m_bIsTracking == false)
 		return;
-	
+
+	// Everything up to the stop check is the logger's own cost for this frame
+	const uint64 updateStartCycles = FPlatformTime::Cycles64();
 	m_ElapsedTime += deltaTime;
 
 	// Capture stats
-	const double currentTime = FApp::GetCurrentTime();
-	const double frameTime = (currentTime - FApp::GetLastTime()) * 1000.0;
-	const double gameThreadTime = FPlatformTime::ToMilliseconds(GGameThreadTime);
-	const double renderThreadTime = FPlatformTime::ToMilliseconds(GRenderThreadTime);
-	const double gpuCycles = RHIGetGPUFrameCycles();
-	const double gpuTime = FPlatformTime::ToMilliseconds(gpuCycles);
-	const int32 drawCalls = TrackDrawCalls();
-
-	// Capture memory usage
-	const FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
-	const double usedPhysicalMemoryMB = MemoryStats.UsedPhysical / (1024.0 * 1024.0);
-	const double usedVirtualMemoryMB = MemoryStats.UsedVirtual / (1024.0 * 1024.0);
-	
-	// Store stats
-	m_StatsData.push_back({ frameTime, gameThreadTime, renderThreadTime, gpuTime, drawCalls, usedPhysicalMemoryMB, usedVirtualMemoryMB });
+	const double currentTime = FPlatformTime::Seconds();
+	FFrameContext context;
+	context.frameNumber = GFrameNumber;
+	context.frameTime = (currentTime - m_LastUpdateTime) * 1000.0;
+	context.pathProgress = m_PathProgress;
+	context.instanceSortTime = m_InstanceSortTime;
+	context.instanceUploadKB = m_InstanceUploadKB;
+	m_LastUpdateTime = currentTime;
+
+	// Store stats until the RHI counters for this frame come in
+	FFrameSample& sample = m_PendingFrames[context.frameNumber % PendingFramesSize];
+	sample = FFrameMetricSchema::MakeUnmeasured();
+	SampleMetrics<EMetricRate::Always>(context, sample);
+	if (m_PathProgress >= 0.0f)
+	{
+		const int32 segment = FMath::Min(static_cast<int32>(m_PathProgress * NumPathSegments), NumPathSegments - 1);
+		m_PathSegmentHistograms[segment].Record(context.frameTime);
+	}
+	const bool bHasNewBatch = m_FrameTimePrecision.AddFrame(context.frameTime);
+
+	if (m_bIsMinimalInstrumentation == false)
+	{
+		SampleFrame(context, sample);
+	}
+	m_LastTrackedFrame = context.frameNumber;
+	// This frame's own cost is only known below, it goes to the trace with the next update at the earliest
+	ResolveDrawCalls(context.frameNumber - 1);
+
+	context.loggerTime = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - updateStartCycles) * 1000.0;
+	SampleMetrics<EMetricRate::Logger>(context, sample);
+	++m_NumTrackedFrames;
 
 	// If duration is reached, stop tracking and process stats
 	if (m_ElapsedTime >= m_DurationSeconds)
 	{
+		m_StopReason = TEXT("Duration");
 		StopTracking();
 	}
+	else if (bHasNewBatch && m_TargetRelativeHalfWidth > 0.0 && m_ElapsedTime >= m_MinDurationSeconds
+		&& m_FrameTimePrecision.IsPrecise(m_Histograms[FrameTimeIndex], m_TargetRelativeHalfWidth))
+	{
+		m_StopReason = TEXT("Converged");
+		StopTracking();
+	}
+}
+
+template <EMetricRate Rate, typename SourceType>
+void FPerformanceLogger::SampleMetrics(const SourceType& source, FFrameSample& sample)
+{
+	FFrameMetricSchema::ForEachMetric([this, &source, &sample](auto slot)
+	{
+		using FMetric = typename decltype(slot)::FMetric;
+		if constexpr (FMetric::Desc.rate == Rate)
+		{
+			auto& value = FFrameMetricSchema::Get<FMetric>(sample);
+			value = FMetric::Sample(source);
+			if (FMetric::Desc.label != nullptr && FFrameMetricSchema::IsMeasured(value))
+			{
+				m_Histograms[decltype(slot)::Index].Record(static_cast<double>(value));
+			}
+		}
+	});
+}
+
+void FPerformanceLogger::SampleFrame(FFrameContext& context, FFrameSample& sample)
+{
+	m_GPUPassTimings.Sample(context.gpuPassTimes);
+	SampleMetrics<EMetricRate::EveryFrame>(context, sample);
+
+	// The OS and LLM are asked for memory totals, expensive probes, so they skip frames
+	if (m_NumTrackedFrames % m_MemorySampleInterval == 0)
+	{
+		context.memoryStats = FPlatformMemory::GetStats();
+		SampleMetrics<EMetricRate::Periodic>(context, sample);
+	}
+
+	m_HitchAnalyzer.AddFrame(context.frameNumber, m_LastUpdateTime - m_TrackingStartTime, context.frameTime,
+		FFrameMetricSchema::Get<FrameMetrics::FGameThreadTime>(sample), FFrameMetricSchema::Get<FrameMetrics::FRenderThreadTime>(sample),
+		FMath::Max(0.0, FFrameMetricSchema::Get<FrameMetrics::FGPUTime>(sample)));
+}
+
+void FPerformanceLogger::DrawOnScreenProgress(UCanvas* pCanvas, APlayerController*)
+{
+	// Screenshots turn screen messages off, the progress text follows them
+	if (!m_bIsTracking || m_OnScreenInterval <= 0.f || !GAreScreenMessagesEnabled)
+		return;
+
+	// Formatting the text every frame shows up in the game thread time, a few updates a second will do
+	if (m_ElapsedTime >= m_NextOnScreenTime)
+	{
+		m_NextOnScreenTime = m_ElapsedTime + m_OnScreenInterval;
+		m_OnScreenText = FString::Printf(TEXT("Elapsed Time: %.1f / %.1f"), m_ElapsedTime, m_DurationSeconds);
+	}
+
+	pCanvas->SetDrawColor(FColor::Yellow);
+	pCanvas->DrawText(GEngine->GetSmallFont(), m_OnScreenText, 10.f, 10.f);
+}
+
+void FPerformanceLogger::SetTraceMetadata(const FString& key, const FString& value)
+{
+	if (TPair<FString, FString>* pEntry = m_TraceMetadata.FindByPredicate([&key](const TPair<FString, FString>& entry) { return entry.Key == key; }))
+	{
+		pEntry->Value = value;
+		return;
+	}
+
+	m_TraceMetadata.Emplace(key, value);
+}
+
+void FPerformanceLogger::RemoveTraceMetadata(const FString& key)
+{
+	m_TraceMetadata.RemoveAll([&key](const TPair<FString, FString>& entry) { return entry.Key == key; });
+}
+
+void FPerformanceLogger::SetEarlyStop(const float minDurationSeconds, const double targetRelativeHalfWidth)
+{
+	m_MinDurationSeconds = minDurationSeconds;
+	m_TargetRelativeHalfWidth = targetRelativeHalfWidth;
+}
+
+void FPerformanceLogger::EnableGPUPassTimings(UWorld* pWorld)
+{
+	m_GPUPassTimings.Enable(pWorld);
+}
+
+void FPerformanceLogger::SetMinimalInstrumentation(const bool bIsMinimal)
+{
+	if (m_bIsTracking)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cannot change the instrumentation of a run while it is being tracked."));
+		return;
+	}
+
+	m_bIsMinimalInstrumentation = bIsMinimal;
+}
+
+void FPerformanceLogger::SetProbeIntervals(const int32 memoryFrames, const int32 resourceFrames, const float onScreenSeconds)
+{
+	m_MemorySampleInterval = FMath::Max(1, memoryFrames);
+	m_ResourceSampleInterval = FMath::Max(0, resourceFrames);
+	m_OnScreenInterval = onScreenSeconds;
+}
+
+void FPerformanceLogger::SetRunNames(const FString& fileName, const FString& folderName)
+{
+	if (m_bIsTracking)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Cannot rename a run while it is being tracked."));
+		return;
+	}
 
-	const auto string = FString::Printf(TEXT("Elapsed Time: %f / %f"), m_ElapsedTime, m_DurationSeconds);
-	GEngine->AddOnScreenDebugMessage(-1, deltaTime, FColor::Yellow, string);
+	m_FileName = fileName;
+	m_FolderName = folderName;
 }
 
 void FPerformanceLogger::StartTracking()
 {
 	if (!m_bIsTracking)
 	{
-		m_StatsData.clear();
+		for (FStreamingHistogram& histogram : m_Histograms)
+		{
+			histogram.Reset();
+		}
+		for (FStreamingHistogram& histogram : m_PathSegmentHistograms)
+		{
+			histogram.Reset();
+		}
+		m_FrameTimePrecision.Reset();
+		m_HitchAnalyzer.Reset();
+		m_NumTrackedFrames = 0;
+		m_NextOnScreenTime = 0.0f;
+		m_OnScreenText.Reset();
+		m_StopReason = TEXT("Manual");
+		m_NextFrameToResolve = GFrameNumber;
+		m_LastTrackedFrame = GFrameNumber;
+
+		// Without an RHI there is nothing to count, these metrics are left out of the report
+		m_pRenderStatsRequest->firstFrame = GFrameNumber;
+		m_pRenderStatsRequest->resourceInterval = m_ResourceSampleInterval;
+		m_pRenderStatsRequest->bIsEnabled = !m_bIsMinimalInstrumentation && !GUsingNullRHI;
+
+		// All file system work happens here or on the writer thread, never while tracking
+		m_LogFilePath = GetLogFilePath();
+		m_pTraceWriter = MakeUnique<FFrameTraceWriter>(FPaths::ChangeExtension(m_LogFilePath, FrameTrace::Extension), BuildTraceMetadata(), m_FramesPerTraceChunk);
+
 		m_ElapsedTime = 0.0f;
+		m_LastUpdateTime = FPlatformTime::Seconds();
+		m_TrackingStartTime = m_LastUpdateTime;
 		m_bIsTracking = true;
+		m_LiveTelemetry.BeginRun(m_FileName, m_FolderName, m_DurationSeconds);
         GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Green, "Started tracking performance");
 		UE_LOG(LogTemp, Log, TEXT("Performance tracking started."));
 	}
@@ -64,53 +287,240 @@ void FPerformanceLogger::StopTracking()
 	if (m_bIsTracking)
 	{
 		m_bIsTracking = false;
+		m_pRenderStatsRequest->bIsEnabled = false;
 		ProcessAndSaveStats();
-		m_StatsData.clear();
+		m_LiveTelemetry.EndRun();
         GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, "Stopped tracking performance");
 		UE_LOG(LogTemp, Log, TEXT("Performance tracking stopped."));
 	}
 }
 
-int32 FPerformanceLogger::TrackDrawCalls()
+void FPerformanceLogger::PublishRenderStats(const TSharedRef<FRenderStatsRing, ESPMode::ThreadSafe>& pRing, const FRenderStatsRequest& request)
+{
+	// The render thread publishes the counters into the ring, the game thread never waits for it
+	const uint64 frameNumber = GFrameNumberRenderThread;
+	const uint64 firstFrame = request.firstFrame;
+	if (!request.bIsEnabled || frameNumber < firstFrame)
+		return;
+
+	FRenderStatsSample sample{ 0, 0 };
+	for (int64& bytes : sample.resourceBytes)
+	{
+		bytes = -1;
+	}
+	const int32 resourceInterval = request.resourceInterval;
+	if (resourceInterval > 0 && (frameNumber - firstFrame) % resourceInterval == 0)
+	{
+		FrameMetrics::GatherResourceMemory(sample.resourceBytes);
+	}
+
+	// Sum up draw calls across all GPUs
+	for (int32 i = 0; i < MAX_NUM_GPUS; i++)
+	{
+		sample.drawCalls += GNumDrawCallsRHI[i];
+		sample.primitivesDrawn += GNumPrimitivesDrawnRHI[i];
+	}
+
+	pRing->Publish(frameNumber, sample);
+}
+
+void FPerformanceLogger::ResolveDrawCalls(const uint64 currentFrame)
 {
-	// Use a temporary variable to safely transfer data back to the game thread
-	int32 drawCallsThisFrame = 0;
+	for (; m_NextFrameToResolve <= currentFrame; ++m_NextFrameToResolve)
+	{
+		const uint64 frameNumber = m_NextFrameToResolve;
+		FFrameSample& pendingFrame = m_PendingFrames[frameNumber % PendingFramesSize];
 
-	// Ensure this code runs on the rendering thread
-	ENQUEUE_RENDER_COMMAND(GetDrawCallsCommand)(
-		[&drawCallsThisFrame](FRHICommandListImmediate&)
+		FRenderStatsSample stats;
+		if (m_pRenderStatsRing->TryRead(frameNumber, stats))
 		{
-			// Sum up draw calls across all contexts
-			for (int32 i = 0; i < 8; i++)
-			{
-				drawCallsThisFrame += GNumDrawCallsRHI[i];
-			}
-		});
+			SampleMetrics<EMetricRate::RenderThread>(stats, pendingFrame);
+		}
+		else if (currentFrame - frameNumber < RenderStatsRingSize)
+		{
+			// Render thread has not reached this frame yet, try again next frame
+			break;
+		}
 
-	// Use a render fence to wait for the render thread to finish
-	FRenderCommandFence renderFence;
-	renderFence.BeginFence();
-	renderFence.Wait();
+		// Either resolved or overwritten in the ring, in which case the frame is left out of the RHI stats
+		if (FFrameMetricSchema::Get<FrameMetrics::FFrameNumber>(pendingFrame) == frameNumber)
+		{
+			WriteFrame(pendingFrame);
+		}
+	}
+}
+
+void FPerformanceLogger::FlushPendingFrames()
+{
+	// Pick up whatever the render thread published since the last update
+	ResolveDrawCalls(m_LastTrackedFrame);
 
-	return drawCallsThisFrame;
+	// Frames still in flight go to the trace without their RHI counters
+	for (; m_NextFrameToResolve <= m_LastTrackedFrame; ++m_NextFrameToResolve)
+	{
+		const FFrameSample& pendingFrame = m_PendingFrames[m_NextFrameToResolve % PendingFramesSize];
+		if (FFrameMetricSchema::Get<FrameMetrics::FFrameNumber>(pendingFrame) == m_NextFrameToResolve)
+		{
+			WriteFrame(pendingFrame);
+		}
+	}
+}
+
+void FPerformanceLogger::WriteFrame(const FFrameSample& sample)
+{
+	if (m_pTraceWriter)
+	{
+		m_pTraceWriter->Append(sample);
+	}
+	m_LiveTelemetry.Publish(sample);
 }
 
 void FPerformanceLogger::ProcessAndSaveStats()
 {
-	if (m_StatsData.empty())
+	FlushPendingFrames();
+
+	// The writer closes the trace in the background
+	if (m_pTraceWriter)
+	{
+		m_pTraceWriter->Finish();
+	}
+
+	// Only ever belongs to the window it was set for
+	FOverdrawSummary overdraw = MoveTemp(m_Overdraw);
+	const TArray<float> overdrawLayerMap = MoveTemp(m_OverdrawLayerMap);
+	m_Overdraw = FOverdrawSummary();
+	m_OverdrawLayerMap.Reset();
+
+	if (m_Histograms[FrameTimeIndex].Num() == 0)
 		return;
 
-	const FString filePath = GetLogFilePath();
-	
-	LogStats("FrameTime - ms", filePath, ExtractMetric<double>([](const FStatEntry& entry) -> double { return entry.frameTime; }));
-	LogStats("GameThreadTime - ms", filePath, ExtractMetric<double>([](const FStatEntry& entry) { return entry.gameThreadTime; }));
-	LogStats("RenderThreadTime - ms", filePath, ExtractMetric<double>([](const FStatEntry& entry) { return entry.renderThreadTime; }));
-	LogStats("GPUTime - ms", filePath, ExtractMetric<double>([](const FStatEntry& entry) { return entry.gpuTime; }));
-	LogStats("DrawCalls", filePath, ExtractMetric<int32>([](const FStatEntry& entry) { return static_cast<double>(entry.drawCalls); }));
-	LogStats("Physical Memory - MB", filePath, ExtractMetric<double>([](const FStatEntry& entry) { return entry.usedPhysicalMemoryMB; }));
-	LogStats("Virtual Memory - MB", filePath, ExtractMetric<double>([](const FStatEntry& entry) { return entry.usedVirtualMemoryMB; }));
+	FRunResult result;
+	result.scene = m_FileName;
+	result.mode = m_FolderName;
+	result.metadata = m_pTraceWriter ? m_pTraceWriter->GetMetadata() : BuildTraceMetadata();
+	result.logFilePath = m_LogFilePath;
+	result.traceFilePath = m_pTraceWriter ? m_pTraceWriter->GetFilePath() : FString();
+	result.numDroppedTraceFrames = m_pTraceWriter ? m_pTraceWriter->GetNumDroppedFrames() : 0;
+	result.metadata.Emplace(TEXT("StopReason"), m_StopReason);
+	result.metadata.Emplace(TEXT("TrackedSeconds"), FString::Printf(TEXT("%.1f"), m_ElapsedTime));
+	for (int32 i = 0; i < FFrameMetricSchema::NumMetrics; ++i)
+	{
+		const FStreamingHistogram& histogram = m_Histograms[i];
+		if (histogram.Num() > 0)
+		{
+			result.metrics.Add({ FFrameMetricSchema::Descs[i].label, histogram.Summarize(m_OutlierPercentage), histogram.GetBudget() > 0.0 });
+		}
+	}
+	for (int32 i = 0; i < NumPathSegments; ++i)
+	{
+		if (m_PathSegmentHistograms[i].Num() > 0)
+		{
+			const FString name = FString::Printf(TEXT("Path %d-%d%%"), i * 100 / NumPathSegments, (i + 1) * 100 / NumPathSegments);
+			result.pathSegments.Add({ name, m_PathSegmentHistograms[i].Summarize(m_OutlierPercentage), true });
+		}
+	}
+	result.hitches = m_HitchAnalyzer.Summarize(m_LastUpdateTime - m_TrackingStartTime);
+
+	// Ensure the directory exists
+	EnsureDirectoryExists(FPaths::GetPath(m_LogFilePath));
+
+	// Normalized to the deepest ray of the view, the report has the absolute maximum
+	if (overdraw.IsValid() && overdrawLayerMap.Num() == overdraw.gridWidth * overdraw.gridHeight && overdraw.maxLayers > 0)
+	{
+		TArray<float> heatmap;
+		heatmap.SetNumUninitialized(overdrawLayerMap.Num());
+		for (int32 i = 0; i < overdrawLayerMap.Num(); ++i)
+		{
+			heatmap[i] = overdrawLayerMap[i] / overdraw.maxLayers;
+		}
+
+		const FString heatmapPath = FPaths::GetPath(m_LogFilePath) / FPaths::GetBaseFilename(m_LogFilePath) + TEXT("_layers.png");
+		if (ImageQuality::WriteHeatmap(heatmapPath, heatmap, overdraw.gridWidth, overdraw.gridHeight))
+			overdraw.heatmapPath = heatmapPath;
+		else
+			UE_LOG(LogTemp, Warning, TEXT("Could not write layer heatmap to %s."), *heatmapPath);
+	}
+	result.overdraw = MoveTemp(overdraw);
+
+	// Write all stats in one go
+	if (std::ofstream file(TCHAR_TO_UTF8(*m_LogFilePath), std::ios::app); file.is_open())
+	{
+		// If the file is empty, write the header
+		file.seekp(0, std::ios::end);
+		if (file.tellp() == 0)
+		{
+			file << TCHAR_TO_UTF8(*BenchmarkReport::FormatStatsHeader());
+		}
+
+		for (const FMetricResult& metric : result.metrics)
+		{
+			file << TCHAR_TO_UTF8(*BenchmarkReport::FormatStatsRow(metric));
+		}
+
+		file << "Tracked " << m_ElapsedTime << " s, stopped on " << TCHAR_TO_UTF8(m_StopReason) << '\n';
+
+		file << TCHAR_TO_UTF8(*BenchmarkReport::FormatPathSegments(result.pathSegments));
+
+		file << TCHAR_TO_UTF8(*BenchmarkReport::FormatHitches(result.hitches, true));
+
+		file << TCHAR_TO_UTF8(*BenchmarkReport::FormatOverdraw(result));
+
+		if (result.numDroppedTraceFrames > 0)
+		{
+			file << "Trace dropped " << result.numDroppedTraceFrames << " frames\n";
+		}
+
+		file.close();
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Logged stats to: %s"), *m_LogFilePath);
+	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Written stats to " + m_LogFilePath);
+
+	if (m_OnRunFinished)
+	{
+		m_OnRunFinished(MoveTemp(result));
+	}
+}
+
+FFrameTraceMetadata FPerformanceLogger::BuildTraceMetadata() const
+{
+	FFrameTraceMetadata metadata;
+	metadata.Emplace(TEXT("Scene"), m_FileName);
+	metadata.Emplace(TEXT("Mode"), m_FolderName);
+	metadata.Append(m_TraceMetadata);
+	metadata.Emplace(TEXT("Instrumentation"), m_bIsMinimalInstrumentation ? TEXT("Minimal") : TEXT("Full"));
+	metadata.Emplace(TEXT("MemorySampleInterval"), FString::FromInt(m_MemorySampleInterval));
+
+	// Build info
+	metadata.Emplace(TEXT("Project"), FApp::GetProjectName());
+	metadata.Emplace(TEXT("BuildVersion"), FApp::GetBuildVersion());
+	metadata.Emplace(TEXT("BuildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+	metadata.Emplace(TEXT("Platform"), ANSI_TO_TCHAR(FPlatformProperties::IniPlatformName()));
+	metadata.Emplace(TEXT("RHI"), GDynamicRHI ? GDynamicRHI->GetName() : TEXT("None"));
+	metadata.Emplace(TEXT("GPU"), GRHIAdapterName);
+	metadata.Emplace(TEXT("Profile"), GUsingNullRHI ? TEXT("CPU-only (NullRHI)") : TEXT("Full"));
+	metadata.Emplace(TEXT("Date"), FDateTime::Now().ToString());
+
+	// Settings that change what a transparency benchmark measures
+	static const TCHAR* CVarNames[] =
+	{
+		TEXT("r.OIT.SortedPixels"),
+		TEXT("r.RayTracing"),
+		TEXT("r.RayTracing.Translucency"),
+		TEXT("r.ScreenPercentage"),
+		TEXT("r.Shadow.Virtual.Enable"),
+		TEXT("r.VSync"),
+		TEXT("t.MaxFPS"),
+	};
+	for (const TCHAR* cvarName : CVarNames)
+	{
+		if (const IConsoleVariable* pCVar = IConsoleManager::Get().FindConsoleVariable(cvarName))
+		{
+			metadata.Emplace(cvarName, pCVar->GetString());
+		}
+	}
 
-	GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Cyan, "Written stats to " + filePath);
+	return metadata;
 }
 
 FString FPerformanceLogger::GetLogFilePath() const
@@ -118,7 +528,8 @@ FString FPerformanceLogger::GetLogFilePath() const
 	const FDateTime now = FDateTime::Now();
 	const FString dateString = now.ToString(TEXT("%Y-%m-%d"));
 	const FString modeString = m_FolderName;
-	const FString directory = FPaths::ProjectDir() / "PerformanceLogs" / dateString / modeString;
+	const FString root = m_OutputDirectory.IsEmpty() ? FPaths::ProjectDir() / "PerformanceLogs" : m_OutputDirectory;
+	const FString directory = root / dateString / modeString;
 	const FString extension = ".txt";
    
 	FString uniqueFilePath = directory / m_FileName + extension;
@@ -1,127 +1,157 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
+#include "BenchmarkReport.h"
+#include "FrameMetrics.h"
+#include "FrameTrace.h"
+#include "GPUPassTimings.h"
+#include "HitchAnalyzer.h"
+#include "LiveTelemetry.h"
+#include "RenderStatsRing.h"
+#include "SteadyStateDetector.h"
+#include "StreamingHistogram.h"
+#include <atomic>
 #include <vector>
-#include <algorithm>
 #include <fstream>
-#include <functional>
+
+class UCanvas;
 
 class FPerformanceLogger
 {
 public:
-    explicit FPerformanceLogger(float inDurationSeconds, float outlierPercentage, const FString& fileName, const FString& folderName);
+    explicit FPerformanceLogger(float inDurationSeconds, float outlierPercentage, const FString& fileName, const FString& folderName, float maxExpectedFrameRate = 1000.f, float frameBudgetMs = 1000.f / 60.f);
+    ~FPerformanceLogger();
     
+    // Allocates nothing while tracking, see PerformanceLoggerTest.cpp
     void Update(float deltaTime);
+
+    // Extra key/value pairs (position, ...) written to the header of the next trace
+    void SetTraceMetadata(const FString& key, const FString& value);
+    void RemoveTraceMetadata(const FString& key);
+    // Names used for the next window, the file is named after the scene and grouped in a folder per mode
+    void SetRunNames(const FString& fileName, const FString& folderName);
+    // Root for the logs instead of <Project>/PerformanceLogs
+    void SetOutputDirectory(const FString& directory) { m_OutputDirectory = directory; }
+    void SetDuration(float durationSeconds) { m_DurationSeconds = durationSeconds; }
+    // Stops before the duration once the frame time intervals are narrower than the target (e.g. 0.01 for 1%), 0 disables it
+    void SetEarlyStop(float minDurationSeconds, double targetRelativeHalfWidth);
+    // Called with the summary of every window once its stats are written
+    void SetOnRunFinished(TFunction<void(FRunResult&&)> onRunFinished) { m_OnRunFinished = MoveTemp(onRunFinished); }
+    // Where along a camera path the next frame is rendered (0-1), -1 for a static view
+    void SetPathProgress(float progress) { m_PathProgress = progress; }
+    // Cost of the scene's last instance sort, -1 for both when the scene does not sort
+    void SetInstanceSortStats(double sortTimeUs, double uploadKB) { m_InstanceSortTime = sortTimeUs; m_InstanceUploadKB = uploadKB; }
+    // Adds the GPU time of the base pass, translucency, OIT and ray traced translucency, stays on for the session
+    void EnableGPUPassTimings(UWorld* pWorld);
+    // Only the wall clock frame time and the logger's own cost are tracked, to measure what the other probes cost
+    void SetMinimalInstrumentation(bool bIsMinimal);
+    // Memory stats every memoryFrames tracked frames, RHI resource memory every resourceFrames (0 leaves it out),
+    // the on-screen progress every onScreenSeconds (0 hides it)
+    void SetProbeIntervals(int32 memoryFrames, int32 resourceFrames, float onScreenSeconds);
+    // A frame is a hitch above budgetMs (0 disables it) or above the multiple of the rolling median frame time
+    void SetHitchThresholds(double budgetMs, double medianMultiplier) { m_HitchAnalyzer.SetThresholds(budgetMs, medianMultiplier); }
+    // Layer counts of the view the next window starts from, attached to its result with a heatmap of the layer map
+    void SetOverdraw(const FOverdrawSummary& overdraw, TArray<float> layerMap) { m_Overdraw = overdraw; m_OverdrawLayerMap = MoveTemp(layerMap); }
+    // Every frame that goes to the trace is also published to the named shared memory segment, for a live viewer
+    bool EnableLiveTelemetry(const FString& segmentName) { return m_LiveTelemetry.Open(segmentName); }
     
     bool IsTracking() const { return m_bIsTracking; }
+    float GetElapsedTime() const { return m_ElapsedTime; }
     void StartTracking();
     void StopTracking();
     
 private:
-    struct FStatEntry
-    {
-        double frameTime;
-        double gameThreadTime;
-        double renderThreadTime;
-        double gpuTime;
-        int32 drawCalls;
-        double usedPhysicalMemoryMB;
-        double usedVirtualMemoryMB;
-    };
+    static constexpr int32 FrameTimeIndex = FFrameMetricSchema::IndexOf<FrameMetrics::FFrameTime>();
 
-    FString m_FileName, m_FolderName;
+    FString m_FileName, m_FolderName, m_OutputDirectory;
     float m_DurationSeconds;
     float m_OutlierPercentage;
     float m_ElapsedTime;
     bool m_bIsTracking;
-    std::vector<FStatEntry> m_StatsData;
 
-    static int32 TrackDrawCalls();
+    float m_MinDurationSeconds;
+    double m_TargetRelativeHalfWidth;
+    FPrecisionTracker m_FrameTimePrecision;
+    const TCHAR* m_StopReason;
+
+    FString m_LogFilePath;
+    FFrameTraceMetadata m_TraceMetadata;
+    TFunction<void(FRunResult&&)> m_OnRunFinished;
+
+    // Raw frame series is streamed to disk in chunks of one second at the max expected frame rate
+    size_t m_FramesPerTraceChunk;
+    TUniquePtr<FFrameTraceWriter> m_pTraceWriter;
+
+    // Every metric is aggregated on the fly, so the summary does not depend on the raw series being kept, one per schema column
+    std::vector<FStreamingHistogram> m_Histograms;
+
+    FGPUPassTimings m_GPUPassTimings;
+
+    // Looks at every frame as it comes in, the histograms alone cannot tell when the slow frames happened
+    FHitchAnalyzer m_HitchAnalyzer;
+    double m_TrackingStartTime;
+
+    FOverdrawSummary m_Overdraw;
+    TArray<float> m_OverdrawLayerMap;
+
+    FLiveTelemetryWriter m_LiveTelemetry;
+
+    // Probes that cost more than reading a counter are sampled at a lower rate or left out entirely
+    bool m_bIsMinimalInstrumentation;
+    int32 m_MemorySampleInterval;
+    int32 m_ResourceSampleInterval;
+    float m_OnScreenInterval;
+    float m_NextOnScreenTime;
+    uint64 m_NumTrackedFrames;
+
+    // Frame time split over equal parts of the camera path, so a spike can be traced back to where it happened
+    static constexpr int32 NumPathSegments = 10;
+    std::vector<FStreamingHistogram> m_PathSegmentHistograms;
+    float m_PathProgress;
+    double m_InstanceSortTime;
+    double m_InstanceUploadKB;
+    // Wall clock, frame times stay real when the engine runs with a fixed timestep
+    double m_LastUpdateTime;
+
+    // Drawn with the debug canvas instead of queued from Update, the text is only formatted every m_OnScreenInterval
+    FDelegateHandle m_DebugDrawHandle;
+    FString m_OnScreenText;
+
+    // RHI counters arrive a few frames late through the ring, frames are recorded once they show up
+    static constexpr uint32 RenderStatsRingSize = 16;
+    using FRenderStatsRing = TRenderStatsRing<RenderStatsRingSize>;
+    TSharedRef<FRenderStatsRing, ESPMode::ThreadSafe> m_pRenderStatsRing;
+    uint64 m_NextFrameToResolve;
+
+    // What the render thread publishes at the end of its frames, written by the game thread when tracking starts and stops
+    struct FRenderStatsRequest
+    {
+        std::atomic<bool> bIsEnabled{ false };
+        std::atomic<uint64> firstFrame{ 0 };
+        std::atomic<int32> resourceInterval{ 0 };
+        // Render thread only
+        FDelegateHandle endFrameHandle;
+    };
+    TSharedRef<FRenderStatsRequest, ESPMode::ThreadSafe> m_pRenderStatsRequest;
+
+    // Frames waiting for their RHI counters before they go to the trace, indexed by frame number
+    static constexpr uint32 PendingFramesSize = RenderStatsRingSize * 2;
+    FFrameSample m_PendingFrames[PendingFramesSize];
+    uint64 m_LastTrackedFrame;
+
+    // Samples every metric of the rate from the frame context or the render thread's counters and aggregates it
+    template <EMetricRate Rate, typename SourceType>
+    void SampleMetrics(const SourceType& source, FFrameSample& sample);
+    void SampleFrame(FFrameContext& context, FFrameSample& sample);
+    void DrawOnScreenProgress(UCanvas* pCanvas, APlayerController* pController);
+    static void PublishRenderStats(const TSharedRef<FRenderStatsRing, ESPMode::ThreadSafe>& pRing, const FRenderStatsRequest& request);
+    void ResolveDrawCalls(uint64 currentFrame);
+    void FlushPendingFrames();
+    // A frame is complete, to the trace and the live telemetry
+    void WriteFrame(const FFrameSample& sample);
     void ProcessAndSaveStats();
-    
-    template<typename T>
-    std::vector<T> ExtractMetric(std::function<T(const FStatEntry&)> metricGetter);
-    template<typename T>
-    void LogStats(const FString& statName, const FString& filepath, const std::vector<T>& data);
+    FFrameTraceMetadata BuildTraceMetadata() const;
 
     FString GetLogFilePath() const;
     static void EnsureDirectoryExists(const FString& directoryPath);
-    template <typename T>
-    static FString FormatStatsRow(const FString& StatName, T Min, T Max, double Average);
-    template <typename T>
-    void CalculateStats(const std::vector<T>& data, T& outMin, T& outMax, double& outAverage) const;
 };
-
-template <typename T>
-std::vector<T> FPerformanceLogger::ExtractMetric(std::function<T(const FStatEntry&)> metricGetter)
-{
-    std::vector<T> metricValues;
-    for (const auto& entry : m_StatsData)
-    {
-        metricValues.push_back(metricGetter(entry));
-    }
-    return metricValues;
-}
-
-template <typename T>
-void FPerformanceLogger::LogStats(const FString& statName, const FString& filepath, const std::vector<T>& data)
-{
-    T min, max;
-    double average;
-
-    // Calculate stats
-    CalculateStats(data, min, max, average);
-
-    // Ensure the directory exists
-    EnsureDirectoryExists(FPaths::GetPath(filepath));
-
-    // Write stats to the file
-    if (std::ofstream file(TCHAR_TO_UTF8(*filepath), std::ios::app); file.is_open())
-    {
-        // If the file is empty, write the header
-        file.seekp(0, std::ios::end);
-        if (file.tellp() == 0)
-        {
-            file << "Stat Name              | Min       | Max       | Average\n";
-            file << "--------------------------------------------------------\n";
-        }
-
-        // Write formatted stats
-        file << TCHAR_TO_UTF8(*FormatStatsRow(statName, min, max, average));
-        file.close();
-    }
-
-    UE_LOG(LogTemp, Log, TEXT("Logged %s stats to: %s"), *statName, *filepath);
-}
-
-template <typename T>
-FString FPerformanceLogger::FormatStatsRow(const FString& StatName, T Min, T Max, double Average)
-{
-    return FString::Printf(
-        TEXT("%-22s | %-9.2f | %-9.2f | %-9.2f\n"),
-        *StatName, static_cast<float>(Min), static_cast<float>(Max), static_cast<float>(Average)
-    );
-}
-
-template <typename T>
-void FPerformanceLogger::CalculateStats(const std::vector<T>& data, T& outMin, T& outMax, double& outAverage) const
-{
-    std::vector<T> sortedData = data;
-    std::sort(sortedData.begin(), sortedData.end());
-
-    size_t trimCount = static_cast<size_t>(sortedData.size() * m_OutlierPercentage);
-    double sum = 0.0;
-    size_t count = 0;
-
-    for (size_t i = trimCount; i < sortedData.size() - trimCount; ++i)
-    {
-        sum += sortedData[i];
-        ++count;
-    }
-    
-    auto minMax = std::minmax_element(sortedData.begin(), sortedData.end());
-    outMin = *minMax.first;
-    outMax = *minMax.second;
-
-    outAverage = (count > 0) ? (sum / count) : 0.0;
-}
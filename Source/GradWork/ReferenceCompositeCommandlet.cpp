@@ -0,0 +1,211 @@
+#include "ReferenceCompositeCommandlet.h"
+
+#include "DepthComplexityGenerator.h"
+#include "GWPlayerController.h"
+#include "ImageQuality.h"
+#include "ReferenceCompositor.h"
+#include "SignificanceTests.h"
+#include "HAL/FileManager.h"
+#include <fstream>
+
+namespace
+{
+	FQualityImage ToQualityImage(const FCompositeImage& image)
+	{
+		const TArray<FColor> colors = ReferenceCompositor::ToSRGB(image);
+
+		FQualityImage qualityImage;
+		qualityImage.width = image.width;
+		qualityImage.height = image.height;
+		for (TArray<float>& channel : qualityImage.channels)
+		{
+			channel.SetNumUninitialized(colors.Num());
+		}
+		for (int32 i = 0; i < colors.Num(); ++i)
+		{
+			qualityImage.channels[0][i] = colors[i].R / 255.f;
+			qualityImage.channels[1][i] = colors[i].G / 255.f;
+			qualityImage.channels[2][i] = colors[i].B / 255.f;
+		}
+		return qualityImage;
+	}
+
+	// -position=<n> views from the player controller's fixed position, -CameraLocation= and -CameraRotation= override it
+	bool ParseCamera(const TCHAR* params, FCompositeSettings& outSettings)
+	{
+		int32 position = INDEX_NONE;
+		if (FParse::Value(params, TEXT("position="), position))
+		{
+			const UClass* pControllerClass = LoadClass<AGWPlayerController>(nullptr, TEXT("/Game/BP_GWPlayerController.BP_GWPlayerController_C"));
+			const AGWPlayerController* pController = pControllerClass ? pControllerClass->GetDefaultObject<AGWPlayerController>() : nullptr;
+			if (!pController || !pController->GetPositions().IsValidIndex(position))
+			{
+				UE_LOG(LogTemp, Error, TEXT("The player controller has no position %d."), position);
+				return false;
+			}
+
+			// The pawn's camera sits at the pawn's origin
+			const FTransform& transform = pController->GetPositions()[position];
+			outSettings.viewLocation = transform.GetLocation();
+			outSettings.viewRotation = transform.Rotator();
+		}
+
+		FString location;
+		if (FParse::Value(params, TEXT("CameraLocation="), location) && !outSettings.viewLocation.InitFromString(location))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Invalid camera location '%s', expected X=.. Y=.. Z=.."), *location);
+			return false;
+		}
+		FString rotation;
+		if (FParse::Value(params, TEXT("CameraRotation="), rotation) && !outSettings.viewRotation.InitFromString(rotation))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Invalid camera rotation '%s', expected P=.. Y=.. R=.."), *rotation);
+			return false;
+		}
+		FParse::Value(params, TEXT("fov="), outSettings.horizontalFov);
+		outSettings.horizontalFov = FMath::Clamp(outSettings.horizontalFov, 1.f, 170.f);
+		return true;
+	}
+
+	FString FormatQuality(const FImageQualityResult& quality)
+	{
+		return quality.bIsValid
+			? FString::Printf(TEXT("%-9.2f | %-7.4f | %-7.4f"), quality.psnr, quality.ssim, quality.flip)
+			: FString(TEXT("-         | -       | -      "));
+	}
+}
+
+UReferenceCompositeCommandlet::UReferenceCompositeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UReferenceCompositeCommandlet::Main(const FString& Params)
+{
+	FDepthComplexityParams params;
+	DepthComplexity::ParseCommandLine(*Params, params);
+
+	FCompositeSettings settings;
+	int32 numIterations = 5;
+	FParse::Value(*Params, TEXT("width="), settings.width);
+	FParse::Value(*Params, TEXT("height="), settings.height);
+	FParse::Value(*Params, TEXT("opacity="), settings.opacity);
+	FParse::Value(*Params, TEXT("k="), settings.kBufferLayers);
+	FParse::Value(*Params, TEXT("nodes="), settings.linkedListNodesPerPixel);
+	FParse::Value(*Params, TEXT("iterations="), numIterations);
+	numIterations = FMath::Max(1, numIterations);
+	if (!ParseCamera(*Params, settings))
+		return 1;
+
+	// A capture is only comparable at its own resolution
+	FString capturePath;
+	FQualityImage capture;
+	if (FParse::Value(*Params, TEXT("capture="), capturePath))
+	{
+		if (!ImageQuality::LoadImage(capturePath, capture))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Could not read capture %s."), *capturePath);
+			return 1;
+		}
+		settings.width = capture.width;
+		settings.height = capture.height;
+	}
+	settings.width = FMath::Max(1, settings.width);
+	settings.height = FMath::Max(1, settings.height);
+
+	FString outputDirectory = FPaths::ProjectDir() / TEXT("PerformanceLogs") / TEXT("ReferenceComposite");
+	FParse::Value(*Params, TEXT("out="), outputDirectory);
+	IFileManager::Get().MakeDirectory(*outputDirectory, true);
+
+	// The layout the level spawns, whichever camera it is viewed from
+	const FDepthComplexityLayout layout = DepthComplexity::Generate(params);
+
+	// Every stage is repeated and the median is reported, the first iteration warms the caches like any other
+	FFragmentBuffer buffer;
+	TArray<double> rasterTimes;
+	TArray<double> compositeTimes[static_cast<int32>(ECompositeMethod::Count)];
+	FCompositeImage images[static_cast<int32>(ECompositeMethod::Count)];
+	int64 numDropped[static_cast<int32>(ECompositeMethod::Count)] = {};
+	for (int32 iteration = 0; iteration < numIterations; ++iteration)
+	{
+		const double rasterStartTime = FPlatformTime::Seconds();
+		ReferenceCompositor::Rasterize(layout, settings, buffer);
+		rasterTimes.Add((FPlatformTime::Seconds() - rasterStartTime) * 1000.0);
+
+		for (int32 method = 0; method < static_cast<int32>(ECompositeMethod::Count); ++method)
+		{
+			const double startTime = FPlatformTime::Seconds();
+			numDropped[method] = ReferenceCompositor::Composite(buffer, static_cast<ECompositeMethod>(method), settings, images[method]);
+			compositeTimes[method].Add((FPlatformTime::Seconds() - startTime) * 1000.0);
+		}
+	}
+
+	const int32 numPixels = settings.width * settings.height;
+	const double rasterTime = SignificanceTests::Median(rasterTimes);
+	FString report = FString::Printf(TEXT("Cubes: %s\nCamera %s, %s, %.0f degrees\n"),
+		*params.ToString(), *settings.viewLocation.ToString(), *settings.viewRotation.ToString(), settings.horizontalFov);
+	report += FString::Printf(TEXT("Resolution %dx%d, opacity %.2f, k %d, %d linked list nodes per pixel, %d iterations\n"),
+		settings.width, settings.height, settings.opacity, settings.kBufferLayers, settings.linkedListNodesPerPixel, numIterations);
+	report += FString::Printf(TEXT("Fragments: %lld, %.2f per covered pixel, %.1f%% coverage, %d max per pixel, %d cubes clipped by the near plane\n"),
+		buffer.numFragments, buffer.numCoveredPixels > 0 ? static_cast<double>(buffer.numFragments) / buffer.numCoveredPixels : 0.0,
+		100.0 * buffer.numCoveredPixels / numPixels, buffer.maxFragmentsPerPixel, buffer.numClippedCubes);
+	report += FString::Printf(TEXT("Layers estimated by the generator: %.2f average, %.2f max\n"), layout.estimatedAverageLayers, layout.estimatedMaxLayers);
+	report += FString::Printf(TEXT("Rasterize: %.2f ms, %.1f M fragments/s\n\n"), rasterTime, rasterTime > 0.0 ? buffer.numFragments / (rasterTime * 1000.0) : 0.0);
+
+	report += TEXT("Method           | Time ms   | M frag/s  | Dropped    | PSNR      | SSIM    | FLIP\n");
+	report += TEXT("-------------------------------------------------------------------------------------------\n");
+
+	const FQualityImage reference = ToQualityImage(images[static_cast<int32>(ECompositeMethod::Sorted)]);
+	bool bIsWritten = true;
+	for (int32 method = 0; method < static_cast<int32>(ECompositeMethod::Count); ++method)
+	{
+		const TCHAR* name = GetCompositeMethodName(static_cast<ECompositeMethod>(method));
+		const double time = SignificanceTests::Median(compositeTimes[method]);
+
+		FImageQualityResult quality;
+		ImageQuality::Compare(reference, ToQualityImage(images[method]), quality);
+
+		report += FString::Printf(TEXT("%-16s | %-9.2f | %-9.1f | %-10lld | %s\n"),
+			name, time, time > 0.0 ? buffer.numFragments / (time * 1000.0) : 0.0, numDropped[method], *FormatQuality(quality));
+		bIsWritten &= ReferenceCompositor::WriteImage(outputDirectory / FString(name) + TEXT(".png"), images[method]);
+	}
+
+	// Normalized to the busiest pixel, the report has the absolute maximum
+	const TArray<int32> fragmentCounts = ReferenceCompositor::GetFragmentCounts(buffer);
+	TArray<float> fragmentMap;
+	fragmentMap.SetNumUninitialized(fragmentCounts.Num());
+	for (int32 i = 0; i < fragmentCounts.Num(); ++i)
+	{
+		fragmentMap[i] = buffer.maxFragmentsPerPixel > 0 ? static_cast<float>(fragmentCounts[i]) / buffer.maxFragmentsPerPixel : 0.f;
+	}
+	bIsWritten &= ImageQuality::WriteHeatmap(outputDirectory / TEXT("Fragments.png"), fragmentMap, settings.width, settings.height);
+
+	if (!capturePath.IsEmpty())
+	{
+		FImageQualityResult quality;
+		ImageQuality::Compare(reference, capture, quality);
+		report += FString::Printf(TEXT("\nCapture %s against Sorted: %s\n"), *capturePath, *FormatQuality(quality));
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("\n%s"), *report);
+
+	std::ofstream file(TCHAR_TO_UTF8(*(outputDirectory / TEXT("Report.txt"))));
+	if (file.is_open())
+	{
+		file << TCHAR_TO_UTF8(*report);
+	}
+	else
+	{
+		bIsWritten = false;
+	}
+
+	if (!bIsWritten)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Could not write every output to %s."), *outputDirectory);
+		return 1;
+	}
+	return 0;
+}
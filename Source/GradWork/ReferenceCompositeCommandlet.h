@@ -0,0 +1,28 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ReferenceCompositeCommandlet.generated.h"
+
+/**
+ * Renders the transparency scene on the CPU and writes reference images, so a machine without a GPU can check the
+ * compositing algorithms and time them.
+ * Usage: -run=ReferenceComposite [-CubeCount=<n> -CubeSeed=<n> -CubeLayers=<avg> -CubeMaxLayers=<max> -CubeCoverage=<0-1>]
+ *        [-width=1280] [-height=720] [-opacity=0.5] [-k=8] [-nodes=4] [-iterations=5] [-out=<directory>] [-capture=<png>]
+ *        [-position=<n>] [-CameraLocation="X=0 Y=0 Z=0"] [-CameraRotation="P=0 Y=0 R=0"] [-fov=90]
+ * The camera is the origin looking down +X, the view the level spawns the cubes for, unless a position of the player
+ * controller or a location and rotation are given.
+ * Writes the image of every method, a fragment count heatmap and a report with the median times and the quality of
+ * every approximation against the sorted image. A GPU capture of the same scene, taken without tonemapping, is compared
+ * against the sorted image as well and sets the resolution.
+ */
+UCLASS()
+class GRADWORK_API UReferenceCompositeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UReferenceCompositeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,450 @@
+#include "ReferenceCompositor.h"
+
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include "DepthComplexityGenerator.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+
+namespace
+{
+	// Half the edge length of /Engine/BasicShapes/Cube at scale 1
+	constexpr float CubeHalfEdge = 50.f;
+	// The default near clip plane
+	constexpr float NearPlane = 10.f;
+
+	// Screen rectangle of one cube, and the camera in the cube's frame, where the cube is the box from -1 to 1
+	struct FCubeBounds
+	{
+		FVector3f origin;
+		// The view axes in the cube's frame, a pixel's ray goes along forward + column slope * right + row slope * up
+		FVector3f forward;
+		FVector3f right;
+		FVector3f up;
+		FIntRect pixels;
+		bool bIsVisible;
+		bool bIsClipped;
+	};
+
+	// Draw order breaks ties, so fragments at the same depth always blend the same way
+	bool IsCloser(const FCompositeFragment& a, const FCompositeFragment& b)
+	{
+		return a.depth < b.depth || (a.depth == b.depth && a.cube < b.cube);
+	}
+
+	FCubeBounds GetCubeBounds(const FTransform& transform, const FVector& viewLocation, const FQuat& viewRotation, const int32 width, const int32 height,
+		const float tanHalfWidth, const float tanHalfHeight)
+	{
+		const FQuat rotation = transform.GetRotation();
+		const FVector halfExtent = transform.GetScale3D() * CubeHalfEdge;
+		const FVector center = transform.GetLocation();
+
+		// Scaling to the unit box keeps the distance along a ray, so entry depths stay in world units
+		const auto toCube = [&rotation, &halfExtent](const FVector& vector) { return FVector3f(rotation.UnrotateVector(vector) / halfExtent); };
+
+		FCubeBounds bounds;
+		bounds.origin = toCube(viewLocation - center);
+		bounds.forward = toCube(viewRotation.GetForwardVector());
+		bounds.right = toCube(viewRotation.GetRightVector());
+		bounds.up = toCube(viewRotation.GetUpVector());
+
+		FVector viewCorners[8];
+		double minDepth = UE_DOUBLE_BIG_NUMBER;
+		double maxDepth = -UE_DOUBLE_BIG_NUMBER;
+		for (int32 corner = 0; corner < 8; ++corner)
+		{
+			const FVector offset(corner & 1 ? 1.0 : -1.0, corner & 2 ? 1.0 : -1.0, corner & 4 ? 1.0 : -1.0);
+			viewCorners[corner] = viewRotation.UnrotateVector(center + rotation.RotateVector(offset * halfExtent) - viewLocation);
+			minDepth = FMath::Min(minDepth, viewCorners[corner].X);
+			maxDepth = FMath::Max(maxDepth, viewCorners[corner].X);
+		}
+
+		// Behind the camera it is simply not in view, reaching through the near plane it is left out like on the GPU
+		bounds.bIsVisible = minDepth > NearPlane;
+		bounds.bIsClipped = !bounds.bIsVisible && maxDepth > NearPlane;
+		if (!bounds.bIsVisible)
+			return bounds;
+
+		// The box is in front of the camera, so its projection is bounded by the projected corners
+		float minX = UE_MAX_FLT;
+		float minY = UE_MAX_FLT;
+		float maxX = -UE_MAX_FLT;
+		float maxY = -UE_MAX_FLT;
+		for (const FVector& viewCorner : viewCorners)
+		{
+			const float screenX = static_cast<float>((viewCorner.Y / viewCorner.X / tanHalfWidth * 0.5 + 0.5) * width);
+			const float screenY = static_cast<float>((0.5 - viewCorner.Z / viewCorner.X / tanHalfHeight * 0.5) * height);
+			minX = FMath::Min(minX, screenX);
+			maxX = FMath::Max(maxX, screenX);
+			minY = FMath::Min(minY, screenY);
+			maxY = FMath::Max(maxY, screenY);
+		}
+
+		// Inclusive and one pixel wider than needed, the slab test decides which pixels are covered
+		bounds.pixels.Min = FIntPoint(FMath::Max(0, FMath::FloorToInt32(minX) - 1), FMath::Max(0, FMath::FloorToInt32(minY) - 1));
+		bounds.pixels.Max = FIntPoint(FMath::Min(width - 1, FMath::FloorToInt32(maxX) + 1), FMath::Min(height - 1, FMath::FloorToInt32(maxY) + 1));
+		bounds.bIsVisible = bounds.pixels.Min.X <= bounds.pixels.Max.X && bounds.pixels.Min.Y <= bounds.pixels.Max.Y;
+		return bounds;
+	}
+
+	// Entry and exit of the rays along one axis of the cube, a direction of exactly 0 would divide 0 by 0
+	void IntersectSlab(const VectorRegister4Float& origin, const VectorRegister4Float& directions, VectorRegister4Float& inOutEntries, VectorRegister4Float& inOutExits)
+	{
+		const VectorRegister4Float smallNumber = VectorSetFloat1(UE_SMALL_NUMBER);
+		const VectorRegister4Float safeDirections = VectorSelect(VectorCompareLT(VectorAbs(directions), smallNumber), smallNumber, directions);
+		const VectorRegister4Float inverseDirections = VectorDivide(VectorOneFloat(), safeDirections);
+		const VectorRegister4Float nearSide = VectorMultiply(VectorSubtract(VectorNegate(VectorOneFloat()), origin), inverseDirections);
+		const VectorRegister4Float farSide = VectorMultiply(VectorSubtract(VectorOneFloat(), origin), inverseDirections);
+		inOutEntries = VectorMax(inOutEntries, VectorMin(nearSide, farSide));
+		inOutExits = VectorMin(inOutExits, VectorMax(nearSide, farSide));
+	}
+
+	// Every cube tested against every pixel of its span in one tile row, four pixels per iteration.
+	// A pixel is covered when its ray enters the box before it leaves, the entry is the depth of the front face
+	void RasterizeCube(const FCubeBounds& bounds, const int32 cube, const FCompositeTile& tile, const float* pColumnSlopes,
+		const float* pRowSlopes, TArray<int32>& outPixels, TArray<FCompositeFragment>& outFragments)
+	{
+		const int32 firstX = FMath::Max(bounds.pixels.Min.X, tile.x);
+		const int32 lastX = FMath::Min(bounds.pixels.Max.X, tile.x + tile.width - 1);
+		const int32 firstY = FMath::Max(bounds.pixels.Min.Y, tile.y);
+		const int32 lastY = FMath::Min(bounds.pixels.Max.Y, tile.y + tile.height - 1);
+
+		const VectorRegister4Float originX = VectorSetFloat1(bounds.origin.X);
+		const VectorRegister4Float originY = VectorSetFloat1(bounds.origin.Y);
+		const VectorRegister4Float originZ = VectorSetFloat1(bounds.origin.Z);
+		const VectorRegister4Float rightX = VectorSetFloat1(bounds.right.X);
+		const VectorRegister4Float rightY = VectorSetFloat1(bounds.right.Y);
+		const VectorRegister4Float rightZ = VectorSetFloat1(bounds.right.Z);
+		// Visible cubes lie past the near plane, the camera is outside of them and entries start at 0
+		const VectorRegister4Float zero = VectorZeroFloat();
+		const VectorRegister4Float infinity = VectorSetFloat1(UE_MAX_FLT);
+		alignas(16) float entries[4];
+
+		for (int32 y = firstY; y <= lastY; ++y)
+		{
+			// The part of the direction the row slope sets is the same for the whole span
+			const FVector3f rowDirection = bounds.forward + bounds.up * pRowSlopes[y];
+			const VectorRegister4Float rowX = VectorSetFloat1(rowDirection.X);
+			const VectorRegister4Float rowY = VectorSetFloat1(rowDirection.Y);
+			const VectorRegister4Float rowZ = VectorSetFloat1(rowDirection.Z);
+
+			for (int32 x = firstX; x <= lastX; x += 4)
+			{
+				const VectorRegister4Float slopes = VectorLoad(pColumnSlopes + x);
+				VectorRegister4Float pixelEntries = zero;
+				VectorRegister4Float pixelExits = infinity;
+				IntersectSlab(originX, VectorMultiplyAdd(rightX, slopes, rowX), pixelEntries, pixelExits);
+				IntersectSlab(originY, VectorMultiplyAdd(rightY, slopes, rowY), pixelEntries, pixelExits);
+				IntersectSlab(originZ, VectorMultiplyAdd(rightZ, slopes, rowZ), pixelEntries, pixelExits);
+
+				// Lanes past the end of the span are masked out
+				const uint32 laneMask = (1u << FMath::Min(4, lastX - x + 1)) - 1u;
+				uint32 hits = static_cast<uint32>(VectorMaskBits(VectorCompareGE(pixelExits, pixelEntries))) & laneMask;
+				if (hits == 0)
+					continue;
+
+				VectorStoreAligned(pixelEntries, entries);
+				while (hits != 0)
+				{
+					const int32 lane = static_cast<int32>(FMath::CountTrailingZeros(hits));
+					hits &= hits - 1u;
+					outPixels.Add((y - tile.y) * tile.width + x + lane - tile.x);
+					outFragments.Add({ entries[lane], cube });
+				}
+			}
+		}
+	}
+
+	FLinearColor BlendFrontToBack(TConstArrayView<FCompositeFragment> sortedFragments, const TArray<FLinearColor>& colors, const float opacity, const FLinearColor& behind)
+	{
+		FLinearColor color(0.f, 0.f, 0.f, 0.f);
+		float transmittance = 1.f;
+		for (const FCompositeFragment& fragment : sortedFragments)
+		{
+			color += colors[fragment.cube] * (transmittance * opacity);
+			transmittance *= 1.f - opacity;
+		}
+		return color + behind * transmittance;
+	}
+
+	// McGuire and Bavoil, equation 7 with the depth in meters
+	FLinearColor BlendWeighted(TConstArrayView<FCompositeFragment> fragments, const TArray<FLinearColor>& colors, const float opacity, const FLinearColor& background)
+	{
+		FLinearColor accumulated(0.f, 0.f, 0.f, 0.f);
+		float accumulatedAlpha = 0.f;
+		float revealage = 1.f;
+		for (const FCompositeFragment& fragment : fragments)
+		{
+			const float depth = fragment.depth * 0.01f;
+			const float weight = opacity * FMath::Clamp(10.f / (1e-5f + FMath::Square(depth / 5.f) + FMath::Pow(depth / 200.f, 6.f)), 1e-2f, 3e3f);
+			accumulated += colors[fragment.cube] * (opacity * weight);
+			accumulatedAlpha += opacity * weight;
+			revealage *= 1.f - opacity;
+		}
+		return accumulated / FMath::Max(accumulatedAlpha, 1e-5f) * (1.f - revealage) + background * revealage;
+	}
+
+	// The closest fragments stay sorted in scratch, everything behind them is blended over the background in draw order
+	FLinearColor BlendKBuffer(TConstArrayView<FCompositeFragment> fragments, const TArray<FLinearColor>& colors, const float opacity,
+		const FLinearColor& background, const int32 numLayers, TArray<FCompositeFragment>& scratch)
+	{
+		scratch.Reset();
+		FLinearColor tail = background;
+		for (const FCompositeFragment& fragment : fragments)
+		{
+			const FCompositeFragment* pTail = &fragment;
+			FCompositeFragment evicted{};
+			if (scratch.Num() < numLayers || IsCloser(fragment, scratch.Last()))
+			{
+				if (scratch.Num() == numLayers)
+				{
+					evicted = scratch.Pop(EAllowShrinking::No);
+					pTail = &evicted;
+				}
+				else
+				{
+					pTail = nullptr;
+				}
+				scratch.Insert(fragment, Algo::UpperBound(scratch, fragment, IsCloser));
+			}
+
+			if (pTail)
+			{
+				tail = colors[pTail->cube] * opacity + tail * (1.f - opacity);
+			}
+		}
+		return BlendFrontToBack(scratch, colors, opacity, tail);
+	}
+}
+
+void ReferenceCompositor::Rasterize(const FDepthComplexityLayout& layout, const FCompositeSettings& settings, FFragmentBuffer& outBuffer)
+{
+	const int32 width = FMath::Max(1, settings.width);
+	const int32 height = FMath::Max(1, settings.height);
+	const float tanHalfWidth = FMath::Tan(FMath::DegreesToRadians(settings.horizontalFov * 0.5f));
+	const float tanHalfHeight = tanHalfWidth * height / width;
+
+	outBuffer = FFragmentBuffer();
+	outBuffer.width = width;
+	outBuffer.height = height;
+	outBuffer.colors = layout.colors;
+
+	// Ray direction through every pixel center is (1, column slope, row slope) in view space, padded so a span can always
+	// load four columns
+	TArray<float> columnSlopes;
+	TArray<float> rowSlopes;
+	columnSlopes.SetNumUninitialized(width + 4);
+	rowSlopes.SetNumUninitialized(height);
+	for (int32 x = 0; x < columnSlopes.Num(); ++x)
+	{
+		columnSlopes[x] = x < width ? ((x + 0.5f) / width * 2.f - 1.f) * tanHalfWidth : 0.f;
+	}
+	for (int32 y = 0; y < height; ++y)
+	{
+		rowSlopes[y] = (1.f - (y + 0.5f) / height * 2.f) * tanHalfHeight;
+	}
+	const FQuat viewRotation = settings.viewRotation.Quaternion();
+
+	const int32 numCubes = layout.transforms.Num();
+	TArray<FCubeBounds> bounds;
+	bounds.SetNumUninitialized(numCubes);
+	ParallelFor(numCubes, [&](const int32 cube)
+	{
+		bounds[cube] = GetCubeBounds(layout.transforms[cube], settings.viewLocation, viewRotation, width, height, tanHalfWidth, tanHalfHeight);
+	});
+
+	outBuffer.numTilesX = FMath::DivideAndRoundUp(width, TileSize);
+	const int32 numTilesY = FMath::DivideAndRoundUp(height, TileSize);
+	outBuffer.tiles.SetNum(outBuffer.numTilesX * numTilesY);
+	for (int32 i = 0; i < outBuffer.tiles.Num(); ++i)
+	{
+		FCompositeTile& tile = outBuffer.tiles[i];
+		tile.x = i % outBuffer.numTilesX * TileSize;
+		tile.y = i / outBuffer.numTilesX * TileSize;
+		tile.width = FMath::Min(TileSize, width - tile.x);
+		tile.height = FMath::Min(TileSize, height - tile.y);
+	}
+
+	// Binned in draw order, so every tile sees its cubes in the order the GPU would draw them
+	TArray<TArray<int32>> tileCubes;
+	tileCubes.SetNum(outBuffer.tiles.Num());
+	for (int32 cube = 0; cube < numCubes; ++cube)
+	{
+		if (!bounds[cube].bIsVisible)
+		{
+			outBuffer.numClippedCubes += bounds[cube].bIsClipped ? 1 : 0;
+			continue;
+		}
+
+		const FIntRect& pixels = bounds[cube].pixels;
+		for (int32 tileY = pixels.Min.Y / TileSize; tileY <= pixels.Max.Y / TileSize; ++tileY)
+		{
+			for (int32 tileX = pixels.Min.X / TileSize; tileX <= pixels.Max.X / TileSize; ++tileX)
+			{
+				tileCubes[tileY * outBuffer.numTilesX + tileX].Add(cube);
+			}
+		}
+	}
+
+	outBuffer.fragmentsPerCube.SetNumZeroed(numCubes);
+	TArray<int32> numCoveredPixels;
+	TArray<int32> maxFragments;
+	numCoveredPixels.SetNumZeroed(outBuffer.tiles.Num());
+	maxFragments.SetNumZeroed(outBuffer.tiles.Num());
+
+	ParallelFor(outBuffer.tiles.Num(), [&](const int32 i)
+	{
+		FCompositeTile& tile = outBuffer.tiles[i];
+		TArray<int32> pixels;
+		TArray<FCompositeFragment> fragments;
+		for (const int32 cube : tileCubes[i])
+		{
+			const int32 numBefore = fragments.Num();
+			RasterizeCube(bounds[cube], cube, tile, columnSlopes.GetData(), rowSlopes.GetData(), pixels, fragments);
+			if (fragments.Num() > numBefore)
+			{
+				FPlatformAtomics::InterlockedAdd(&outBuffer.fragmentsPerCube[cube], fragments.Num() - numBefore);
+			}
+		}
+
+		// Counting sort by pixel, stable so the fragments of a pixel stay in draw order
+		const int32 numPixels = tile.width * tile.height;
+		tile.offsets.SetNumZeroed(numPixels + 1);
+		for (const int32 pixel : pixels)
+		{
+			++tile.offsets[pixel + 1];
+		}
+		for (int32 pixel = 0; pixel < numPixels; ++pixel)
+		{
+			numCoveredPixels[i] += tile.offsets[pixel + 1] > 0 ? 1 : 0;
+			maxFragments[i] = FMath::Max(maxFragments[i], tile.offsets[pixel + 1]);
+			tile.offsets[pixel + 1] += tile.offsets[pixel];
+		}
+
+		TArray<int32> cursors(tile.offsets.GetData(), numPixels);
+		tile.fragments.SetNumUninitialized(fragments.Num());
+		for (int32 fragment = 0; fragment < fragments.Num(); ++fragment)
+		{
+			tile.fragments[cursors[pixels[fragment]]++] = fragments[fragment];
+		}
+	});
+
+	for (int32 i = 0; i < outBuffer.tiles.Num(); ++i)
+	{
+		outBuffer.numFragments += outBuffer.tiles[i].fragments.Num();
+		outBuffer.numCoveredPixels += numCoveredPixels[i];
+		outBuffer.maxFragmentsPerPixel = FMath::Max(outBuffer.maxFragmentsPerPixel, maxFragments[i]);
+	}
+}
+
+int64 ReferenceCompositor::Composite(const FFragmentBuffer& buffer, const ECompositeMethod method, const FCompositeSettings& settings, FCompositeImage& outImage)
+{
+	outImage.width = buffer.width;
+	outImage.height = buffer.height;
+	outImage.pixels.SetNumUninitialized(buffer.width * buffer.height);
+
+	// The GPU hands out nodes while it draws, so the pool runs out during some draw and every later cube is lost.
+	// Which pixels of that one draw still get a node depends on scheduling, the reference drops the whole draw
+	int32 firstDroppedCube = buffer.fragmentsPerCube.Num();
+	int64 numDropped = 0;
+	if (method == ECompositeMethod::LinkedList)
+	{
+		const int64 poolSize = static_cast<int64>(FMath::Max(0, settings.linkedListNodesPerPixel)) * buffer.width * buffer.height;
+		int64 numAllocated = 0;
+		for (int32 cube = 0; cube < buffer.fragmentsPerCube.Num(); ++cube)
+		{
+			if (numAllocated + buffer.fragmentsPerCube[cube] > poolSize)
+			{
+				firstDroppedCube = cube;
+				break;
+			}
+			numAllocated += buffer.fragmentsPerCube[cube];
+		}
+		numDropped = buffer.numFragments - numAllocated;
+	}
+
+	const float opacity = FMath::Clamp(settings.opacity, 0.f, 1.f);
+	const int32 numLayers = FMath::Max(1, settings.kBufferLayers);
+	ParallelFor(buffer.tiles.Num(), [&](const int32 i)
+	{
+		const FCompositeTile& tile = buffer.tiles[i];
+		TArray<FCompositeFragment> scratch;
+		for (int32 y = 0; y < tile.height; ++y)
+		{
+			for (int32 x = 0; x < tile.width; ++x)
+			{
+				const int32 pixel = y * tile.width + x;
+				const TConstArrayView<FCompositeFragment> fragments(tile.fragments.GetData() + tile.offsets[pixel], tile.offsets[pixel + 1] - tile.offsets[pixel]);
+
+				FLinearColor color;
+				switch (method)
+				{
+				case ECompositeMethod::WeightedBlended:
+					color = BlendWeighted(fragments, buffer.colors, opacity, settings.background);
+					break;
+				case ECompositeMethod::KBuffer:
+					color = BlendKBuffer(fragments, buffer.colors, opacity, settings.background, numLayers, scratch);
+					break;
+				default:
+					scratch.Reset();
+					for (const FCompositeFragment& fragment : fragments)
+					{
+						if (fragment.cube < firstDroppedCube)
+							scratch.Add(fragment);
+					}
+					Algo::Sort(scratch, IsCloser);
+					color = BlendFrontToBack(scratch, buffer.colors, opacity, settings.background);
+					break;
+				}
+
+				color.A = 1.f;
+				outImage.pixels[(tile.y + y) * buffer.width + tile.x + x] = color;
+			}
+		}
+	});
+
+	return numDropped;
+}
+
+TArray<int32> ReferenceCompositor::GetFragmentCounts(const FFragmentBuffer& buffer)
+{
+	TArray<int32> counts;
+	counts.SetNumZeroed(buffer.width * buffer.height);
+	ParallelFor(buffer.tiles.Num(), [&](const int32 i)
+	{
+		const FCompositeTile& tile = buffer.tiles[i];
+		for (int32 pixel = 0; pixel < tile.width * tile.height; ++pixel)
+		{
+			counts[(tile.y + pixel / tile.width) * buffer.width + tile.x + pixel % tile.width] = tile.offsets[pixel + 1] - tile.offsets[pixel];
+		}
+	});
+	return counts;
+}
+
+TArray<FColor> ReferenceCompositor::ToSRGB(const FCompositeImage& image)
+{
+	TArray<FColor> colors;
+	colors.SetNumUninitialized(image.pixels.Num());
+	ParallelFor(image.height, [&](const int32 y)
+	{
+		for (int32 i = y * image.width; i < (y + 1) * image.width; ++i)
+		{
+			colors[i] = image.pixels[i].ToFColorSRGB();
+		}
+	});
+	return colors;
+}
+
+bool ReferenceCompositor::WriteImage(const FString& filePath, const FCompositeImage& image)
+{
+	const TArray<FColor> colors = ToSRGB(image);
+
+	IImageWrapperModule& imageWrapperModule = FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+	const TSharedPtr<IImageWrapper> pImageWrapper = imageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+	if (!pImageWrapper || !pImageWrapper->SetRaw(colors.GetData(), colors.Num() * sizeof(FColor), image.width, image.height, ERGBFormat::BGRA, 8))
+		return false;
+
+	return FFileHelper::SaveArrayToFile(pImageWrapper->GetCompressed(), *filePath);
+}
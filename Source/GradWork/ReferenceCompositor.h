@@ -0,0 +1,114 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FDepthComplexityLayout;
+
+// How the fragments of a pixel are blended, Sorted is the ground truth the others are measured against
+enum class ECompositeMethod : uint8
+{
+	Sorted,
+	// Weighted blended OIT, one accumulation and one revealage value per pixel
+	WeightedBlended,
+	// The closest k fragments in order, the rest blended behind them in draw order
+	KBuffer,
+	// Per-pixel lists from a fixed node pool, fragments that find no free node are lost
+	LinkedList,
+	Count
+};
+
+inline const TCHAR* GetCompositeMethodName(const ECompositeMethod method)
+{
+	switch (method)
+	{
+	case ECompositeMethod::Sorted:			return TEXT("Sorted");
+	case ECompositeMethod::WeightedBlended:	return TEXT("WeightedBlended");
+	case ECompositeMethod::KBuffer:			return TEXT("KBuffer");
+	case ECompositeMethod::LinkedList:		return TEXT("LinkedList");
+	default:								return TEXT("Unknown");
+	}
+}
+
+struct FCompositeSettings
+{
+	int32 width{ 1280 };
+	int32 height{ 720 };
+	// The level spawns the cubes for the origin looking down +X
+	FVector viewLocation{ FVector::ZeroVector };
+	FRotator viewRotation{ FRotator::ZeroRotator };
+	float horizontalFov{ 90.f };
+	// Every cube has the same opacity, the translucent material only varies the color
+	float opacity{ 0.5f };
+	int32 kBufferLayers{ 8 };
+	// Size of the linked list node pool, in nodes per pixel of the screen
+	int32 linkedListNodesPerPixel{ 4 };
+	FLinearColor background{ FLinearColor::Black };
+};
+
+struct FCompositeFragment
+{
+	// Along the view direction, in world units
+	float depth;
+	int32 cube;
+};
+
+// Fragments of one screen tile, per pixel in row-major order and per pixel in draw order
+struct FCompositeTile
+{
+	int32 x;
+	int32 y;
+	int32 width;
+	int32 height;
+	// width * height + 1 entries, the fragments of pixel i are [offsets[i], offsets[i + 1])
+	TArray<int32> offsets;
+	TArray<FCompositeFragment> fragments;
+};
+
+// Every front face fragment of a frame, what a GPU would shade before blending
+struct FFragmentBuffer
+{
+	int32 width{ 0 };
+	int32 height{ 0 };
+	int32 numTilesX{ 0 };
+	TArray<FCompositeTile> tiles;
+	TArray<FLinearColor> colors;
+	// Per cube, the linked list hands out its nodes in this order
+	TArray<int32> fragmentsPerCube;
+	int64 numFragments{ 0 };
+	int32 numCoveredPixels{ 0 };
+	int32 maxFragmentsPerPixel{ 0 };
+	// Cubes that reach through the near plane and are left out, the generator never places any for the default camera
+	int32 numClippedCubes{ 0 };
+};
+
+struct FCompositeImage
+{
+	int32 width{ 0 };
+	int32 height{ 0 };
+	TArray<FLinearColor> pixels;
+};
+
+/**
+ * CPU reference for the transparency scenes, so correctness and the cost of the compositing algorithms can be checked
+ * on machines without a GPU. The cubes of a depth complexity layout are rasterized from the settings' camera into
+ * per-pixel fragment lists: every pixel's world space ray is moved into the frame of the cube and tested against it as
+ * an oriented box. Tiles run in parallel and every row of a cube is tested four pixels at a time with SIMD registers.
+ * The same fragments are then blended exactly and with the OIT approximations.
+ * Results only depend on the layout and settings, never on scheduling.
+ */
+namespace ReferenceCompositor
+{
+	constexpr int32 TileSize = 32;
+
+	void Rasterize(const FDepthComplexityLayout& layout, const FCompositeSettings& settings, FFragmentBuffer& outBuffer);
+
+	// Returns the fragments the method lost, only the linked list drops fragments
+	int64 Composite(const FFragmentBuffer& buffer, ECompositeMethod method, const FCompositeSettings& settings, FCompositeImage& outImage);
+
+	// Fragments per pixel, one value per pixel in row-major order
+	TArray<int32> GetFragmentCounts(const FFragmentBuffer& buffer);
+
+	// Clamped and converted to sRGB, like a capture without tonemapping
+	TArray<FColor> ToSRGB(const FCompositeImage& image);
+	bool WriteImage(const FString& filePath, const FCompositeImage& image);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+// Buckets the RHI resources are summed into, Total includes the other buckets and everything else
+enum class EResourceMemory : uint8
+{
+	RenderTargets,
+	OIT,
+	RayTracing,
+	Total,
+	Count
+};
+
+struct FRenderStatsSample
+{
+	int32 drawCalls;
+	int32 primitivesDrawn;
+	// Only gathered every few frames, -1 in between
+	int64 resourceBytes[static_cast<int32>(EResourceMemory::Count)];
+};
+
+/**
+ * Lock-free single-producer/single-consumer ring of per-frame RHI counters.
+ * The render thread publishes a sample tagged with the game thread frame it belongs to,
+ * the game thread picks it up a few frames later without ever waiting on the render thread.
+ * Every slot is guarded by its frame tag (seqlock), so a slot that gets overwritten while being read is simply rejected.
+ */
+template <uint32 Capacity>
+class TRenderStatsRing
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	static constexpr uint64 InvalidFrame = ~0ull;
+
+	TRenderStatsRing()
+	{
+		for (FSlot& slot : m_Slots)
+			slot.frameTag.store(InvalidFrame, std::memory_order_relaxed);
+	}
+
+	// Render thread only
+	void Publish(const uint64 frameNumber, const FRenderStatsSample& sample)
+	{
+		FSlot& slot = m_Slots[frameNumber & (Capacity - 1)];
+
+		slot.frameTag.store(InvalidFrame, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		slot.drawCalls.store(sample.drawCalls, std::memory_order_relaxed);
+		slot.primitivesDrawn.store(sample.primitivesDrawn, std::memory_order_relaxed);
+		for (int32 i = 0; i < static_cast<int32>(EResourceMemory::Count); ++i)
+			slot.resourceBytes[i].store(sample.resourceBytes[i], std::memory_order_relaxed);
+
+		slot.frameTag.store(frameNumber, std::memory_order_release);
+	}
+
+	// Game thread only, returns false if the sample for this frame is not (or no longer) available
+	bool TryRead(const uint64 frameNumber, FRenderStatsSample& outSample) const
+	{
+		const FSlot& slot = m_Slots[frameNumber & (Capacity - 1)];
+
+		if (slot.frameTag.load(std::memory_order_acquire) != frameNumber)
+			return false;
+
+		outSample.drawCalls = slot.drawCalls.load(std::memory_order_relaxed);
+		outSample.primitivesDrawn = slot.primitivesDrawn.load(std::memory_order_relaxed);
+		for (int32 i = 0; i < static_cast<int32>(EResourceMemory::Count); ++i)
+			outSample.resourceBytes[i] = slot.resourceBytes[i].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return slot.frameTag.load(std::memory_order_relaxed) == frameNumber;
+	}
+
+private:
+	struct alignas(PLATFORM_CACHE_LINE_SIZE) FSlot
+	{
+		std::atomic<uint64> frameTag;
+		std::atomic<int32> drawCalls;
+		std::atomic<int32> primitivesDrawn;
+		std::atomic<int64> resourceBytes[static_cast<int32>(EResourceMemory::Count)];
+	};
+
+	FSlot m_Slots[Capacity];
+};
@@ -0,0 +1,269 @@
+#include "ScreenshotCapture.h"
+
+#include "Async/Async.h"
+#include "Framework/Application/SlateApplication.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Misc/FileHelper.h"
+#include "RHIGPUReadback.h"
+#include "Rendering/SlateRenderer.h"
+#include "Widgets/SWindow.h"
+
+struct FScreenshotCapture::FPendingCapture
+{
+	FString filePath;
+	uint64 targetFrame;
+	// Only compared against, never dereferenced off the game thread
+	const SWindow* pWindow;
+
+	// Render thread until the pixels are handed to the worker
+	TUniquePtr<FRHIGPUTextureReadback> pReadback;
+	FIntPoint size;
+	EPixelFormat format;
+	int32 rowPitchInPixels;
+	TArray<uint8> pixels;
+};
+
+struct FScreenshotCapture::FSharedState
+{
+	// Game thread only
+	int32 numPending{ 0 };
+	TArray<TFunction<void()>> idleCallbacks;
+};
+
+FScreenshotCapture::FScreenshotCapture()
+	: m_pSharedState(MakeShared<FSharedState, ESPMode::ThreadSafe>())
+	, m_RestoreMessagesFrame(0)
+	, m_bRestoreMessages(false)
+{
+	// Loading a module is not allowed on the worker threads that encode
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	if (FSlateApplication::IsInitialized() && FSlateApplication::Get().GetRenderer())
+	{
+		m_BackBufferReadyHandle = FSlateApplication::Get().GetRenderer()->OnBackBufferReadyToPresent().AddRaw(this, &FScreenshotCapture::OnBackBufferReady);
+	}
+	m_EndFrameHandle = FCoreDelegates::OnEndFrame.AddRaw(this, &FScreenshotCapture::OnEndFrame);
+}
+
+FScreenshotCapture::~FScreenshotCapture()
+{
+	FCoreDelegates::OnEndFrame.Remove(m_EndFrameHandle);
+
+	if (m_BackBufferReadyHandle.IsValid() && FSlateApplication::IsInitialized() && FSlateApplication::Get().GetRenderer())
+	{
+		FSlateApplication::Get().GetRenderer()->OnBackBufferReadyToPresent().Remove(m_BackBufferReadyHandle);
+	}
+
+	// The render thread may still be inside OnBackBufferReady, captures that did not reach the worker are dropped
+	FlushRenderingCommands();
+	m_RenderThreadCaptures.Reset();
+
+	if (m_bRestoreMessages)
+	{
+		GAreScreenMessagesEnabled = true;
+	}
+}
+
+FString FScreenshotCapture::Request(const FString& filePath)
+{
+	const FString pngFilePath = FPaths::GetExtension(filePath).IsEmpty() ? filePath + TEXT(".png") : filePath;
+	++m_pSharedState->numPending;
+
+	const TSharedPtr<SWindow> pWindow = GEngine && GEngine->GameViewport ? GEngine->GameViewport->GetWindow() : nullptr;
+	if (GIsEditor || !m_BackBufferReadyHandle.IsValid() || !pWindow)
+	{
+		// The back buffer of the editor holds the whole editor, the engine reads back only the viewport
+		FScreenshotRequest::RequestScreenshot(pngFilePath, false, false);
+		m_FallbackFrames.Add(GFrameCounter);
+		return pngFilePath;
+	}
+
+	// The messages are drawn into the same back buffer, leave them out of the captured frame
+	if (GAreScreenMessagesEnabled)
+	{
+		GAreScreenMessagesEnabled = false;
+		m_bRestoreMessages = true;
+	}
+	m_RestoreMessagesFrame = GFrameCounter;
+
+	const FPendingCapturePtr pCapture = MakeShared<FPendingCapture, ESPMode::ThreadSafe>();
+	pCapture->filePath = pngFilePath;
+	pCapture->targetFrame = GFrameNumber;
+	pCapture->pWindow = pWindow.Get();
+
+	ENQUEUE_RENDER_COMMAND(QueueScreenshotCapture)(
+		[this, pCapture](FRHICommandListImmediate&)
+		{
+			m_RenderThreadCaptures.Add(pCapture);
+		});
+	return pngFilePath;
+}
+
+void FScreenshotCapture::NotifyWhenIdle(TFunction<void()> onIdle)
+{
+	if (m_pSharedState->numPending == 0)
+	{
+		onIdle();
+		return;
+	}
+
+	m_pSharedState->idleCallbacks.Add(MoveTemp(onIdle));
+}
+
+int32 FScreenshotCapture::GetNumPending() const
+{
+	return m_pSharedState->numPending;
+}
+
+void FScreenshotCapture::OnBackBufferReady(SWindow& window, const FTextureRHIRef& backBuffer)
+{
+	check(IsInRenderingThread());
+	if (m_RenderThreadCaptures.IsEmpty())
+		return;
+
+	FRHICommandListImmediate& rhiCmdList = FRHICommandListImmediate::Get();
+
+	for (int32 i = m_RenderThreadCaptures.Num() - 1; i >= 0; --i)
+	{
+		const FPendingCapturePtr& pCapture = m_RenderThreadCaptures[i];
+
+		if (!pCapture->pReadback)
+		{
+			if (pCapture->pWindow != &window || GFrameNumberRenderThread < pCapture->targetFrame)
+				continue;
+
+			// Copy into a staging texture, the GPU does it whenever it gets there
+			pCapture->size = backBuffer->GetSizeXY();
+			pCapture->format = backBuffer->GetFormat();
+			pCapture->pReadback = MakeUnique<FRHIGPUTextureReadback>(TEXT("ScreenshotCapture"));
+
+			rhiCmdList.Transition(FRHITransitionInfo(backBuffer, ERHIAccess::Unknown, ERHIAccess::CopySrc));
+			pCapture->pReadback->EnqueueCopy(rhiCmdList, backBuffer);
+			rhiCmdList.Transition(FRHITransitionInfo(backBuffer, ERHIAccess::CopySrc, ERHIAccess::Present));
+			continue;
+		}
+
+		if (!pCapture->pReadback->IsReady())
+			continue;
+
+		// The only copy on the render thread, a plain memcpy of the mapped staging memory
+		int32 rowPitchInPixels = 0;
+		const uint8* pData = static_cast<const uint8*>(pCapture->pReadback->Lock(rowPitchInPixels));
+		const int64 numBytes = static_cast<int64>(rowPitchInPixels) * pCapture->size.Y * GPixelFormats[pCapture->format].BlockBytes;
+		pCapture->pixels.SetNumUninitialized(static_cast<int32>(numBytes));
+		FMemory::Memcpy(pCapture->pixels.GetData(), pData, numBytes);
+		pCapture->rowPitchInPixels = rowPitchInPixels;
+		pCapture->pReadback->Unlock();
+		pCapture->pReadback.Reset();
+
+		Async(EAsyncExecution::ThreadPool, [pCapture, pWeakState = TWeakPtr<FSharedState, ESPMode::ThreadSafe>(m_pSharedState)]()
+		{
+			Encode(pCapture, pWeakState);
+		});
+		m_RenderThreadCaptures.RemoveAtSwap(i);
+	}
+}
+
+void FScreenshotCapture::OnEndFrame()
+{
+	// The frame with the capture has been drawn, the messages can come back
+	if (m_bRestoreMessages && GFrameCounter > m_RestoreMessagesFrame)
+	{
+		GAreScreenMessagesEnabled = true;
+		m_bRestoreMessages = false;
+	}
+
+	// The engine writes its screenshot while drawing the frame it was requested in
+	for (int32 i = m_FallbackFrames.Num() - 1; i >= 0; --i)
+	{
+		if (GFrameCounter > m_FallbackFrames[i])
+		{
+			m_FallbackFrames.RemoveAtSwap(i);
+			Complete(m_pSharedState);
+		}
+	}
+}
+
+void FScreenshotCapture::Encode(FPendingCapturePtr pCapture, TWeakPtr<FSharedState, ESPMode::ThreadSafe> pWeakState)
+{
+	const int32 width = pCapture->size.X;
+	const int32 height = pCapture->size.Y;
+
+	// Tightly packed BGRA with an opaque alpha, whatever the back buffer format
+	TArray<FColor> colors;
+	colors.SetNumUninitialized(width * height);
+	bool bIsSupported = true;
+
+	for (int32 y = 0; y < height && bIsSupported; ++y)
+	{
+		const int64 rowOffset = static_cast<int64>(y) * pCapture->rowPitchInPixels;
+		for (int32 x = 0; x < width; ++x)
+		{
+			FColor& color = colors[y * width + x];
+			switch (pCapture->format)
+			{
+			case PF_B8G8R8A8:
+				color = reinterpret_cast<const FColor*>(pCapture->pixels.GetData())[rowOffset + x];
+				break;
+			case PF_R8G8B8A8:
+				{
+					const uint8* pPixel = pCapture->pixels.GetData() + (rowOffset + x) * 4;
+					color = FColor(pPixel[0], pPixel[1], pPixel[2]);
+				}
+				break;
+			case PF_A2B10G10R10:
+				{
+					const uint32 packed = reinterpret_cast<const uint32*>(pCapture->pixels.GetData())[rowOffset + x];
+					color = FColor((packed & 0x3FF) >> 2, ((packed >> 10) & 0x3FF) >> 2, ((packed >> 20) & 0x3FF) >> 2);
+				}
+				break;
+			default:
+				bIsSupported = false;
+				break;
+			}
+			color.A = 255;
+		}
+	}
+	pCapture->pixels.Empty();
+
+	bool bSucceeded = false;
+	if (!bIsSupported)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot capture a back buffer with format %s."), GPixelFormats[pCapture->format].Name);
+	}
+	else
+	{
+		IImageWrapperModule& imageWrapperModule = FModuleManager::GetModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+		const TSharedPtr<IImageWrapper> pImageWrapper = imageWrapperModule.CreateImageWrapper(EImageFormat::PNG);
+		if (pImageWrapper && pImageWrapper->SetRaw(colors.GetData(), colors.Num() * sizeof(FColor), width, height, ERGBFormat::BGRA, 8))
+		{
+			bSucceeded = FFileHelper::SaveArrayToFile(pImageWrapper->GetCompressed(), *pCapture->filePath);
+		}
+
+		if (bSucceeded)
+			UE_LOG(LogTemp, Log, TEXT("Screenshot saved to: %s"), *pCapture->filePath);
+		else
+			UE_LOG(LogTemp, Error, TEXT("Could not save screenshot to %s."), *pCapture->filePath);
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [pWeakState]()
+	{
+		Complete(pWeakState);
+	});
+}
+
+void FScreenshotCapture::Complete(const TWeakPtr<FSharedState, ESPMode::ThreadSafe>& pWeakState)
+{
+	const TSharedPtr<FSharedState, ESPMode::ThreadSafe> pState = pWeakState.Pin();
+	if (!pState || --pState->numPending > 0)
+		return;
+
+	// Callbacks may request new captures, those get their own round
+	TArray<TFunction<void()>> idleCallbacks = MoveTemp(pState->idleCallbacks);
+	pState->idleCallbacks.Reset();
+	for (TFunction<void()>& onIdle : idleCallbacks)
+	{
+		onIdle();
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RHIFwd.h"
+
+class SWindow;
+
+/**
+ * Captures the game viewport without stalling the game or render thread.
+ * The back buffer is copied into a staging texture when it is presented, read back once the GPU is done with it
+ * and encoded to PNG on a worker thread. Callers wait for NotifyWhenIdle before changing the view or the level.
+ * In the editor, or without a Slate renderer, it falls back to the engine's synchronous screenshot.
+ */
+class FScreenshotCapture final
+{
+public:
+	FScreenshotCapture();
+	~FScreenshotCapture();
+
+	FScreenshotCapture(const FScreenshotCapture&) = delete;
+	FScreenshotCapture& operator=(const FScreenshotCapture&) = delete;
+
+	// Captures the frame drawn after this tick, without on-screen debug messages.
+	// The file gets a .png extension, the returned path is the one that will be written
+	FString Request(const FString& filePath);
+	// Game thread, once every requested capture is written or failed. Called right away when nothing is pending
+	void NotifyWhenIdle(TFunction<void()> onIdle);
+	int32 GetNumPending() const;
+
+private:
+	struct FPendingCapture;
+	struct FSharedState;
+	using FPendingCapturePtr = TSharedPtr<FPendingCapture, ESPMode::ThreadSafe>;
+
+	// Outlives this object in the worker and game thread tasks that finish a capture
+	TSharedRef<FSharedState, ESPMode::ThreadSafe> m_pSharedState;
+
+	// Render thread only
+	TArray<FPendingCapturePtr> m_RenderThreadCaptures;
+
+	FDelegateHandle m_BackBufferReadyHandle;
+	FDelegateHandle m_EndFrameHandle;
+	TArray<uint64> m_FallbackFrames;
+	uint64 m_RestoreMessagesFrame;
+	bool m_bRestoreMessages;
+
+	void OnBackBufferReady(SWindow& window, const FTextureRHIRef& backBuffer);
+	void OnEndFrame();
+	static void Encode(FPendingCapturePtr pCapture, TWeakPtr<FSharedState, ESPMode::ThreadSafe> pWeakState);
+	static void Complete(const TWeakPtr<FSharedState, ESPMode::ThreadSafe>& pWeakState);
+};
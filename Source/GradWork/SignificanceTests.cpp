@@ -0,0 +1,139 @@
+#include "SignificanceTests.h"
+
+#include "Algo/Sort.h"
+#include "Async/ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+	// Resamples handed to one task, each task reuses its scratch buffers
+	constexpr int32 ResamplesPerTask = 50;
+
+	double MedianInPlace(double* pValues, const int32 num)
+	{
+		if (num == 0)
+			return 0.0;
+
+		double* pMiddle = pValues + num / 2;
+		std::nth_element(pValues, pMiddle, pValues + num);
+		if (num % 2 == 1)
+			return *pMiddle;
+
+		// The lower middle is the largest value of the lower half
+		const double lowerMiddle = *std::max_element(pValues, pMiddle);
+		return 0.5 * (lowerMiddle + *pMiddle);
+	}
+
+	// Moving block bootstrap, concatenates random blocks of consecutive samples until the sample count is reached
+	void ResampleBlocks(TConstArrayView<double> values, const int32 blockLength, FRandomStream& random, TArray<double>& outResample)
+	{
+		const int32 num = values.Num();
+		const int32 length = FMath::Clamp(blockLength, 1, num);
+		outResample.Reset(num);
+		while (outResample.Num() < num)
+		{
+			const int32 start = random.RandRange(0, num - length);
+			const int32 count = FMath::Min(length, num - outResample.Num());
+			outResample.Append(values.GetData() + start, count);
+		}
+	}
+}
+
+FMannWhitneyResult SignificanceTests::MannWhitneyU(TConstArrayView<double> baseline, TConstArrayView<double> candidate)
+{
+	const int32 n1 = baseline.Num();
+	const int32 n2 = candidate.Num();
+	if (n1 == 0 || n2 == 0)
+		return { 0.0, 0.0, 1.0, 0.5 };
+
+	// Value and which sample it came from, ranked together
+	TArray<TPair<double, bool>> combined;
+	combined.Reserve(n1 + n2);
+	for (const double value : baseline)
+	{
+		combined.Emplace(value, false);
+	}
+	for (const double value : candidate)
+	{
+		combined.Emplace(value, true);
+	}
+	Algo::SortBy(combined, [](const TPair<double, bool>& entry) { return entry.Key; });
+
+	const double n = n1 + n2;
+	double candidateRankSum = 0.0;
+	double tieTerm = 0.0;
+	for (int32 i = 0; i < combined.Num();)
+	{
+		int32 end = i + 1;
+		while (end < combined.Num() && combined[end].Key == combined[i].Key)
+		{
+			++end;
+		}
+
+		// Tied values share the average of their ranks, ranks start at 1
+		const double averageRank = 0.5 * (i + 1 + end);
+		for (int32 j = i; j < end; ++j)
+		{
+			candidateRankSum += combined[j].Value ? averageRank : 0.0;
+		}
+
+		const double numTied = end - i;
+		tieTerm += numTied * numTied * numTied - numTied;
+		i = end;
+	}
+
+	const double u = candidateRankSum - 0.5 * n2 * (n2 + 1.0);
+	const double meanU = 0.5 * n1 * n2;
+	const double varianceU = n1 * static_cast<double>(n2) / 12.0 * ((n + 1.0) - tieTerm / (n * (n - 1.0)));
+
+	FMannWhitneyResult result;
+	result.u = u;
+	result.z = varianceU > 0.0 ? (u - meanU) / FMath::Sqrt(varianceU) : 0.0;
+	result.pValue = std::erfc(FMath::Abs(result.z) / UE_DOUBLE_SQRT_2);
+	result.probabilityOfSuperiority = u / (static_cast<double>(n1) * n2);
+	return result;
+}
+
+FBootstrapInterval SignificanceTests::BootstrapMedianChange(TConstArrayView<double> baseline, TConstArrayView<double> candidate,
+	const int32 numResamples, const double confidence, const int32 blockLength, const int32 seed)
+{
+	const double baselineMedian = Median(TArray<double>(baseline));
+	if (baseline.IsEmpty() || candidate.IsEmpty() || baselineMedian == 0.0)
+		return { 0.0, 0.0, 0.0 };
+
+	FBootstrapInterval interval;
+	interval.estimate = Median(TArray<double>(candidate)) / baselineMedian - 1.0;
+
+	TArray<double> changes;
+	changes.SetNumZeroed(FMath::Max(1, numResamples));
+	const int32 numTasks = FMath::DivideAndRoundUp(changes.Num(), ResamplesPerTask);
+	ParallelFor(numTasks, [&](const int32 task)
+	{
+		TArray<double> baselineResample;
+		TArray<double> candidateResample;
+		const int32 end = FMath::Min(changes.Num(), (task + 1) * ResamplesPerTask);
+		for (int32 i = task * ResamplesPerTask; i < end; ++i)
+		{
+			FRandomStream random(static_cast<int32>(HashCombine(GetTypeHash(seed), GetTypeHash(i))));
+			ResampleBlocks(baseline, blockLength, random, baselineResample);
+			ResampleBlocks(candidate, blockLength, random, candidateResample);
+
+			const double resampledBaseline = MedianInPlace(baselineResample.GetData(), baselineResample.Num());
+			const double resampledCandidate = MedianInPlace(candidateResample.GetData(), candidateResample.Num());
+			changes[i] = resampledBaseline != 0.0 ? resampledCandidate / resampledBaseline - 1.0 : 0.0;
+		}
+	});
+
+	changes.Sort();
+	const double tail = 0.5 * (1.0 - confidence);
+	const int32 last = changes.Num() - 1;
+	interval.lower = changes[FMath::Clamp(FMath::FloorToInt32(tail * last), 0, last)];
+	interval.upper = changes[FMath::Clamp(FMath::CeilToInt32((1.0 - tail) * last), 0, last)];
+	return interval;
+}
+
+double SignificanceTests::Median(TArray<double> values)
+{
+	return MedianInPlace(values.GetData(), values.Num());
+}
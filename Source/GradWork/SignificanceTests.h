@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FMannWhitneyResult
+{
+	double u;
+	// Positive when the candidate tends to be larger
+	double z;
+	// Two-sided, normal approximation with the tie correction
+	double pValue;
+	// Chance that a candidate sample is larger than a baseline sample, 0.5 when the distributions match
+	double probabilityOfSuperiority;
+};
+
+struct FBootstrapInterval
+{
+	double estimate;
+	double lower;
+	double upper;
+};
+
+/**
+ * Two-sample tests for comparing the frames of a baseline run with a candidate run.
+ * Frame times are autocorrelated, so the bootstrap resamples blocks of consecutive frames instead of single frames.
+ */
+namespace SignificanceTests
+{
+	FMannWhitneyResult MannWhitneyU(TConstArrayView<double> baseline, TConstArrayView<double> candidate);
+
+	// Relative change of the median, candidate / baseline - 1, with a percentile interval.
+	// Resamples run in parallel, each with its own seeded stream, so the interval does not depend on scheduling
+	FBootstrapInterval BootstrapMedianChange(TConstArrayView<double> baseline, TConstArrayView<double> candidate,
+		int32 numResamples = 2000, double confidence = 0.95, int32 blockLength = 60, int32 seed = 0);
+
+	double Median(TArray<double> values);
+}
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "StreamingHistogram.h"
+
+/**
+ * Decides when frame times have settled after a level load, so tracking does not start during shader compilation,
+ * streaming or virtual shadow map warm-up. Frame times are collected in consecutive windows, the scene is steady once
+ * a few windows in a row have a low coefficient of variation and a mean that no longer drifts from the window before.
+ * Never allocates, every frame is O(1).
+ */
+class FWarmupDetector
+{
+public:
+	struct FSettings
+	{
+		int32 windowFrames{ 120 };
+		double maxCoefficientOfVariation{ 0.1 };
+		double maxRelativeMeanShift{ 0.03 };
+		int32 requiredStableWindows{ 3 };
+		float minSeconds{ 3.f };
+		// Gives up and reports steady anyway, a scene that never settles should still be measured
+		float maxSeconds{ 60.f };
+	};
+
+	explicit FWarmupDetector(const FSettings& settings = FSettings())
+		: m_Settings(settings)
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		m_WindowSum = 0.0;
+		m_WindowSumSquared = 0.0;
+		m_WindowCount = 0;
+		m_PreviousWindowMean = -1.0;
+		m_NumStableWindows = 0;
+		m_ElapsedSeconds = 0.f;
+		m_bIsSteady = false;
+		m_bTimedOut = false;
+	}
+
+	// Returns true once the frame times are steady (or the warm-up timed out), stays true until Reset
+	bool AddFrame(const double frameTimeMs, const float deltaSeconds)
+	{
+		if (m_bIsSteady)
+			return true;
+
+		m_ElapsedSeconds += deltaSeconds;
+		m_WindowSum += frameTimeMs;
+		m_WindowSumSquared += frameTimeMs * frameTimeMs;
+		++m_WindowCount;
+
+		if (m_WindowCount >= m_Settings.windowFrames)
+		{
+			CloseWindow();
+		}
+
+		if (m_NumStableWindows >= m_Settings.requiredStableWindows && m_ElapsedSeconds >= m_Settings.minSeconds)
+		{
+			m_bIsSteady = true;
+		}
+		else if (m_ElapsedSeconds >= m_Settings.maxSeconds)
+		{
+			m_bIsSteady = true;
+			m_bTimedOut = true;
+		}
+
+		return m_bIsSteady;
+	}
+
+	bool HasTimedOut() const { return m_bTimedOut; }
+	float GetElapsedSeconds() const { return m_ElapsedSeconds; }
+
+private:
+	FSettings m_Settings;
+
+	double m_WindowSum;
+	double m_WindowSumSquared;
+	int32 m_WindowCount;
+	double m_PreviousWindowMean;
+	int32 m_NumStableWindows;
+	float m_ElapsedSeconds;
+	bool m_bIsSteady;
+	bool m_bTimedOut;
+
+	void CloseWindow()
+	{
+		const double count = static_cast<double>(m_WindowCount);
+		const double mean = m_WindowSum / count;
+		const double variance = FMath::Max(0.0, (m_WindowSumSquared - m_WindowSum * mean) / (count - 1.0));
+		const double coefficientOfVariation = mean > 0.0 ? FMath::Sqrt(variance) / mean : 0.0;
+
+		// Change point test between two adjacent windows, a level that is still warming up keeps drifting
+		const bool bHasDrifted = m_PreviousWindowMean <= 0.0
+			|| FMath::Abs(mean - m_PreviousWindowMean) / m_PreviousWindowMean > m_Settings.maxRelativeMeanShift;
+
+		if (coefficientOfVariation <= m_Settings.maxCoefficientOfVariation && !bHasDrifted)
+			++m_NumStableWindows;
+		else
+			m_NumStableWindows = 0;
+
+		m_PreviousWindowMean = mean;
+		m_WindowSum = 0.0;
+		m_WindowSumSquared = 0.0;
+		m_WindowCount = 0;
+	}
+};
+
+/**
+ * Tells when a tracked window has enough frames: the 95% confidence intervals on the mean and on p95 frame time
+ * both have to be narrower than a fraction of their estimate.
+ * Consecutive frame times are strongly correlated, so the interval on the mean comes from batch means and the
+ * same batches give the effective sample size used for the p95 interval.
+ */
+class FPrecisionTracker
+{
+public:
+	explicit FPrecisionTracker(const int32 batchFrames = 60)
+		: m_BatchFrames(batchFrames)
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		m_BatchSum = 0.0;
+		m_BatchCount = 0;
+		m_NumBatches = 0;
+		m_BatchMean = 0.0;
+		m_BatchM2 = 0.0;
+	}
+
+	// Returns true when a batch was completed, the only moments worth checking the precision again
+	bool AddFrame(const double frameTimeMs)
+	{
+		m_BatchSum += frameTimeMs;
+		if (++m_BatchCount < m_BatchFrames)
+			return false;
+
+		// Welford over the batch means
+		const double batchMean = m_BatchSum / static_cast<double>(m_BatchCount);
+		++m_NumBatches;
+		const double delta = batchMean - m_BatchMean;
+		m_BatchMean += delta / static_cast<double>(m_NumBatches);
+		m_BatchM2 += delta * (batchMean - m_BatchMean);
+
+		m_BatchSum = 0.0;
+		m_BatchCount = 0;
+		return true;
+	}
+
+	// Half widths of the 95% intervals relative to the estimate, checks the histogram so only call it once per batch
+	bool IsPrecise(const FStreamingHistogram& frameTimes, const double targetRelativeHalfWidth) const
+	{
+		if (m_NumBatches < MinBatches || frameTimes.Num() == 0)
+			return false;
+
+		const FHistogramSummary summary = frameTimes.Summarize(0.0);
+		if (summary.mean <= 0.0 || summary.p95 <= 0.0)
+			return false;
+
+		const double batchVariance = m_BatchM2 / static_cast<double>(m_NumBatches - 1);
+		const double meanHalfWidth = Z95 * FMath::Sqrt(batchVariance / static_cast<double>(m_NumBatches));
+		if (meanHalfWidth / summary.mean > targetRelativeHalfWidth)
+			return false;
+
+		// Variance inflation from the correlation between frames, 1 for independent frames
+		const double frameVariance = summary.stdDev * summary.stdDev;
+		const double inflation = frameVariance > 0.0 ? FMath::Max(1.0, batchVariance * m_BatchFrames / frameVariance) : 1.0;
+		const double effectiveCount = static_cast<double>(frameTimes.Num()) / inflation;
+
+		// Distribution free interval on the quantile from the binomial ranks around it
+		constexpr double quantile = 0.95;
+		const double rankSpread = Z95 * FMath::Sqrt(quantile * (1.0 - quantile) / effectiveCount);
+		const double lower = frameTimes.GetValueAtQuantile(FMath::Max(0.0, quantile - rankSpread));
+		const double upper = frameTimes.GetValueAtQuantile(FMath::Min(1.0, quantile + rankSpread));
+		return (upper - lower) * 0.5 / summary.p95 <= targetRelativeHalfWidth;
+	}
+
+private:
+	static constexpr double Z95 = 1.96;
+	static constexpr uint64 MinBatches = 10;
+
+	int32 m_BatchFrames;
+	double m_BatchSum;
+	int32 m_BatchCount;
+	uint64 m_NumBatches;
+	double m_BatchMean;
+	double m_BatchM2;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include <vector>
+
+struct FHistogramSummary
+{
+	uint64 count;
+	uint64 overBudgetCount;
+	double min;
+	double max;
+	double mean;
+	double trimmedMean;
+	double stdDev;
+	double p50;
+	double p90;
+	double p95;
+	double p99;
+	double p999;
+};
+
+/**
+ * Log-linear (HDR style) histogram with a fixed bucket layout.
+ * Values are converted to integer units (e.g. microseconds for a metric in ms) and land in a bucket with ~0.4% relative error.
+ * Recording is O(1) and never allocates, histograms with the same unit scale can be merged.
+ */
+class FStreamingHistogram
+{
+public:
+	explicit FStreamingHistogram(const double unitsPerValue = 1000.0, const double budget = 0.0)
+		: m_UnitsPerValue(unitsPerValue)
+		, m_Budget(budget)
+		, m_Counts(NumBuckets, 0)
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		std::fill(m_Counts.begin(), m_Counts.end(), 0);
+		m_Count = 0;
+		m_OverBudgetCount = 0;
+		m_Min = TNumericLimits<double>::Max();
+		m_Max = TNumericLimits<double>::Lowest();
+		m_Mean = 0.0;
+		m_M2 = 0.0;
+	}
+
+	void Record(const double value)
+	{
+		++m_Counts[GetBucketIndex(ToUnits(value))];
+		++m_Count;
+
+		if (m_Budget > 0.0 && value > m_Budget)
+			++m_OverBudgetCount;
+
+		m_Min = FMath::Min(m_Min, value);
+		m_Max = FMath::Max(m_Max, value);
+
+		// Welford's running variance
+		const double delta = value - m_Mean;
+		m_Mean += delta / static_cast<double>(m_Count);
+		m_M2 += delta * (value - m_Mean);
+	}
+
+	void Merge(const FStreamingHistogram& other)
+	{
+		checkf(m_UnitsPerValue == other.m_UnitsPerValue, TEXT("Only histograms with the same unit scale can be merged"));
+		if (other.m_Count == 0)
+			return;
+
+		for (int32 i = 0; i < NumBuckets; ++i)
+			m_Counts[i] += other.m_Counts[i];
+
+		// Chan's parallel variance
+		const double total = static_cast<double>(m_Count + other.m_Count);
+		const double delta = other.m_Mean - m_Mean;
+		m_M2 += other.m_M2 + delta * delta * static_cast<double>(m_Count) * static_cast<double>(other.m_Count) / total;
+		m_Mean += delta * static_cast<double>(other.m_Count) / total;
+
+		m_Count += other.m_Count;
+		m_OverBudgetCount += other.m_OverBudgetCount;
+		m_Min = FMath::Min(m_Min, other.m_Min);
+		m_Max = FMath::Max(m_Max, other.m_Max);
+	}
+
+	uint64 Num() const { return m_Count; }
+	double GetBudget() const { return m_Budget; }
+
+	double GetValueAtQuantile(const double quantile) const
+	{
+		if (m_Count == 0)
+			return 0.0;
+
+		const uint64 targetRank = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(quantile * static_cast<double>(m_Count))));
+		uint64 cumulative = 0;
+		for (int32 i = 0; i < NumBuckets; ++i)
+		{
+			cumulative += m_Counts[i];
+			if (cumulative >= targetRank)
+				return FMath::Clamp(GetBucketMidpoint(i), m_Min, m_Max);
+		}
+
+		return m_Max;
+	}
+
+	FHistogramSummary Summarize(const double trimFraction) const
+	{
+		FHistogramSummary summary{};
+		summary.count = m_Count;
+		if (m_Count == 0)
+			return summary;
+
+		summary.overBudgetCount = m_OverBudgetCount;
+		summary.min = m_Min;
+		summary.max = m_Max;
+		summary.mean = m_Mean;
+		summary.stdDev = m_Count > 1 ? FMath::Sqrt(m_M2 / static_cast<double>(m_Count - 1)) : 0.0;
+		summary.trimmedMean = GetTrimmedMean(trimFraction);
+		summary.p50 = GetValueAtQuantile(0.5);
+		summary.p90 = GetValueAtQuantile(0.9);
+		summary.p95 = GetValueAtQuantile(0.95);
+		summary.p99 = GetValueAtQuantile(0.99);
+		summary.p999 = GetValueAtQuantile(0.999);
+		return summary;
+	}
+
+private:
+	// 2^SubBucketBits linear sub-buckets per power of two, values up to 2^MaxValueBits units
+	static constexpr int32 SubBucketBits = 8;
+	static constexpr int32 SubBucketCount = 1 << SubBucketBits;
+	static constexpr int32 SubBucketHalfCount = SubBucketCount / 2;
+	static constexpr int32 MaxValueBits = 48;
+	static constexpr int32 NumBuckets = SubBucketHalfCount * (MaxValueBits - SubBucketBits + 2);
+
+	double m_UnitsPerValue;
+	double m_Budget;
+	std::vector<uint32> m_Counts;
+	uint64 m_Count;
+	uint64 m_OverBudgetCount;
+	double m_Min, m_Max;
+	double m_Mean, m_M2;
+
+	uint64 ToUnits(const double value) const
+	{
+		constexpr double maxUnits = static_cast<double>((1ull << MaxValueBits) - 1);
+		return static_cast<uint64>(FMath::Clamp(value * m_UnitsPerValue, 0.0, maxUnits));
+	}
+
+	static int32 GetBucketIndex(const uint64 units)
+	{
+		if (units < SubBucketCount)
+			return static_cast<int32>(units);
+
+		const int32 exponent = static_cast<int32>(FMath::FloorLog2_64(units)) - (SubBucketBits - 1);
+		const int32 subBucket = static_cast<int32>(units >> exponent);
+		return SubBucketHalfCount * exponent + subBucket;
+	}
+
+	double GetBucketMidpoint(const int32 index) const
+	{
+		if (index < SubBucketCount)
+			return static_cast<double>(index) / m_UnitsPerValue;
+
+		const int32 exponent = index / SubBucketHalfCount - 1;
+		const uint64 subBucket = static_cast<uint64>(index - SubBucketHalfCount * exponent);
+		const uint64 lower = subBucket << exponent;
+		const uint64 upper = ((subBucket + 1) << exponent) - 1;
+		return (static_cast<double>(lower) + static_cast<double>(upper)) * 0.5 / m_UnitsPerValue;
+	}
+
+	double GetTrimmedMean(const double trimFraction) const
+	{
+		const uint64 trimCount = static_cast<uint64>(static_cast<double>(m_Count) * trimFraction);
+		if (m_Count <= trimCount * 2)
+			return m_Mean;
+
+		const uint64 firstRank = trimCount;
+		const uint64 lastRank = m_Count - trimCount;
+
+		double sum = 0.0;
+		uint64 cumulative = 0;
+		for (int32 i = 0; i < NumBuckets && cumulative < lastRank; ++i)
+		{
+			const uint64 bucketStart = cumulative;
+			cumulative += m_Counts[i];
+
+			const uint64 overlapStart = FMath::Max(bucketStart, firstRank);
+			const uint64 overlapEnd = FMath::Min(cumulative, lastRank);
+			if (overlapEnd > overlapStart)
+				sum += static_cast<double>(overlapEnd - overlapStart) * FMath::Clamp(GetBucketMidpoint(i), m_Min, m_Max);
+		}
+
+		return sum / static_cast<double>(lastRank - firstRank);
+	}
+};
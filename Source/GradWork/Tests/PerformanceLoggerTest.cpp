@@ -0,0 +1,92 @@
+#include "PerformanceLogger.h"
+
+#include "Misc/AutomationTest.h"
+#include <atomic>
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// Forwards to the engine's allocator and counts the allocations made by one thread
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		FCountingMalloc(FMalloc* pInner, const uint32 threadId) : m_pInner(pInner), m_ThreadId(threadId) {}
+
+		int32 GetNumAllocations() const { return m_NumAllocations.load(std::memory_order_relaxed); }
+
+		virtual void* Malloc(SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->Malloc(count, alignment); }
+		virtual void* TryMalloc(SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->TryMalloc(count, alignment); }
+		virtual void* Realloc(void* pOriginal, SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->Realloc(pOriginal, count, alignment); }
+		virtual void* TryRealloc(void* pOriginal, SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->TryRealloc(pOriginal, count, alignment); }
+		virtual void* MallocZeroed(SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->MallocZeroed(count, alignment); }
+		virtual void* TryMallocZeroed(SIZE_T count, uint32 alignment) override { Count(count); return m_pInner->TryMallocZeroed(count, alignment); }
+		virtual void Free(void* pOriginal) override { m_pInner->Free(pOriginal); }
+		virtual SIZE_T QuantizeSize(SIZE_T count, uint32 alignment) override { return m_pInner->QuantizeSize(count, alignment); }
+		virtual bool GetAllocationSize(void* pOriginal, SIZE_T& outSize) override { return m_pInner->GetAllocationSize(pOriginal, outSize); }
+		virtual void Trim(bool bTrimThreadCaches) override { m_pInner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { m_pInner->SetupTLSCachesOnCurrentThread(); }
+		virtual void MarkTLSCachesAsUsedOnCurrentThread() override { m_pInner->MarkTLSCachesAsUsedOnCurrentThread(); }
+		virtual void MarkTLSCachesAsUnusedOnCurrentThread() override { m_pInner->MarkTLSCachesAsUnusedOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { m_pInner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual void UpdateStats() override { m_pInner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& outStats) override { m_pInner->GetAllocatorStats(outStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& output) override { m_pInner->DumpAllocatorStats(output); }
+		virtual bool IsInternallyThreadSafe() const override { return m_pInner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return m_pInner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return m_pInner->GetDescriptiveName(); }
+
+	private:
+		FMalloc* m_pInner;
+		uint32 m_ThreadId;
+		std::atomic<int32> m_NumAllocations{ 0 };
+
+		void Count(const SIZE_T count)
+		{
+			if (count != 0 && FPlatformTLS::GetCurrentThreadId() == m_ThreadId)
+			{
+				m_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	};
+
+	// Long enough for every probe interval and several trace chunk hand-offs to come around
+	constexpr int32 NumSoakFrames = 600;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FPerformanceLoggerNoAllocationTest, "GradWork.PerformanceLogger.NoAllocationWhileTracking",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FPerformanceLoggerNoAllocationTest::RunTest(const FString& Parameters)
+{
+	// A small expected frame rate keeps the trace chunks short, so the writer thread swaps them during the soak
+	const TSharedRef<FPerformanceLogger> pLogger = MakeShared<FPerformanceLogger>(3600.f, 0.1f, TEXT("NoAllocationSoak"), TEXT("Tests"), 60.f);
+	pLogger->SetOutputDirectory(FPaths::AutomationTransientDir() / TEXT("PerformanceLogger"));
+	pLogger->SetProbeIntervals(1, 1, 0.5f);
+	pLogger->SetEarlyStop(0.f, 0.0);
+	pLogger->StartTracking();
+
+	// Other threads keep running through the proxy while it is installed, it is never freed so a late call stays valid
+	FCountingMalloc* pCountingMalloc = new FCountingMalloc(GMalloc, FPlatformTLS::GetCurrentThreadId());
+	int32 numFrames = 0;
+
+	ADD_LATENT_AUTOMATION_COMMAND(FFunctionLatentCommand([this, pLogger, pCountingMalloc, numFrames]() mutable
+	{
+		// Only the logger's own update is counted, the rest of the frame is not the logger's to answer for
+		FMalloc* pEngineMalloc = GMalloc;
+		GMalloc = pCountingMalloc;
+		pLogger->Update(FApp::GetDeltaTime());
+		GMalloc = pEngineMalloc;
+
+		if (++numFrames < NumSoakFrames)
+			return false;
+
+		TestTrue(TEXT("The logger is still tracking"), pLogger->IsTracking());
+		TestEqual(TEXT("Allocations made by the logger while tracking"), pCountingMalloc->GetNumAllocations(), 0);
+		pLogger->StopTracking();
+		return true;
+	}));
+	return true;
+}
+
+#endif
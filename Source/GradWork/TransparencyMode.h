@@ -0,0 +1,71 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "TransparencyMode.generated.h"
+
+UENUM(BlueprintType)  // This makes the enum available in both C++ and Blueprints
+enum class EMode : uint8
+{
+	odt			UMETA(DisplayName = "Order-Dependant Transparency"),
+	oit			UMETA(DisplayName = "Order-Independant Transparency"),
+	raytracing	UMETA(DisplayName = "Raytracing"),
+};
+
+namespace TransparencyMode
+{
+	// Also used as the output folder name of a mode
+	inline FString GetDisplayString(const EMode mode)
+	{
+		switch (mode)
+		{
+		case EMode::odt:
+			return "Order-Dependant Transparency";
+		case EMode::oit:
+			return "Order-Independent Transparency";
+		case EMode::raytracing:
+			return "Raytracing";
+		}
+
+		return "";
+	}
+
+	// Switches the renderer to the mode at runtime, r.RayTracing itself has to be enabled at startup for raytracing
+	inline void Apply(const EMode mode)
+	{
+		const TPair<const TCHAR*, int32> cvarValues[] =
+		{
+			{ TEXT("r.OIT.SortedPixels"), mode == EMode::oit ? 1 : 0 },
+			{ TEXT("r.RayTracing.Translucency"), mode == EMode::raytracing ? 1 : 0 },
+		};
+
+		for (const TPair<const TCHAR*, int32>& cvarValue : cvarValues)
+		{
+			if (IConsoleVariable* pCVar = IConsoleManager::Get().FindConsoleVariable(cvarValue.Key))
+			{
+				pCVar->Set(cvarValue.Value, ECVF_SetByCode);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("Cannot apply transparency mode, %s does not exist."), cvarValue.Key);
+			}
+		}
+
+		const IConsoleVariable* pRayTracing = IConsoleManager::Get().FindConsoleVariable(TEXT("r.RayTracing"));
+		if (mode == EMode::raytracing && (!pRayTracing || pRayTracing->GetInt() == 0))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Ray tracing is not enabled, the raytracing mode renders without ray traced translucency."));
+		}
+	}
+
+	// Accepts the enum names used on the command line (odt, oit, raytracing)
+	inline bool Parse(const FString& string, EMode& outMode)
+	{
+		const int64 value = StaticEnum<EMode>()->GetValueByNameString(string.TrimStartAndEnd());
+		if (value == INDEX_NONE)
+			return false;
+
+		outMode = static_cast<EMode>(value);
+		return true;
+	}
+}
@@ -1,25 +1,119 @@
 #include "TransparentHeavyLevel.h"
+#include "BenchmarkSubsystem.h"
+#include "PerformanceLogger.h"
+#include "RenderTransform.h"
+#include "Camera/PlayerCameraManager.h"
 #include "Components/InstancedStaticMeshComponent.h"
 #include "Engine/StaticMeshActor.h"
+#include "GameFramework/PlayerController.h"
 #include "Kismet/KismetMathLibrary.h"
 
+namespace
+{
+    const TCHAR* const CubeMetadataKeys[] =
+    {
+        TEXT("CubeSpawnMode"), TEXT("CubeParams"), TEXT("CubeLayers"), TEXT("SweepStep"),
+        TEXT("CubeGenerateTime"), TEXT("CubeSpawnTime"), TEXT("CubeSpawnMemory"), TEXT("CubeSortThresholds"),
+    };
+
+    // Custom data floats of an instanced cube, the color
+    constexpr int32 NumCubeCustomData = 3;
+
+    FPerformanceLogger* GetPerformanceLogger(const UGameInstance* pGameInstance)
+    {
+        const UBenchmarkSubsystem* pBenchmarkSubsystem = pGameInstance ? pGameInstance->GetSubsystem<UBenchmarkSubsystem>() : nullptr;
+        return pBenchmarkSubsystem ? &pBenchmarkSubsystem->GetPerformanceLogger() : nullptr;
+    }
+}
+
 ATransparentHeavyLevel::ATransparentHeavyLevel()
 {
-    PrimaryActorTick.bCanEverTick = false;
-    
+    // Only sorted instances tick, after the camera has moved for the frame
+    PrimaryActorTick.bCanEverTick = true;
+    PrimaryActorTick.bStartWithTickEnabled = false;
+    PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
     // In the Level Script Actor
     m_pCubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
     m_pBaseMaterial = LoadObject<UMaterialInterface>(nullptr, TEXT("/Game/Materials/M_Translucent_Emissive.M_Translucent_Emissive"));
+    m_pInstancedMaterial = LoadObject<UMaterialInterface>(nullptr, TEXT("/Game/Materials/M_Translucent_Emissive_Instanced.M_Translucent_Emissive_Instanced"), nullptr, LOAD_NoWarn);
 }
 
 void ATransparentHeavyLevel::BeginPlay()
 {
     ALevelScriptActor::BeginPlay();
 
-    SpawnCubes();
+    ParseCommandLine();
+    ApplySweepStep(0);
+}
+
+void ATransparentHeavyLevel::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+    // The logger outlives the level, the other scenes have no cubes
+    if (FPerformanceLogger* pLogger = GetPerformanceLogger(GetGameInstance()))
+    {
+        for (const TCHAR* key : CubeMetadataKeys)
+        {
+            pLogger->RemoveTraceMetadata(key);
+        }
+        pLogger->SetInstanceSortStats(-1.0, -1.0);
+    }
+
+    ALevelScriptActor::EndPlay(EndPlayReason);
+}
+
+FString ATransparentHeavyLevel::GetSweepStepName() const
+{
+    if (m_Sweep.IsEmpty())
+        return FString();
+
+    return FString::Printf(TEXT("Sweep%d"), m_SweepStep);
+}
+
+void ATransparentHeavyLevel::ApplySweepStep(const int32 step)
+{
+    m_SweepStep = FMath::Clamp(step, 0, GetNumSweepSteps() - 1);
+
+    DestroyCubes();
+    SpawnCubes(m_Sweep.IsValidIndex(m_SweepStep) ? m_Sweep[m_SweepStep] : m_Params);
 }
 
-void ATransparentHeavyLevel::SpawnCubes() 
+void ATransparentHeavyLevel::ParseCommandLine()
+{
+    const TCHAR* commandLine = FCommandLine::Get();
+
+    FString modeString;
+    if (FParse::Value(commandLine, TEXT("CubeSpawnMode="), modeString))
+    {
+        const int64 value = StaticEnum<ECubeSpawnMode>()->GetValueByNameString(modeString);
+        if (value != INDEX_NONE)
+            m_SpawnMode = static_cast<ECubeSpawnMode>(value);
+        else
+            UE_LOG(LogTemp, Warning, TEXT("Unknown cube spawn mode '%s'."), *modeString);
+    }
+
+    DepthComplexity::ParseCommandLine(commandLine, m_Params);
+    FParse::Value(commandLine, TEXT("CubeSortDistance="), m_SortDistance);
+    FParse::Value(commandLine, TEXT("CubeSortAngle="), m_SortAngle);
+
+    // A sweep on the command line replaces the one set up in the level, every step only changes the average layers
+    FString sweepString;
+    if (FParse::Value(commandLine, TEXT("DepthSweep="), sweepString, false))
+    {
+        TArray<FString> entries;
+        sweepString.ParseIntoArray(entries, TEXT(","), true);
+
+        m_Sweep.Reset();
+        for (const FString& entry : entries)
+        {
+            FDepthComplexityParams params = m_Params;
+            params.targetAverageLayers = FCString::Atof(*entry);
+            m_Sweep.Add(params);
+        }
+    }
+}
+
+void ATransparentHeavyLevel::SpawnCubes(const FDepthComplexityParams& params)
 {
     // Ensure you have a reference to the cube mesh and material
     if (!m_pCubeMesh || !m_pBaseMaterial)
@@ -28,56 +122,198 @@ void ATransparentHeavyLevel::SpawnCubes()
         return;
     }
 
-    // Player's position and view settings
-    const auto playerLocation = FVector(0.f, 0.f, 0.f);
+    // Player's view settings, the cubes fill the frustum in front of the origin
     constexpr float fov = 90.f; // Horizontal FOV
     constexpr float aspectRatio = 16.f / 9.f; // Screen aspect ratio
 
-    // Calculate the frustum bounds
-    constexpr float halfHorizontalFov = FMath::DegreesToRadians(fov / 2);
-    const float halfVerticalFov = FMath::Atan(FMath::Tan(halfHorizontalFov) / aspectRatio);
-    
-    // Create a random stream with a specific seed for consistent randomness
-    FRandomStream randomStream;
-    randomStream.Initialize(1);
+    const double generateStartTime = FPlatformTime::Seconds();
+    const FDepthComplexityLayout layout = DepthComplexity::Generate(params, fov, aspectRatio);
+    const double generateTimeMs = (FPlatformTime::Seconds() - generateStartTime) * 1000.0;
+
+    const uint64 memoryBefore = FPlatformMemory::GetStats().UsedPhysical;
+    const double startTime = FPlatformTime::Seconds();
+
+    if (m_SpawnMode == ECubeSpawnMode::Actors)
+        SpawnCubeActors(layout);
+    else
+        SpawnCubeInstances(layout);
+
+    const double spawnTimeMs = (FPlatformTime::Seconds() - startTime) * 1000.0;
+    const double spawnMemoryMB = (static_cast<double>(FPlatformMemory::GetStats().UsedPhysical) - static_cast<double>(memoryBefore)) / (1024.0 * 1024.0);
+    const FString modeString = StaticEnum<ECubeSpawnMode>()->GetNameStringByValue(static_cast<int64>(m_SpawnMode));
+    const FString layersString = FString::Printf(TEXT("%.2f average, %.2f max (estimated)"), layout.estimatedAverageLayers, layout.estimatedMaxLayers);
+
+    UE_LOG(LogTemp, Log, TEXT("Spawned %d cubes as %s in %.2f ms (generated in %.2f ms), %.2f MB, %s layers."),
+        layout.transforms.Num(), *modeString, spawnTimeMs, generateTimeMs, spawnMemoryMB, *layersString);
+
+    if (FPerformanceLogger* pLogger = GetPerformanceLogger(GetGameInstance()))
+    {
+        pLogger->SetTraceMetadata("CubeSpawnMode", modeString);
+        pLogger->SetTraceMetadata("CubeParams", params.ToString());
+        pLogger->SetTraceMetadata("CubeLayers", layersString);
+        pLogger->SetTraceMetadata("SweepStep", FString::Printf(TEXT("%d/%d"), m_SweepStep + 1, GetNumSweepSteps()));
+        pLogger->SetTraceMetadata("CubeGenerateTime", FString::Printf(TEXT("%.2f ms"), generateTimeMs));
+        pLogger->SetTraceMetadata("CubeSpawnTime", FString::Printf(TEXT("%.2f ms"), spawnTimeMs));
+        pLogger->SetTraceMetadata("CubeSpawnMemory", FString::Printf(TEXT("%.2f MB"), spawnMemoryMB));
+        if (m_SpawnMode == ECubeSpawnMode::SortedInstanced)
+            pLogger->SetTraceMetadata("CubeSortThresholds", FString::Printf(TEXT("%.1f cm, %.2f degrees"), m_SortDistance, m_SortAngle));
+        else
+            pLogger->RemoveTraceMetadata("CubeSortThresholds");
+        pLogger->SetInstanceSortStats(-1.0, -1.0);
+    }
+
+    SetActorTickEnabled(m_SpawnMode == ECubeSpawnMode::SortedInstanced && m_pCubeInstances != nullptr);
+}
 
-    constexpr int32 amountOfCubes{ 2500 };
-    for (int32 i = 0; i < amountOfCubes; i++)
+void ATransparentHeavyLevel::SpawnCubeActors(const FDepthComplexityLayout& layout)
+{
+    m_SpawnedActors.Reserve(layout.transforms.Num());
+    for (int32 i = 0; i < layout.transforms.Num(); i++)
     {
-        // Random distance within the bounds
-        constexpr float maxDistance = 7500.f;
-        constexpr float minDistance = 1000.f;
-        // Non-linear distance calculation (quadratic distribution)
-        const float randomFraction = randomStream.FRand();
-        const float distance = FMath::Lerp(minDistance, maxDistance, FMath::Sqrt(randomFraction)); // Square root distribution
-
-        // Random angle within the FOV
-        const float horizontalAngle = static_cast<float>(randomStream.FRandRange(-halfHorizontalFov, halfHorizontalFov));
-        const float verticalAngle = static_cast<float>(randomStream.FRandRange(-halfVerticalFov, halfVerticalFov));
-
-        // Calculate the cube's position
-        FVector direction = FVector(
-            FMath::Cos(verticalAngle) * FMath::Cos(horizontalAngle),
-            FMath::Cos(verticalAngle) * FMath::Sin(horizontalAngle),
-            FMath::Sin(verticalAngle)
-        ).GetSafeNormal();
-
-        const FVector location = playerLocation + direction * distance;
-
-        // Spawn the cube at the calculated location
-        if (const auto* newCube = GetWorld()->SpawnActor<AStaticMeshActor>(location, FRotator::ZeroRotator))
+        // Spawn the cube at the generated transform
+        if (auto* newCube = GetWorld()->SpawnActor<AStaticMeshActor>(AStaticMeshActor::StaticClass(), layout.transforms[i]))
         {
             // Set the mesh and material for the spawned cube
             newCube->GetStaticMeshComponent()->SetStaticMesh(m_pCubeMesh);
 
-            // Create a dynamic material instance for random colors
+            // Create a dynamic material instance for the cube's color
             auto* dynMaterial = UMaterialInstanceDynamic::Create(m_pBaseMaterial, this);
-            FLinearColor randomColor = FLinearColor::MakeRandomColor();
-            randomColor *= 1.5f; // Brighten the color
-            dynMaterial->SetVectorParameterValue(FName("Color"), randomColor);
+            dynMaterial->SetVectorParameterValue(FName("Color"), layout.colors[i]);
 
             // Apply the material to the cube
             newCube->GetStaticMeshComponent()->SetMaterial(0, dynMaterial);
+            m_SpawnedActors.Add(newCube);
         }
     }
 }
+
+void ATransparentHeavyLevel::SpawnCubeInstances(const FDepthComplexityLayout& layout)
+{
+    if (!m_pInstancedMaterial)
+    {
+        UE_LOG(LogTemp, Warning, TEXT("Instanced cube material not found, every instance uses the base material's color. Create it with -run=InstancedMaterial."));
+    }
+
+    AActor* pHost = GetWorld()->SpawnActor<AActor>();
+    m_SpawnedActors.Add(pHost);
+
+    // Sorted instances are moved every time the view changes enough
+    const bool bIsSorted = m_SpawnMode == ECubeSpawnMode::SortedInstanced;
+    m_pCubeInstances = NewObject<UInstancedStaticMeshComponent>(pHost, TEXT("CubeInstances"));
+    m_pCubeInstances->SetMobility(bIsSorted ? EComponentMobility::Movable : EComponentMobility::Static);
+    m_pCubeInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+    m_pCubeInstances->SetStaticMesh(m_pCubeMesh);
+    m_pCubeInstances->SetMaterial(0, m_pInstancedMaterial ? m_pInstancedMaterial : m_pBaseMaterial);
+    m_pCubeInstances->NumCustomDataFloats = NumCubeCustomData;
+    pHost->SetRootComponent(m_pCubeInstances);
+
+    m_pCubeInstances->AddInstances(layout.transforms, false, true);
+
+    // Render state is rebuilt once for all instances
+    for (int32 i = 0; i < layout.colors.Num(); i++)
+    {
+        const FLinearColor& color = layout.colors[i];
+        const float customData[] = { color.R, color.G, color.B };
+        m_pCubeInstances->SetCustomData(i, customData, false);
+    }
+
+    m_pCubeInstances->RegisterComponent();
+
+    // Instance slot i holds cube i until the first sort
+    if (bIsSorted)
+    {
+        m_InstanceTransforms = layout.transforms;
+        m_InstanceColors = layout.colors;
+        m_InstanceOrder.SetNumUninitialized(layout.transforms.Num());
+        TArray<FVector3f> locations;
+        locations.SetNumUninitialized(layout.transforms.Num());
+        for (int32 i = 0; i < layout.transforms.Num(); i++)
+        {
+            m_InstanceOrder[i] = i;
+            locations[i] = FVector3f(layout.transforms[i].GetLocation());
+        }
+        m_InstanceSorter.SetLocations(MoveTemp(locations));
+        m_bHasSorted = false;
+    }
+}
+
+void ATransparentHeavyLevel::Tick(const float DeltaSeconds)
+{
+    ALevelScriptActor::Tick(DeltaSeconds);
+
+    const APlayerController* pController = GetWorld()->GetFirstPlayerController();
+    if (!m_pCubeInstances || !pController || !pController->PlayerCameraManager)
+        return;
+
+    double sortTimeUs;
+    double uploadKB;
+    SortInstances(pController->PlayerCameraManager->GetCameraLocation(), pController->PlayerCameraManager->GetCameraRotation().Vector(), sortTimeUs, uploadKB);
+
+    if (FPerformanceLogger* pLogger = GetPerformanceLogger(GetGameInstance()))
+        pLogger->SetInstanceSortStats(sortTimeUs, uploadKB);
+}
+
+void ATransparentHeavyLevel::SortInstances(const FVector& viewLocation, const FVector& viewDirection, double& outSortTimeUs, double& outUploadKB)
+{
+    outSortTimeUs = 0.0;
+    outUploadKB = 0.0;
+
+    // A small camera move hardly changes the order, the previous one is kept until the view moved or turned enough
+    const double turnedDegrees = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FVector::DotProduct(viewDirection, m_LastSortDirection), -1.0, 1.0)));
+    if (m_bHasSorted && FVector::Dist(viewLocation, m_LastSortLocation) <= m_SortDistance && turnedDegrees <= m_SortAngle)
+        return;
+
+    m_bHasSorted = true;
+    m_LastSortLocation = viewLocation;
+    m_LastSortDirection = viewDirection;
+
+    const uint64 startCycles = FPlatformTime::Cycles64();
+    const TArray<int32>& order = m_InstanceSorter.Sort(viewLocation, viewDirection);
+    outSortTimeUs = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - startCycles) * 1000.0;
+
+    // The last run marks the render state dirty, the renderer then only takes the ranges the batches recorded
+    int32 lastChangedSlot = order.Num() - 1;
+    while (lastChangedSlot >= 0 && order[lastChangedSlot] == m_InstanceOrder[lastChangedSlot])
+        --lastChangedSlot;
+
+    // Only runs of slots that now hold a different cube are sent to the renderer again
+    int32 numChanged = 0;
+    for (int32 slot = 0; slot <= lastChangedSlot;)
+    {
+        if (order[slot] == m_InstanceOrder[slot])
+        {
+            ++slot;
+            continue;
+        }
+
+        const int32 firstSlot = slot;
+        m_UploadTransforms.Reset();
+        for (; slot < order.Num() && order[slot] != m_InstanceOrder[slot]; ++slot)
+        {
+            const int32 cube = order[slot];
+            m_InstanceOrder[slot] = cube;
+            m_UploadTransforms.Add(m_InstanceTransforms[cube]);
+
+            const FLinearColor& color = m_InstanceColors[cube];
+            const float customData[NumCubeCustomData] = { color.R, color.G, color.B };
+            m_pCubeInstances->SetCustomData(slot, customData, false);
+        }
+
+        m_pCubeInstances->BatchUpdateInstancesTransforms(firstSlot, m_UploadTransforms, false, slot > lastChangedSlot, true);
+        numChanged += slot - firstSlot;
+    }
+
+    outUploadKB = numChanged * (sizeof(FRenderTransform) + NumCubeCustomData * sizeof(float)) / 1024.0;
+}
+
+void ATransparentHeavyLevel::DestroyCubes()
+{
+    for (AActor* pActor : m_SpawnedActors)
+    {
+        if (IsValid(pActor))
+            pActor->Destroy();
+    }
+
+    m_SpawnedActors.Reset();
+    m_pCubeInstances = nullptr;
+}
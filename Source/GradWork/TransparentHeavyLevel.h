@@ -2,8 +2,31 @@
 
 #include "CoreMinimal.h"
 #include "Engine/LevelScriptActor.h"
+#include "DepthComplexityGenerator.h"
+#include "InstanceDepthSorter.h"
 #include "TransparentHeavyLevel.generated.h"
 
+class UInstancedStaticMeshComponent;
+
+UENUM()
+enum class ECubeSpawnMode : uint8
+{
+	// One actor and dynamic material instance per cube
+	Actors,
+	// All cubes in one instanced component, the color goes through per-instance custom data
+	Instanced,
+	// Instanced, with the instances re-sorted back to front for the current view, so order-dependent transparency
+	// blends the cubes in the right order even though the engine sorts the component as a whole
+	SortedInstanced
+};
+
+/**
+ * Fills the view in front of the origin with translucent cubes from the depth complexity generator.
+ * Overrides: -CubeSpawnMode=Actors|Instanced|SortedInstanced -CubeCount=<n> -CubeSeed=<n> -CubeLayers=<avg> -CubeMaxLayers=<max>
+ * -CubeCoverage=<0-1> and -DepthSweep=1,2,4,8 to sweep the average layer count.
+ * Sorted instances are only re-sorted once the camera moved -CubeSortDistance=<cm> or turned -CubeSortAngle=<degrees>.
+ * The parameters, the achieved layer counts, spawn time and memory are added to the trace metadata.
+ */
 UCLASS()
 class GRADWORK_API ATransparentHeavyLevel : public ALevelScriptActor
 {
@@ -11,13 +34,60 @@ class GRADWORK_API ATransparentHeavyLevel : public ALevelScriptActor
 
 public:
 	ATransparentHeavyLevel();
-	
+
+	// Every sweep step is measured as its own run, without a sweep there is a single step
+	int32 GetNumSweepSteps() const { return FMath::Max(1, m_Sweep.Num()); }
+	int32 GetSweepStep() const { return m_SweepStep; }
+	// False when the instanced modes would fall back to the base material, which does not read the per-instance colors
+	bool CanRenderSpawnMode() const { return m_SpawnMode == ECubeSpawnMode::Actors || m_pInstancedMaterial != nullptr; }
+	// Empty without a sweep, appended to the run name otherwise
+	FString GetSweepStepName() const;
+	void ApplySweepStep(int32 step);
+
+	virtual void Tick(float DeltaSeconds) override;
+
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
 	UStaticMesh* m_pCubeMesh{ nullptr };
 	UMaterialInterface* m_pBaseMaterial{ nullptr };
-	
-	void SpawnCubes();
+	// Reads the color from PerInstanceCustomData 0-2 instead of the Color parameter
+	UMaterialInterface* m_pInstancedMaterial{ nullptr };
+
+	UPROPERTY(EditAnywhere, DisplayName="Spawn Mode")
+	ECubeSpawnMode m_SpawnMode{ ECubeSpawnMode::Actors };
+	UPROPERTY(EditAnywhere, DisplayName="Depth Complexity")
+	FDepthComplexityParams m_Params;
+	UPROPERTY(EditAnywhere, DisplayName="Sweep")
+	TArray<FDepthComplexityParams> m_Sweep;
+	int32 m_SweepStep{ 0 };
+
+	UPROPERTY()
+	TArray<AActor*> m_SpawnedActors;
+	UPROPERTY()
+	UInstancedStaticMeshComponent* m_pCubeInstances{ nullptr };
+
+	UPROPERTY(EditAnywhere, DisplayName="Sort Distance")
+	float m_SortDistance{ 10.f };
+	UPROPERTY(EditAnywhere, DisplayName="Sort Angle")
+	float m_SortAngle{ 1.f };
+	FInstanceDepthSorter m_InstanceSorter;
+	// The generated cubes, and the cube every instance slot currently holds
+	TArray<FTransform> m_InstanceTransforms;
+	TArray<FLinearColor> m_InstanceColors;
+	TArray<int32> m_InstanceOrder;
+	TArray<FTransform> m_UploadTransforms;
+	bool m_bHasSorted{ false };
+	FVector m_LastSortLocation{ FVector::ZeroVector };
+	FVector m_LastSortDirection{ FVector::ForwardVector };
+
+	void ParseCommandLine();
+	void SpawnCubes(const FDepthComplexityParams& params);
+	void SpawnCubeActors(const FDepthComplexityLayout& layout);
+	void SpawnCubeInstances(const FDepthComplexityLayout& layout);
+	void DestroyCubes();
+	// Re-sorts the instances when the view moved enough, returns the CPU time in microseconds and the uploaded KB
+	void SortInstances(const FVector& viewLocation, const FVector& viewDirection, double& outSortTimeUs, double& outUploadKB);
 };